@@ -42,7 +42,7 @@
 
 /* Scheduler Related */
 #define configUSE_PREEMPTION                    1
-#define configUSE_TICKLESS_IDLE                 0
+/* configUSE_TICKLESS_IDLE depends on ROBOT_SMP; see below */
 #define configUSE_IDLE_HOOK                     0
 #define configUSE_TICK_HOOK                     0
 #define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )
@@ -70,21 +70,36 @@
 #define configMESSAGE_BUFFER_LENGTH_TYPE        size_t
 
 /* Memory allocation related definitions. */
-#define configSUPPORT_STATIC_ALLOCATION         0
+/* Every application task, queue, mutex and event group is static (sized
+ * in .bss, see the link map). The heap only serves the SDK's
+ * async_context task and lwIP's sys_arch (tcpip_thread, mboxes,
+ * semaphores); diag reports its low-water mark as "heap_min". */
+#define configSUPPORT_STATIC_ALLOCATION         1
 #define configSUPPORT_DYNAMIC_ALLOCATION        1
-#define configTOTAL_HEAP_SIZE                   (128*1024)
+#define configTOTAL_HEAP_SIZE                   (32*1024)
 #define configAPPLICATION_ALLOCATED_HEAP        0
 
 /* Hook function related definitions. */
-#define configCHECK_FOR_STACK_OVERFLOW          0
-#define configUSE_MALLOC_FAILED_HOOK            0
+#define configCHECK_FOR_STACK_OVERFLOW          2
+#define configUSE_MALLOC_FAILED_HOOK            1
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           1
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
+#if configGENERATE_RUN_TIME_STATS
+/* 1 MHz hardware timer, already running; diag.c works on deltas so the
+ * 32-bit wrap is harmless. */
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+extern uint32_t diag_runtime_us(void);
+#endif
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()        diag_runtime_us()
+#endif
+
 /* Co-routine related definitions. */
 #define configUSE_CO_ROUTINES                   0
 #define configMAX_CO_ROUTINE_PRIORITIES         1
@@ -102,12 +117,41 @@
 #define configMAX_API_CALL_INTERRUPT_PRIORITY   [dependent on processor and application]
 */
 
+/* ROBOT_SMP=1 (CMake option) runs networking on core 0 and control on
+ * core 1; see smp.h for the task placement. */
+#ifndef ROBOT_SMP
+#define ROBOT_SMP                               0
+#endif
+
 #if FREE_RTOS_KERNEL_SMP // set by the RP2040 SMP port of FreeRTOS
 /* SMP port only */
+#if ROBOT_SMP
+#define configNUM_CORES                         2
+#define configUSE_CORE_AFFINITY                 1
+#else
 #define configNUM_CORES                         1
+#define configUSE_CORE_AFFINITY                 0
+#endif
 #define configTICK_CORE                         0
 #define configRUN_MULTIPLE_PRIORITIES           1
-#define configUSE_CORE_AFFINITY                 0
+#endif
+
+/* Tickless idle: the idle task stops SysTick and sleeps in WFI until the
+ * next timeout or interrupt; power.c accounts the time slept. The SMP
+ * kernel does not support it with both cores running. */
+#if ROBOT_SMP
+#define configUSE_TICKLESS_IDLE                 0
+#else
+#define configUSE_TICKLESS_IDLE                 1
+#endif
+
+#if configUSE_TICKLESS_IDLE
+#ifndef __ASSEMBLER__
+extern void power_sleep_begin(void);
+extern void power_sleep_end(void);
+#endif
+#define configPRE_SLEEP_PROCESSING(x)           power_sleep_begin()
+#define configPOST_SLEEP_PROCESSING(x)          power_sleep_end()
 #endif
 
 /* RP2040 specific */
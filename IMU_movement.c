@@ -18,6 +18,10 @@
 #include "mqtt_client.h"
 #include "motor_encoder_demo.h"
 #include "encoder.h"
+#include "attitude.h"
+#include "magcal.h"
+#include "filter.h"
+#include "fxmath.h"
 
 /* ==============================
  * Filter Configuration
@@ -26,6 +30,7 @@
 #define PID_PROGRESS_SMALL_ERR   (10.0f)
 #define PID_PROGRESS_MED_ERR     (25.0f)
 #define PID_PROGRESS_LARGE_ERR   (45.0f)
+#define SETPOINT_FAST_SAMPLES    (3)
 
 /* ==============================
  * PID Config (Public Accessors unchanged)
@@ -60,18 +65,19 @@ static volatile uint32_t g_imu_last_pub_ms          = 0;
 /* ==============================
  * Filter Histories
  * ============================== */
-static int filter_index = 0;
-static int16_t ax_hist[FILTER_SIZE] = {0};
-static int16_t ay_hist[FILTER_SIZE] = {0};
-static int16_t az_hist[FILTER_SIZE] = {0};
+/* One running-sum moving average per accel axis (x, y, z) */
+static filter_ma_t g_accel_ma[3] =
+{
+    { .len = FILTER_SIZE }, { .len = FILTER_SIZE }, { .len = FILTER_SIZE }
+};
 
 /* ==============================
  * Private Prototypes
  * ============================== */
-static int16_t apply_filter_(int16_t raw, int16_t *history, int *idx);
+static bool    sample_imu_(imu_data_t *data, int16_t raw[3], int16_t filt[3]);
 static void    calc_orientation_(int16_t ax, int16_t ay, int16_t az,
                                  float *pitch, float *roll);
-static float   calc_yaw_(int16_t mx, int16_t my, int16_t mz,
+static float   calc_yaw_(float mx, float my, float mz,
                          float pitch_deg, float roll_deg);
 static float   normalize_angle_(float angle);
 static float   angle_error_(float current, float target);
@@ -153,33 +159,30 @@ void imu_reset_total_distance(void)
 /* ==============================
  * Filtering / Orientation
  * ============================== */
-static int16_t apply_filter_(int16_t raw, int16_t *history, int *idx)
-{
-    history[*idx] = raw;
-    *idx = (*idx + 1) % FILTER_SIZE;
-    int32_t sum = 0;
-    for (int i = 0; i < FILTER_SIZE; i++) sum += history[i];
-    return (int16_t)(sum / FILTER_SIZE);
-}
-
 static void calc_orientation_(int16_t ax, int16_t ay, int16_t az,
                               float *pitch, float *roll)
 {
-    *pitch = atan2f(-ax, sqrtf((float)(ay * ay + az * az))) * 180.0f / (float)M_PI;
-    *roll  = atan2f((float)ay, (float)az) * 180.0f / (float)M_PI;
+    /* Integer mg in, no soft-float trig (see fxmath.h for error bounds) */
+    uint32_t yz = fx_sqrt_u32((uint32_t)(((int32_t)ay * ay) + ((int32_t)az * az)));
+    *pitch = FX_TO_DEG(fx_atan2_deg(-(int32_t)ax, (int32_t)yz));
+    *roll  = FX_TO_DEG(fx_atan2_deg(ay, az));
 }
 
-static float calc_yaw_(int16_t mx, int16_t my, int16_t mz,
+static float calc_yaw_(float mx, float my, float mz,
                        float pitch_deg, float roll_deg)
 {
-    float pitch = pitch_deg * M_PI / 180.0f;
-    float roll  = roll_deg  * M_PI / 180.0f;
-
-    float Mx_comp = mx * cosf(pitch) + mz * sinf(pitch);
-    float My_comp = mx * sinf(roll) * sinf(pitch) + my * cosf(roll) -
-                    mz * sinf(roll) * cosf(pitch);
-
-    float yaw = atan2f(-My_comp, Mx_comp) * 180.0f / M_PI;
+    int16_t sp, cp, sr, cr;
+    fx_sincos(FX_DEG(pitch_deg), &sp, &cp);
+    fx_sincos(FX_DEG(roll_deg),  &sr, &cr);
+
+    /* Field is well inside +/-2^12 LSB, so the Q15 products fit in int32 */
+    int32_t x = (int32_t)mx;
+    int32_t y = (int32_t)my;
+    int32_t z = (int32_t)mz;
+    int32_t Mx_comp = (x * cp) + (z * sp);
+    int32_t My_comp = (int32_t)(((int64_t)sr * ((x * sp) - (z * cp))) >> 15) + (y * cr);
+
+    float yaw = FX_TO_DEG(fx_atan2_deg(-My_comp, Mx_comp));
     if (yaw < 0.0f) yaw += 360.0f;
     return yaw;
 }
@@ -228,7 +231,7 @@ static void publish_imu_telemetry_(const imu_data_t *data,
 /* ==============================
  * Data Acquisition
  * ============================== */
-bool read_imu_data(imu_data_t *data)
+static bool sample_imu_(imu_data_t *data, int16_t raw[3], int16_t filt[3])
 {
     if (data == NULL) return false;
     memset(data, 0, sizeof(*data));
@@ -236,16 +239,28 @@ bool read_imu_data(imu_data_t *data)
     int16_t ax, ay, az;
     if (!read_accel_raw(&ax, &ay, &az)) return false;
 
-    int16_t ax_f = apply_filter_(ax, ax_hist, &filter_index);
-    int16_t ay_f = apply_filter_(ay, ay_hist, &filter_index);
-    int16_t az_f = apply_filter_(az, az_hist, &filter_index);
+    int16_t ax_f = filter_ma_push(&g_accel_ma[0], ax);
+    int16_t ay_f = filter_ma_push(&g_accel_ma[1], ay);
+    int16_t az_f = filter_ma_push(&g_accel_ma[2], az);
+    if (raw != NULL)
+    {
+        raw[0] = ax; raw[1] = ay; raw[2] = az;
+    }
+    if (filt != NULL)
+    {
+        filt[0] = ax_f; filt[1] = ay_f; filt[2] = az_f;
+    }
 
     int16_t mx, my, mz;
     if (!read_mag_raw(&mx, &my, &mz)) return false;
 
+    /* Hard/soft-iron correction (identity until calibrated) */
+    float cmx, cmy, cmz;
+    magcal_apply(mx, my, mz, &cmx, &cmy, &cmz);
+
     float pitch, roll;
     calc_orientation_(ax_f, ay_f, az_f, &pitch, &roll);
-    float yaw = calc_yaw_(mx, my, mz, pitch, roll);
+    float yaw = calc_yaw_(cmx, cmy, cmz, pitch, roll);
 
     data->pitch   = normalize_angle_(pitch);
     data->roll    = normalize_angle_(roll);
@@ -253,12 +268,26 @@ bool read_imu_data(imu_data_t *data)
     data->accel_x = ax_f / 1000.0f;
     data->accel_y = ay_f / 1000.0f;
     data->accel_z = az_f / 1000.0f;
-    data->mag_x   = (float)mx;
-    data->mag_y   = (float)my;
-    data->mag_z   = (float)mz;
+    data->mag_x   = cmx;
+    data->mag_y   = cmy;
+    data->mag_z   = cmz;
+
+    /* Fused estimate supersedes the raw compass heading when available */
+    if (attitude_running())
+    {
+        attitude_t att;
+        attitude_get(&att);
+        data->yaw    = att.yaw_deg;
+        data->gyro_z = att.yaw_rate_dps;
+    }
     return true;
 }
 
+bool read_imu_data(imu_data_t *data)
+{
+    return sample_imu_(data, NULL, NULL);
+}
+
 void print_imu_data(const imu_data_t *data)
 {
     if (!data) return;
@@ -354,26 +383,52 @@ static void drive_to_setpoint_(float current_yaw,
     drive_signed(*ls, *rs);
 }
 
+float progressive_pid_controller_update(float current_yaw, pid_config_t *cfg,
+                                        pid_state_t *st)
+{
+    return progressive_pid_(current_yaw, (cfg != NULL) ? cfg : &pid_config,
+                            (st != NULL) ? st : &pid_state);
+}
+
+void drive_to_yaw_setpoint(float current_yaw, pid_config_t *cfg, pid_state_t *st,
+                           float *pid_out, float *ls, float *rs)
+{
+    drive_to_setpoint_(current_yaw, (cfg != NULL) ? cfg : &pid_config,
+                       (st != NULL) ? st : &pid_state, pid_out, ls, rs);
+}
+
 pid_config_t *get_pid_config(void) { return &pid_config; }
 pid_state_t  *get_pid_state(void)  { return &pid_state; }
 
 bool detect_initial_setpoint(int samples)
 {
-    float sum_yaw = 0.0f;
+    /* A calibrated compass is trustworthy from the first sample; only a
+     * few are averaged, one attitude period apart */
+    uint32_t gap_ms = 100u;
+    if (magcal_is_valid())
+    {
+        samples = (samples < SETPOINT_FAST_SAMPLES) ? samples : SETPOINT_FAST_SAMPLES;
+        gap_ms  = ATTITUDE_PERIOD_MS;
+    }
+
+    /* Average as unit vectors so readings either side of 0/360 agree */
+    float sum_s = 0.0f;
+    float sum_c = 0.0f;
     int ok_samples = 0;
     for (int i = 0; i < samples; i++)
     {
         imu_data_t data;
         if (read_imu_data(&data))
         {
-            sum_yaw += data.yaw;
+            sum_s += sinf(data.yaw * (float)M_PI / 180.0f);
+            sum_c += cosf(data.yaw * (float)M_PI / 180.0f);
             ok_samples++;
         }
-        sleep_ms(100);
+        sleep_ms(gap_ms);
     }
     if (ok_samples > 0)
     {
-        pid_config.setpoint = sum_yaw / ok_samples;
+        pid_config.setpoint = normalize_angle_(atan2f(sum_s, sum_c) * 180.0f / (float)M_PI);
         return true;
     }
     return false;
@@ -391,22 +446,16 @@ void imu_movement_task(__unused void *params)
 {
     imu_movement_init();
     imu_data_t current;
-    int16_t ax_raw=0, ay_raw=0, az_raw=0;
-    int16_t ax_f=0, ay_f=0, az_f=0;
+    int16_t raw[3]  = { 0 };
+    int16_t filt[3] = { 0 };
 
     while (true)
     {
         uint32_t now = to_ms_since_boot(get_absolute_time());
 
-        if (read_imu_data(&current))
+        /* One sample feeds both control and telemetry */
+        if (sample_imu_(&current, raw, filt))
         {
-            if (read_accel_raw(&ax_raw, &ay_raw, &az_raw))
-            {
-                ax_f = apply_filter_(ax_raw, ax_hist, &filter_index);
-                ay_f = apply_filter_(ay_raw, ay_hist, &filter_index);
-                az_f = apply_filter_(az_raw, az_hist, &filter_index);
-            }
-
             float pid_out, ls, rs;
             drive_to_setpoint_(current.yaw, &pid_config, &pid_state,
                                &pid_out, &ls, &rs);
@@ -419,8 +468,8 @@ void imu_movement_task(__unused void *params)
                 g_imu_last_pub_ms = now;
                 publish_imu_telemetry_(&current, error, pid_out,
                                        ls, rs,
-                                       ax_raw, ay_raw, az_raw,
-                                       ax_f, ay_f, az_f);
+                                       raw[0], raw[1], raw[2],
+                                       filt[0], filt[1], filt[2]);
             }
         }
         mqtt_loop_poll();
@@ -1,11 +1,15 @@
 /** @file Obstacle_Avoidance.c
  *  @brief Encoder-based obstacle detection and avoidance routines with servo scan.
  *
+ *  NOTE: Avoidance is a tick-driven state machine (avoid_start / avoid_tick);
+ *        nothing here sleeps, so the control loop keeps running throughout.
  *  NOTE: Refactored for Barr-C style, condensed telemetry, removed repetitive prints.
- *  WARNING: TURN_*_DEG_PULSES empirical; recalibrate if wheel size or encoder resolution changes.
+ *  WARNING: Leg lengths are straight_start() distances in cm; they are only as
+ *           good as ENCODER_CM_PER_TICK for the fitted wheels.
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <stdbool.h>
 #include <math.h>
 #include "pico/stdlib.h"
@@ -21,37 +25,41 @@
 #include "motor_encoder_demo.h"
 #include "ir_sensor.h"
 #include "PID_Line_Follow.h"
-#include "mqtt_client.h"
 #include "encoder.h"
 #include "imu_raw_demo.h"
+#include "servo.h"
+#include "bypass.h"
+#include "turn.h"
+#include "fxmath.h"
+#include "straight.h"
 
 /* ==============================
  * Configuration Constants
  * ============================== */
-#define TURN_90_DEG_PULSES     (9u)
-#define TURN_180_DEG_PULSES    (16u)
-#define TURN_45_DEG_PULSES     (4u)
-#define CIRCLE_TARGET_PULSES   (12u)
-
-#define SERVO_MIN_PULSE_US     (500.0f)
-#define SERVO_MAX_PULSE_US     (2500.0f)
-#define SERVO_PWM_WRAP         (20000u)
-#define SERVO_PWM_CLKDIV       (125.0f)
-#define SERVO_CENTER_DEG       (85.0f)
-
 #define OBSTACLE_DETECTION_DISTANCE_CM (50.0f)
-#define SAFE_DISTANCE_CM               (25.0f)
-#define INITIAL_STOP_DISTANCE_CM       (15.0f)
 
-#define OBJECT_SCAN_STEP_DEG     (1.0f)
+#define OBJECT_SCAN_COARSE_STEP_DEG (10.0f)
+#define OBJECT_SCAN_FINE_RES_DEG    (1.0f)
 #define OBJECT_SCAN_LEFT_START   (150.0f)
 #define OBJECT_SCAN_RIGHT_END    (30.0f)
+#define OBJECT_SCAN_COARSE_N     (13u)       /* (150 - 30) / 10 + 1 */
+#define OBJECT_SCAN_MAX_CM       (50.0f)
+#define OBJECT_SCAN_BEAM_HALF_DEG (7.5f)     /* HC-SR04 ~15 deg cone */
 #define OBJECT_WIDTH_THRESHOLD_CM (30.0f)
 
-/* ==============================
- * Static Telemetry Timing
- * ============================== */
-static volatile uint32_t g_last_pub_ms = 0;
+#define ULTRA_PING_INTERVAL_MS   (30u)       /* let previous echoes decay */
+
+#define SIDE_CLEAR_SAMPLES       (4u)        /* 100 ms of no return = corner */
+#define SIDE_CORNER_CLEAR_CM     (6.0f)      /* drive past the corner before turning */
+#define SIDE_MAX_LEG_CM          (60.0f)     /* give up on a leg that never sees it */
+#define SIDE_MAX_CORNERS         (4u)
+
+#define AVOID_TICK_MS            (10u)       /* control-loop period */
+#define AVOID_TIMEOUT_MS         (20000u)    /* whole manoeuvre */
+#define AVOID_LEG_PCT            (CIRCLE_BASE_SPEED_RIGHT)
+#define AVOID_REJOIN_FWD_CM      (20.0f)     /* was 700 ms open loop at 50% */
+#define AVOID_REJOIN_PCT         (50.0f)
+#define AVOID_SIDE_LOOK_DEG      (0.0f)      /* servo hard right, ~85 deg off centre */
 
 /* ==============================
  * Speed & Distance State
@@ -63,44 +71,9 @@ static volatile float    g_last_distance_cm     = 0.0f;
 /* ==============================
  * Static Prototypes
  * ============================== */
-static uint32_t get_average_pulses_(void);
-static void     turn_left_encoder_(uint32_t target_pulses);
-static void     turn_right_encoder_(uint32_t target_pulses);
 static bool     obstacle_detected_(float distance_cm);
-static bool     object_too_close_(float distance_cm);
-static bool     object_at_stop_distance_(float distance_cm);
-static void     servo_init_(void);
-static void     servo_set_angle_(float angle);
-static bool     check_if_object_still_there_(void);
-static void     encircle_object_with_checking_(void);
-static void     complete_avoidance_cycle_(void);
+static float    edge_half_span_deg_(float ang_left, float ang_right);
 static void     update_speed_and_distance_(void);
-static void     debug_encoder_pulses_(const char *context);
-
-/* ==============================
- * Servo Setup
- * ============================== */
-static void servo_init_(void)
-{
-    gpio_set_function(SERVO_PIN, GPIO_FUNC_PWM);
-    uint slice = pwm_gpio_to_slice_num(SERVO_PIN);
-
-    pwm_config cfg = pwm_get_default_config();
-    pwm_config_set_clkdiv(&cfg, SERVO_PWM_CLKDIV);
-    pwm_config_set_wrap(&cfg, SERVO_PWM_WRAP);
-    pwm_init(slice, &cfg, true);
-    servo_set_angle_(SERVO_CENTER_DEG);
-    printf("[SERVO] init GPIO %d\n", SERVO_PIN);
-}
-
-static void servo_set_angle_(float angle)
-{
-    if (angle < 0.0f)  angle = 0.0f;
-    if (angle > 180.0f) angle = 180.0f;
-    float pulse_width_us = SERVO_MIN_PULSE_US +
-        (angle / 180.0f) * (SERVO_MAX_PULSE_US - SERVO_MIN_PULSE_US);
-    pwm_set_gpio_level(SERVO_PIN, (uint16_t)pulse_width_us);
-}
 
 /* ==============================
  * Speed Calculation
@@ -166,393 +139,676 @@ void reset_total_distance(void)
 }
 
 /* ==============================
- * Encoder Helpers
+ * Obstacle Detection
  * ============================== */
-static uint32_t get_average_pulses_(void)
+static bool obstacle_detected_(float distance_cm)
 {
-    int32_t l = encoder_get_pulse_count(ENCODER_LEFT_GPIO);
-    int32_t r = encoder_get_pulse_count(ENCODER_RIGHT_GPIO);
-    return (uint32_t)((l + r) / 2);
+    return (distance_cm > 2.0f) && (distance_cm <= OBSTACLE_DETECTION_DISTANCE_CM);
 }
 
-static void debug_encoder_pulses_(const char *context)
+/* ==============================
+ * Turning (Heading-Based)
+ * ============================== */
+void turn_left_90_degrees(void)   { (void)turn_by(90.0f); }
+void turn_right_90_degrees(void)  { (void)turn_by(-90.0f); }
+void turn_left_45_degrees(void)   { (void)turn_by(45.0f); }
+
+/* ==============================
+ * Object Width Calculation
+ * ============================== */
+/* Edge angles are the last bearings still inside the beam cone; the
+ * physical edge sits half a cone inward on each side. An object narrower
+ * than the cone still spans at least one fine scan step, so it keeps a
+ * small positive width (negative stays reserved for "no object"). */
+static float edge_half_span_deg_(float ang_left, float ang_right)
 {
-    int32_t lcnt = encoder_get_pulse_count(ENCODER_LEFT_GPIO);
-    int32_t rcnt = encoder_get_pulse_count(ENCODER_RIGHT_GPIO);
-    float   lspd = encoder_get_speed_cm_s_timeout(ENCODER_LEFT_GPIO, 200);
-    float   rspd = encoder_get_speed_cm_s_timeout(ENCODER_RIGHT_GPIO, 200);
-    float   ldist= encoder_get_distance_cm(ENCODER_LEFT_GPIO);
-    float   rdist= encoder_get_distance_cm(ENCODER_RIGHT_GPIO);
+    float half = (0.5f * fabsf(ang_left - ang_right)) - OBJECT_SCAN_BEAM_HALF_DEG;
+    return fmaxf(half, 0.5f * OBJECT_SCAN_FINE_RES_DEG);
+}
 
-    printf("[ENC][%s] L:%ld %.1fcm %.1fcm/s | R:%ld %.1fcm %.1fcm/s\n",
-           context, lcnt, ldist, lspd, rcnt, rdist, rspd);
+static float calculate_object_width_(float d_left,
+                                     float d_right,
+                                     float ang_left,
+                                     float ang_right)
+{
+    float span_deg = 2.0f * edge_half_span_deg_(ang_left, ang_right);
+
+    /* Law of cosines in integer mm (ranges < 4 m, so a^2 + b^2 < 2^25) */
+    int16_t cos_c;
+    fx_sincos(FX_DEG(span_deg), NULL, &cos_c);
+    int32_t a     = (int32_t)(d_left  * 10.0f);
+    int32_t b     = (int32_t)(d_right * 10.0f);
+    int32_t twoab = (int32_t)(((int64_t)(2 * a * b) * cos_c) >> 15);
+    int32_t c2    = (a * a) + (b * b) - twoab;
+    if (c2 < 0) c2 = -c2;
+    return (float)fx_sqrt_u32((uint32_t)c2) * 0.1f;
 }
 
 /* ==============================
- * Obstacle Detection
+ * Avoidance State Machine Types
  * ============================== */
-static bool obstacle_detected_(float distance_cm)
+typedef enum
 {
-    return (distance_cm > 2.0f) && (distance_cm <= OBSTACLE_DETECTION_DISTANCE_CM);
-}
+    SCAN_COARSE = 0,
+    SCAN_REFINE_RIGHT,
+    SCAN_REFINE_LEFT,
+    SCAN_FINISHED
+} scan_phase_t;
 
-static bool object_too_close_(float distance_cm)
+typedef struct
 {
-    return (distance_cm > 2.0f) && (distance_cm <= SAFE_DISTANCE_CM);
-}
+    scan_phase_t     phase;
+    uint32_t         idx;                         /* coarse bearing index */
+    float            ang[OBJECT_SCAN_COARSE_N];
+    float            dist[OBJECT_SCAN_COARSE_N];
+    bool             hit[OBJECT_SCAN_COARSE_N];
+    int              left_idx;                    /* coarse edges of the anchor run */
+    int              right_idx;
+    float            hit_ang;                     /* refine bracket: on the object */
+    float            hit_dist;
+    float            miss_ang;                    /* ... and off it */
+    float            probe_ang;                   /* bearing currently being probed */
+    bool             armed;                       /* servo settled, awaiting echo */
+    uint32_t         armed_us;
+    absolute_time_t  ping_ok_at;                  /* earliest next direct ping */
+    uint32_t         t0_ms;
+    float            front_cm;                    /* nearest face, straight ahead */
+    ObjectScanResult res;
+} scan_sm_t;
 
-static bool object_at_stop_distance_(float distance_cm)
+typedef enum
 {
-    return (distance_cm > 2.0f) && (distance_cm <= INITIAL_STOP_DISTANCE_CM);
-}
+    AV_PHASE_SCAN = 0,
+    AV_PHASE_BYPASS,
+    AV_PHASE_TURN_OUT,
+    AV_PHASE_LEG,
+    AV_PHASE_CORNER_CLEAR,
+    AV_PHASE_TURN_IN,
+    AV_PHASE_REJOIN_FWD,
+    AV_PHASE_REJOIN_PIVOT,
+    AV_PHASE_FINISHED
+} avoid_phase_t;
+
+typedef struct
+{
+    avoid_phase_t   phase;
+    avoid_status_t  status;
+    uint32_t        start_ms;
+    uint32_t        phase_ms;         /* entry time of the current phase */
+    uint32_t        corners;
+    uint32_t        clear_cnt;
+    bool            seen;
+    uint32_t        side_seq;
+    absolute_time_t side_ping_ok_at;
+    float           heading0;         /* compass heading at start, -1 if none */
+    scan_sm_t       scan;
+    char            note[AVOID_NOTE_LEN]; /* for the caller to publish, "" if none */
+} avoid_ctx_t;
+
+static avoid_ctx_t g_avoid = { .phase = AV_PHASE_FINISHED, .status = AVOID_IDLE };
+
+static void scan_start_refine_(scan_sm_t *s, scan_phase_t phase, int hit_idx, int miss_idx);
 
 /* ==============================
- * Turning (Encoder-Based)
+ * Non-Blocking Scan
  * ============================== */
-static void turn_left_encoder_(uint32_t target_pulses)
+static bool scan_is_hit_(float d)
 {
-    encoder_reset_distance(ENCODER_LEFT_GPIO);
-    encoder_reset_distance(ENCODER_RIGHT_GPIO);
+    return (d > 2.0f) && (d <= OBJECT_SCAN_MAX_CM);
+}
 
-    drive_signed(-50.0f * 1.25f, 50.0f);
+static void scan_begin_probe_(scan_sm_t *s, float angle)
+{
+    s->probe_ang = angle;
+    s->armed     = false;
+    servo_set_angle(angle);
+}
 
-    uint32_t start = to_ms_since_boot(get_absolute_time());
-    while (get_average_pulses_() < target_pulses)
+/* Settling runs concurrently with the previous ping's echo decay; a reading
+ * is taken on the first tick where both are over. */
+static bool scan_poll_probe_(scan_sm_t *s, float *dist_out)
+{
+    if (!servo_is_ready())
     {
-        uint32_t now = to_ms_since_boot(get_absolute_time());
-        if ((now - start) > 3000 && (get_average_pulses_() == 0))
+        return false;
+    }
+
+    if (ultrasonic_scheduler_running())
+    {
+        /* Only accept a ping fired after the horn arrived */
+        if (!s->armed)
         {
-            printf("[TURN] fallback timed left\n");
-            break;
+            s->armed    = true;
+            s->armed_us = time_us_32();
+        }
+        ultrasonic_range_t r;
+        if (!ultrasonic_get_latest(ULTRA_SENSOR_FRONT, &r) ||
+            ((int32_t)(r.trigger_us - s->armed_us) < 0))
+        {
+            return false;
         }
-        sleep_ms(10);
+        *dist_out = r.distance_cm;
+        return true;
+    }
+
+    if (!time_reached(s->ping_ok_at))
+    {
+        return false;
     }
-    all_stop();
+    *dist_out = ultrasonic_ping_cm(OBJECT_SCAN_MAX_CM * 2.0f);
+    s->ping_ok_at = make_timeout_time_ms(ULTRA_PING_INTERVAL_MS);
+    return true;
 }
 
-static void turn_right_encoder_(uint32_t target_pulses)
+static void scan_finish_(scan_sm_t *s)
 {
-    encoder_reset_distance(ENCODER_LEFT_GPIO);
-    encoder_reset_distance(ENCODER_RIGHT_GPIO);
+    if (s->left_idx >= 0)
+    {
+        s->front_cm = OBJECT_SCAN_MAX_CM;
+        for (int i = s->left_idx; i <= s->right_idx; i++)
+        {
+            int16_t cos_b;
+            fx_sincos(FX_DEG(s->ang[i] - SERVO_CENTER_DEG), NULL, &cos_b);
+            s->front_cm = fminf(s->front_cm, s->dist[i] * FX_Q15_TO_F(cos_b));
+        }
+        s->res.width_cm = calculate_object_width_(s->res.left_distance,
+                                                  s->res.right_distance,
+                                                  s->res.left_angle,
+                                                  s->res.right_angle);
+    }
+    s->phase = SCAN_FINISHED;
+    printf("[SCAN] L:%.0f@%.1f R:%.0f@%.1f W:%.1fcm %lums\n",
+           s->res.left_angle, s->res.left_distance,
+           s->res.right_angle, s->res.right_distance, s->res.width_cm,
+           (unsigned long)(to_ms_since_boot(get_absolute_time()) - s->t0_ms));
+}
 
-    drive_signed(50.0f * 1.25f, -50.0f);
+/* Binary search between a hit bearing and a miss bearing for the last hit. */
+static void scan_refine_next_(scan_sm_t *s)
+{
+    float mid = roundf((s->hit_ang + s->miss_ang) * 0.5f);
+    if ((fabsf(s->miss_ang - s->hit_ang) > OBJECT_SCAN_FINE_RES_DEG) &&
+        (mid != s->hit_ang) && (mid != s->miss_ang))
+    {
+        scan_begin_probe_(s, mid);
+        return;
+    }
 
-    uint32_t start = to_ms_since_boot(get_absolute_time());
-    while (get_average_pulses_() < target_pulses)
+    if (s->phase == SCAN_REFINE_RIGHT)
     {
-        uint32_t now = to_ms_since_boot(get_absolute_time());
-        if ((now - start) > 3000 && (get_average_pulses_() == 0))
+        s->res.right_angle    = s->hit_ang;
+        s->res.right_distance = s->hit_dist;
+        if (s->left_idx > 0)
         {
-            printf("[TURN] fallback timed right\n");
-            break;
+            scan_start_refine_(s, SCAN_REFINE_LEFT, s->left_idx, s->left_idx - 1);
+            return;
         }
-        sleep_ms(10);
     }
-    all_stop();
+    else
+    {
+        s->res.left_angle    = s->hit_ang;
+        s->res.left_distance = s->hit_dist;
+    }
+    scan_finish_(s);
 }
 
-void turn_left_90_degrees(void)   { turn_left_encoder_(TURN_90_DEG_PULSES); }
-void turn_right_90_degrees(void)  { turn_right_encoder_(TURN_90_DEG_PULSES); }
-void turn_left_45_degrees(void)   { turn_left_encoder_(TURN_45_DEG_PULSES); }
+static void scan_start_refine_(scan_sm_t *s, scan_phase_t phase, int hit_idx, int miss_idx)
+{
+    s->phase    = phase;
+    s->hit_ang  = s->ang[hit_idx];
+    s->hit_dist = s->dist[hit_idx];
+    s->miss_ang = s->ang[miss_idx];
+    scan_refine_next_(s);
+}
 
-/* ==============================
- * Object Width Calculation
- * ============================== */
-typedef struct
+static void scan_pick_edges_(scan_sm_t *s)
 {
-    float left_distance;
-    float right_distance;
-    float left_angle;
-    float right_angle;
-    float width_cm;
-} ObjectScanResult;
+    /* Pick the hit closest to straight ahead as the object's anchor */
+    int   anchor = -1;
+    float best   = 1e9f;
+    for (uint32_t i = 0; i < OBJECT_SCAN_COARSE_N; i++)
+    {
+        float off = fabsf(s->ang[i] - SERVO_CENTER_DEG);
+        if (s->hit[i] && (off < best))
+        {
+            best   = off;
+            anchor = (int)i;
+        }
+    }
+    if (anchor < 0)
+    {
+        scan_finish_(s);
+        return;
+    }
 
-static float calculate_object_width_(float d_left,
-                                     float d_right,
-                                     float ang_left,
-                                     float ang_right)
+    int l = anchor;
+    int r = anchor;
+    while ((l > 0) && s->hit[l - 1]) l--;
+    while ((r < (int)OBJECT_SCAN_COARSE_N - 1) && s->hit[r + 1]) r++;
+    s->left_idx  = l;
+    s->right_idx = r;
+
+    s->res.left_angle     = s->ang[l];
+    s->res.left_distance  = s->dist[l];
+    s->res.right_angle    = s->ang[r];
+    s->res.right_distance = s->dist[r];
+
+    /* Refine the edge nearest the current servo position first */
+    if (r < (int)OBJECT_SCAN_COARSE_N - 1)
+    {
+        scan_start_refine_(s, SCAN_REFINE_RIGHT, r, r + 1);
+    }
+    else if (l > 0)
+    {
+        scan_start_refine_(s, SCAN_REFINE_LEFT, l, l - 1);
+    }
+    else
+    {
+        scan_finish_(s);
+    }
+}
+
+static void scan_start_(scan_sm_t *s)
 {
-    float angle_c = fabsf((ang_left + 15.0f) - (ang_right - 15.0f)) * (float)M_PI / 180.0f;
-    float a2      = d_left * d_left;
-    float b2      = d_right * d_right;
-    float twoab   = 2.0f * d_left * d_right * cosf(angle_c);
-    float c2      = a2 + b2 - twoab;
-    if (c2 < 0.0f) c2 = fabsf(c2);
-    return sqrtf(c2);
+    s->res.left_distance  = -1.0f;
+    s->res.right_distance = -1.0f;
+    s->res.left_angle     = -1.0f;
+    s->res.right_angle    = -1.0f;
+    s->res.width_cm       = -1.0f;
+    s->phase      = SCAN_COARSE;
+    s->idx        = 0;
+    s->left_idx   = -1;
+    s->right_idx  = -1;
+    s->front_cm   = -1.0f;
+    s->ping_ok_at = get_absolute_time();
+    s->t0_ms      = to_ms_since_boot(get_absolute_time());
+    scan_begin_probe_(s, OBJECT_SCAN_LEFT_START);
 }
 
-static ObjectScanResult scan_object_width_(void)
+/* Advance the scan by at most one reading. Returns true once finished. */
+static bool scan_step_(scan_sm_t *s)
 {
-    ObjectScanResult res;
-    res.left_distance  = -1.0f;
-    res.right_distance = -1.0f;
-    res.left_angle     = -1.0f;
-    res.right_angle    = -1.0f;
-    res.width_cm       = -1.0f;
-
-    float max_left_dist  = -1.0f;
-    float max_right_dist = -1.0f;
-    float max_left_angle = -1.0f;
-    float max_right_angle= -1.0f;
-    bool left_found      = false;
-
-    servo_set_angle_(OBJECT_SCAN_LEFT_START);
-    sleep_ms(500);
-
-    for (float angle = OBJECT_SCAN_LEFT_START;
-         angle >= OBJECT_SCAN_RIGHT_END;
-         angle -= OBJECT_SCAN_STEP_DEG)
+    float d;
+    if ((s->phase == SCAN_FINISHED) || !scan_poll_probe_(s, &d))
     {
-        servo_set_angle_(angle);
-        sleep_ms(75);
-        float d = ultrasonic_get_distance_cm();
-        if ((d > 2.0f) && (d <= 50.0f))
-        {
-            if ((angle > 90.0f) && !left_found)
+        return (s->phase == SCAN_FINISHED);
+    }
+
+    bool hit = scan_is_hit_(d);
+    switch (s->phase)
+    {
+        case SCAN_COARSE:
+            s->ang[s->idx]  = s->probe_ang;
+            s->dist[s->idx] = d;
+            s->hit[s->idx]  = hit;
+            if (++s->idx < OBJECT_SCAN_COARSE_N)
             {
-                if (d > max_left_dist)
-                {
-                    max_left_dist  = d;
-                    max_left_angle = angle;
-                    left_found     = true;
-                }
+                scan_begin_probe_(s, OBJECT_SCAN_LEFT_START -
+                                     (s->idx * OBJECT_SCAN_COARSE_STEP_DEG));
             }
-            else if (angle <= 90.0f)
+            else
             {
-                if (d > max_right_dist)
-                {
-                    max_right_dist  = d;
-                    max_right_angle = angle;
-                }
+                scan_pick_edges_(s);
             }
-        }
-    }
+            break;
 
-    if ((max_left_dist > 0.0f) && (max_right_dist > 0.0f))
-    {
-        res.left_distance  = max_left_dist;
-        res.left_angle     = max_left_angle;
-        res.right_distance = max_right_dist;
-        res.right_angle    = max_right_angle;
-        res.width_cm       = calculate_object_width_(res.left_distance,
-                                                     res.right_distance,
-                                                     res.left_angle,
-                                                     res.right_angle);
-    }
+        case SCAN_REFINE_RIGHT:
+        case SCAN_REFINE_LEFT:
+            if (hit)
+            {
+                s->hit_ang  = s->probe_ang;
+                s->hit_dist = d;
+            }
+            else
+            {
+                s->miss_ang = s->probe_ang;
+            }
+            scan_refine_next_(s);
+            break;
 
-    servo_set_angle_(SERVO_CENTER_DEG);
-    return res;
+        default:
+            break;
+    }
+    return (s->phase == SCAN_FINISHED);
 }
 
 /* ==============================
- * Presence Check
+ * Avoidance Helpers
  * ============================== */
-static bool check_if_object_still_there_(void)
+static void avoid_enter_(avoid_ctx_t *a, avoid_phase_t phase)
+{
+    a->phase    = phase;
+    a->phase_ms = to_ms_since_boot(get_absolute_time());
+}
+
+/* The dedicated side sensor is used when the scheduler is firing it;
+ * otherwise the front sensor is swung to look right. */
+static bool side_uses_servo_(void)
 {
-    turn_right_90_degrees();
-    bool detected = false;
-    for (float angle = 45.0f; angle <= 135.0f; angle += 2.0f)
+    return !((ULTRASONIC_NUM_SENSORS > 1) && ultrasonic_scheduler_running());
+}
+
+static bool side_sample_(avoid_ctx_t *a, float *dist_out)
+{
+    if (!servo_is_ready())
+    {
+        return false;
+    }
+
+    if (ultrasonic_scheduler_running())
     {
-        servo_set_angle_(angle);
-        sleep_ms(100);
-        float distance = ultrasonic_get_distance_cm();
-        if (obstacle_detected_(distance))
+        uint8_t sensor = side_uses_servo_() ? ULTRA_SENSOR_FRONT : ULTRA_SENSOR_SIDE;
+        ultrasonic_range_t r;
+        if (!ultrasonic_get_latest(sensor, &r) || (r.seq == a->side_seq))
         {
-            detected = true;
-            break;
+            return false;
         }
-        sleep_ms(50);
+        a->side_seq = r.seq;
+        *dist_out   = r.distance_cm;
+        return true;
+    }
+
+    if (!time_reached(a->side_ping_ok_at))
+    {
+        return false;
+    }
+    *dist_out = ultrasonic_ping_cm(OBJECT_SCAN_MAX_CM * 2.0f);
+    a->side_ping_ok_at = make_timeout_time_ms(ULTRA_PING_INTERVAL_MS);
+    return true;
+}
+
+/* Legs are held on absolute headings: out is 90 deg left of the approach
+ * heading and every corner turns 90 deg back right, so turn errors do not
+ * accumulate into the legs. */
+static float leg_heading_(const avoid_ctx_t *a)
+{
+    if (a->heading0 < 0.0f)
+    {
+        return STRAIGHT_HOLD_HEADING;
+    }
+    float h = a->heading0 - 90.0f + (90.0f * (float)a->corners);
+    while (h < 0.0f)    h += 360.0f;
+    while (h >= 360.0f) h -= 360.0f;
+    return h;
+}
+
+static void leg_begin_(avoid_ctx_t *a)
+{
+    a->seen      = false;
+    a->clear_cnt = 0;
+    straight_start(SIDE_MAX_LEG_CM, leg_heading_(a), AVOID_LEG_PCT);
+    avoid_enter_(a, AV_PHASE_LEG);
+}
+
+/* Physical edges sit about the middle of the edge bearings, the same span
+ * calculate_object_width_() uses. */
+static bool bypass_begin_(const scan_sm_t *s)
+{
+    if ((s->res.width_cm <= 0.0f) || (s->front_cm <= 0.0f))
+    {
+        return false;
     }
-    servo_set_angle_(SERVO_CENTER_DEG);
-    sleep_ms(200);
-    return detected;
+    float mid  = (0.5f * (s->res.left_angle + s->res.right_angle)) - SERVO_CENTER_DEG;
+    float half = edge_half_span_deg_(s->res.left_angle, s->res.right_angle);
+    int16_t sin_l, sin_r;
+    fx_sincos(FX_DEG(mid + half), &sin_l, NULL);
+    fx_sincos(FX_DEG(half - mid), &sin_r, NULL);
+
+    bypass_obstacle_t obs;
+    obs.front_cm        = s->front_cm;
+    obs.left_extent_cm  = s->res.left_distance * FX_Q15_TO_F(sin_l);
+    obs.right_extent_cm = s->res.right_distance * FX_Q15_TO_F(sin_r);
+    obs.width_cm        = s->res.width_cm;
+    return bypass_plan(&obs);
+}
+
+/* Turn that restores the heading held at avoid_start(): out +90, in -90 per
+ * corner (CCW positive, as turn_start()). */
+static float rejoin_pivot_deg_(const avoid_ctx_t *a)
+{
+    float ang = (90.0f * (float)a->corners) - 90.0f;
+    while (ang > 180.0f)   ang -= 360.0f;
+    while (ang <= -180.0f) ang += 360.0f;
+    return ang;
+}
+
+static void rejoin_begin_(avoid_ctx_t *a)
+{
+    servo_set_angle(SERVO_CENTER_DEG);
+    straight_start(AVOID_REJOIN_FWD_CM, leg_heading_(a), AVOID_REJOIN_PCT);
+    avoid_enter_(a, AV_PHASE_REJOIN_FWD);
 }
 
 /* ==============================
- * Encircle Logic
+ * Public Entry (Obstacle Only)
  * ============================== */
-static void encircle_object_with_checking_(void)
+bool check_obstacle_detection(void)
 {
-    bool continue_circling = true;
-    uint32_t check_counter = 0;
-    uint32_t no_object_counter = 0;
-    const uint32_t REQUIRED_NO_OBJECT_CHECKS = 2;
-    uint8_t turns_finished = 0;
+    return ultrasonic_detect_obstacle_fast();
+}
+
+void avoid_start(void)
+{
+    avoid_ctx_t *a = &g_avoid;
+    a->status          = AVOID_RUNNING;
+    a->start_ms        = to_ms_since_boot(get_absolute_time());
+    a->corners         = 0;
+    a->side_seq        = 0;
+    a->side_ping_ok_at = get_absolute_time();
+    a->heading0        = straight_heading_now();
+    a->note[0]         = '\0';
+    scan_start_(&a->scan);
+    avoid_enter_(a, AV_PHASE_SCAN);
+}
 
-    while (continue_circling)
+void avoid_abort(void)
+{
+    if (g_avoid.status == AVOID_RUNNING)
     {
-        check_counter++;
+        bypass_abort();
+        turn_abort();
+        straight_abort();
+        all_stop();
+        servo_set_angle(SERVO_CENTER_DEG);
+        g_avoid.phase  = AV_PHASE_FINISHED;
+        g_avoid.status = AVOID_FAILED;
+    }
+}
 
-        encoder_reset_distance(ENCODER_LEFT_GPIO);
-        encoder_reset_distance(ENCODER_RIGHT_GPIO);
-        drive_signed(CIRCLE_BASE_SPEED_LEFT, CIRCLE_BASE_SPEED_RIGHT);
+const char *avoid_take_note(void)
+{
+    static char out[AVOID_NOTE_LEN];
+    if (g_avoid.note[0] == '\0')
+    {
+        return NULL;
+    }
+    memcpy(out, g_avoid.note, sizeof(out));
+    g_avoid.note[0] = '\0';
+    return out;
+}
 
-        while (get_average_pulses_() < CIRCLE_TARGET_PULSES)
-        {
-            if (turns_finished >= 2)
-            {
-                uint16_t ir_raw = ir_read_raw();
-                int color_state = classify_colour(ir_raw);
-                if (color_state == 1) /* black line */
-                {
-                    continue_circling = false;
-                    break;
-                }
-            }
-            sleep_ms(10);
-        }
-        all_stop();
-        sleep_ms(2000);
+const char *avoid_phase_name(void)
+{
+    static const char *const names[] =
+    {
+        "AV_SCAN", "AV_BYPASS", "AV_OUT", "AV_LEG", "AV_CORNER", "AV_IN",
+        "AV_FWD", "AV_PIVOT", "AV_DONE"
+    };
+    return names[g_avoid.phase];
+}
 
-        if (!continue_circling) break;
+/* One step of the avoidance sequence; every phase exits on encoder distance,
+ * a sensor event or elapsed time, never by sleeping. */
+avoid_status_t avoid_tick(void)
+{
+    avoid_ctx_t *a = &g_avoid;
+    if (a->status != AVOID_RUNNING)
+    {
+        return a->status;
+    }
 
-        bool object_still_there = check_if_object_still_there_();
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    if ((now - a->start_ms) > AVOID_TIMEOUT_MS)
+    {
+        printf("[AVOID] timeout in %s\n", avoid_phase_name());
+        avoid_abort();
+        return a->status;
+    }
 
-        if (object_still_there)
-        {
-            no_object_counter = 0;
-            turn_left_90_degrees();
-        }
-        else
+    switch (a->phase)
+    {
+        case AV_PHASE_SCAN:
         {
-            no_object_counter++;
-            if ((no_object_counter >= REQUIRED_NO_OBJECT_CHECKS) && (turns_finished < 2))
+            if (!scan_step_(&a->scan))
             {
-                drive_signed(CIRCLE_BASE_SPEED_LEFT, CIRCLE_BASE_SPEED_RIGHT);
-                while (get_average_pulses_() < CIRCLE_TARGET_PULSES)
-                {
-                    sleep_ms(10);
-                }
-                all_stop();
-                no_object_counter = 0;
-                turns_finished++;
+                break;
             }
-            else
+            if (a->scan.res.width_cm > 0.0f)
             {
-                turn_left_90_degrees();
+                snprintf(a->note, sizeof(a->note), "OBW:%.1fcm", a->scan.res.width_cm);
             }
+            /* Drive round on a smooth path when the object was measured and
+             * the map agrees; otherwise fall back to side-stepping it. */
+            if (bypass_begin_(&a->scan))
+            {
+                servo_set_angle(SERVO_CENTER_DEG);
+                avoid_enter_(a, AV_PHASE_BYPASS);
+                break;
+            }
+            /* Swing the sensor while the chassis turns */
+            servo_set_angle(side_uses_servo_() ? AVOID_SIDE_LOOK_DEG : SERVO_CENTER_DEG);
+            turn_start(90.0f);
+            avoid_enter_(a, AV_PHASE_TURN_OUT);
+            break;
         }
 
-        if (check_counter >= 15)
+        case AV_PHASE_BYPASS:
         {
-            drive_signed(BASE_SPEED_LEFT, BASE_SPEED_RIGHT);
-            sleep_ms(3000);
+            bypass_status_t bs = bypass_tick();
+            if ((bs == BYPASS_RUNNING) && bypass_returning() &&
+                (classify_colour(ir_read_raw()) == 1)) /* black line */
+            {
+                bypass_abort();
+                bs = BYPASS_DONE;
+            }
+            if (bs == BYPASS_RUNNING)
+            {
+                break;
+            }
             all_stop();
-            continue_circling = false;
+            avoid_enter_(a, AV_PHASE_FINISHED);
+            a->status = (bs == BYPASS_DONE) ? AVOID_DONE : AVOID_FAILED;
+            printf("[AVOID] bypass %s in %lums\n",
+                   (bs == BYPASS_DONE) ? "done" : "failed",
+                   (unsigned long)(now - a->start_ms));
+            break;
         }
-        sleep_ms(500);
-    }
-    all_stop();
-}
 
-/* ==============================
- * Complete Avoidance Cycle
- * ============================== */
-static void complete_avoidance_cycle_(void)
-{
-    bool cycle_active = true;
-    while (cycle_active)
-    {
-        bool approach_active      = true;
-        bool object_initial_detect = false;
+        case AV_PHASE_TURN_OUT:
+            if (turn_tick() != TURN_RUNNING)
+            {
+                leg_begin_(a);
+            }
+            break;
 
-        while (approach_active)
+        case AV_PHASE_LEG:
         {
-            float distance = ultrasonic_get_distance_cm();
-            if (distance < 0.0f)
+            float d;
+            if (side_sample_(a, &d))
             {
-                if (!object_initial_detect)
+                if (obstacle_detected_(d))
                 {
-                    drive_signed(BASE_SPEED_LEFT, BASE_SPEED_RIGHT);
+                    a->seen      = true;
+                    a->clear_cnt = 0;
                 }
-            }
-            else if (object_at_stop_distance_(distance))
-            {
-                all_stop();
-                approach_active        = false;
-                object_initial_detect   = true;
-                mqtt_publish_telemetry(get_current_speed_cm_s(),
-                                       get_total_distance_cm(),
-                                       0.0f, distance,
-                                       "scan");
-                ObjectScanResult scan = scan_object_width_();
-                if (scan.width_cm > 0.0f)
+                else
                 {
-                    char width_str[40];
-                    snprintf(width_str, sizeof(width_str),
-                             "objw:%.1fcm", scan.width_cm);
-                    mqtt_publish_telemetry(get_current_speed_cm_s(),
-                                           get_total_distance_cm(),
-                                           0.0f, distance,
-                                           width_str);
-                    sleep_ms(1000);
+                    a->clear_cnt++;
                 }
             }
-            else if (obstacle_detected_(distance))
+
+            if ((a->corners >= 2u) && (classify_colour(ir_read_raw()) == 1)) /* black line */
             {
-                drive_signed(BASE_SPEED_LEFT, BASE_SPEED_RIGHT);
-                object_initial_detect = true;
+                rejoin_begin_(a);
+                break;
             }
-            else
+
+            bool ended  = (straight_tick() != STRAIGHT_RUNNING);
+            bool passed = a->seen && (a->clear_cnt >= SIDE_CLEAR_SAMPLES);
+            bool lost   = !a->seen && ended;
+            if (passed || lost)
             {
-                drive_signed(BASE_SPEED_LEFT, BASE_SPEED_RIGHT);
+                /* Keep driving to carry the chassis past the corner */
+                straight_start(SIDE_CORNER_CLEAR_CM, leg_heading_(a), AVOID_LEG_PCT);
+                avoid_enter_(a, AV_PHASE_CORNER_CLEAR);
             }
-            sleep_ms(50);
+            else if (ended)
+            {
+                /* Still alongside the object: extend the leg */
+                straight_start(SIDE_MAX_LEG_CM, leg_heading_(a), AVOID_LEG_PCT);
+            }
+            break;
         }
 
-        sleep_ms(1000);
-        turn_left_90_degrees();
-        sleep_ms(1000);
+        case AV_PHASE_CORNER_CLEAR:
+            if (straight_tick() != STRAIGHT_RUNNING)
+            {
+                turn_start(-90.0f);
+                avoid_enter_(a, AV_PHASE_TURN_IN);
+            }
+            break;
+
+        case AV_PHASE_TURN_IN:
+            if (turn_tick() != TURN_RUNNING)
+            {
+                if (++a->corners >= SIDE_MAX_CORNERS)
+                {
+                    rejoin_begin_(a);
+                }
+                else
+                {
+                    leg_begin_(a);
+                }
+            }
+            break;
 
-        encircle_object_with_checking_();
+        case AV_PHASE_REJOIN_FWD:
+            if (straight_tick() != STRAIGHT_RUNNING)
+            {
+                turn_start(rejoin_pivot_deg_(a));
+                avoid_enter_(a, AV_PHASE_REJOIN_PIVOT);
+            }
+            break;
 
-        cycle_active = false;
-        servo_set_angle_(SERVO_CENTER_DEG);
-        sleep_ms(2000);
-        drive_signed(40.0f, 40.0f);
-        sleep_ms(500);
-        drive_signed(-40.0f, 60.0f);
-        sleep_ms(500);
-        all_stop();
-        sleep_ms(2000);
-    }
-}
+        case AV_PHASE_REJOIN_PIVOT:
+        {
+            turn_status_t ts = turn_tick();
+            if (ts != TURN_RUNNING)
+            {
+                all_stop();
+                avoid_enter_(a, AV_PHASE_FINISHED);
+                a->status = AVOID_DONE;
+                printf("[AVOID] done in %lums, %lu corners%s\n",
+                       (unsigned long)(now - a->start_ms), (unsigned long)a->corners,
+                       (ts == TURN_TIMEOUT) ? " (pivot timeout)" : "");
+            }
+            break;
+        }
 
-/* ==============================
- * Public Entry (Obstacle Only)
- * ============================== */
-bool check_obstacle_detection(void)
-{
-    return ultrasonic_detect_obstacle_fast();
+        default:
+            break;
+    }
+    return a->status;
 }
 
+/* Blocking wrapper for callers outside the control loop. */
 void avoid_obstacle_only(void)
 {
-    ObjectScanResult scan = scan_object_width_();
-    if (scan.width_cm > 0.0f)
+    avoid_start();
+    while (avoid_tick() == AVOID_RUNNING)
     {
-        char width_str[60];
-        snprintf(width_str, sizeof(width_str),
-                 "OBW:%.1fcm", scan.width_cm);
-        mqtt_publish_telemetry(get_current_speed_cm_s(),
-                               get_total_distance_cm(),
-                               0.0f,
-                               ultrasonic_get_distance_cm(),
-                               width_str);
-        sleep_ms(500);
+        vTaskDelay(pdMS_TO_TICKS(AVOID_TICK_MS));
     }
-
-    turn_left_90_degrees();
-    sleep_ms(800);
-    encircle_object_with_checking_();
-    servo_set_angle_(SERVO_CENTER_DEG);
-    sleep_ms(2000);
-    drive_signed(50.0f, 50.0f);
-    sleep_ms(700);
-    drive_signed(-40.0f, 60.0f);
-    sleep_ms(400);
-    all_stop();
-    sleep_ms(1000);
 }
 
 /*** end of file ***/
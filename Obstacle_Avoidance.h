@@ -3,11 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-
-// Servo configuration
-#define SERVO_PIN 15
-#define SERVO_MIN_PULSE_US 500
-#define SERVO_MAX_PULSE_US 2500
+#include "servo.h"
 
 // Motor speeds
 #define BASE_SPEED_LEFT 32.75f
@@ -45,10 +41,6 @@ typedef struct {
     float width_cm;
 } ObjectScanResult;
 
-// Servo functions
-void servo_init(void);
-void servo_set_angle(float angle);
-
 // Encoder functions
 void update_encoder_counts(void);
 void reset_encoder_counts(void);
@@ -93,6 +85,28 @@ float pid_calculation(uint16_t ir_value);
 
 // Add these to Obstacle_Avoidance.h
 bool check_obstacle_detection(void);
+
+// Tick-driven avoidance: scan, side-step around the object, rejoin the line.
+// avoid_tick() is called once per control cycle and never blocks.
+typedef enum {
+    AVOID_IDLE = 0,
+    AVOID_RUNNING,
+    AVOID_DONE,
+    AVOID_FAILED
+} avoid_status_t;
+
+void avoid_start(void);
+avoid_status_t avoid_tick(void);
+void avoid_abort(void);
+const char *avoid_phase_name(void);
+
+// Status line produced by the last avoid_tick() (e.g. "OBW:23.5cm" after the
+// scan), or NULL. The caller hands it to telemetry; avoidance itself never
+// publishes. Valid until the next call.
+#define AVOID_NOTE_LEN 16
+const char *avoid_take_note(void);
+
+// Blocking wrapper around avoid_start()/avoid_tick()
 void avoid_obstacle_only(void);
 // Add these to Obstacle_Avoidance.h
 float get_current_speed_cm_s(void);
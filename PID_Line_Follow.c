@@ -12,11 +12,11 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include <stdio.h>
 #include "pico/stdlib.h"
 #include "motor_encoder_demo.h"
 #include "ir_sensor.h"
 #include "PID_Line_Follow.h"
+#include "trace.h"
 
 /* ==============================
  * Configuration Constants
@@ -32,7 +32,6 @@
 #define PID_WHITE_RAMP_RATE     (0.125f)
 #define PID_MAX_INTEGRAL        (1000.0f)
 #define PID_MAX_DERIVATIVE      (1000.0f)
-#define PID_PRINT_INTERVAL_US   (100000U)   /* 100 ms */
 
 /* ==============================
  * Static State
@@ -113,18 +112,9 @@ static void pid_drive_(float correction, uint16_t ir_raw)
     if (left_speed  > 80.0f) left_speed  = 80.0f;
     if (right_speed > 80.0f) right_speed = 80.0f;
 
-    static uint32_t last_print_us = 0;
-    uint32_t now_us = time_us_32();
-    if ((now_us - last_print_us) > PID_PRINT_INTERVAL_US) {
-        printf("[PID] IR:%4u E:%4d C:%6.2f L:%5.2f R:%5.2f W:%4.2f\n",
-               ir_raw,
-               (int)(PID_SETPOINT_RAW - ir_raw),
-               correction,
-               left_speed,
-               right_speed,
-               white_ramp);
-        last_print_us = now_us;
-    }
+    /* Traced every step: no float formatting on the control path */
+    TRACE(TR_PID, ir_raw, TRACE_CENTI(correction),
+          TRACE_CENTI(left_speed), TRACE_CENTI(right_speed));
 
     drive_signed(left_speed, right_speed);
 }
@@ -0,0 +1,271 @@
+/** @file attitude.c
+ *  @brief 100 Hz complementary attitude filter: rate propagation + compass/tilt correction.
+ *
+ *  NOTE: Barr-C style. Trig and square roots go through fxmath (integer
+ *        tables) rather than soft-float libm; the rest is plain float with
+ *        no matrix maths.
+ *        Gyro bias is tracked while the motors are idle. Accel/mag arrive as
+ *        timestamped FIFO batches from the IMU driver and are drained without
+ *        waiting, so the 100 Hz prediction never blocks on the bus.
+ *        Also the only caller of odometry_update(): the pose is integrated
+ *        at 100 Hz whatever rate its readers (map, bypass) run at.
+ *  WARNING: Without a gyro the yaw rate is the encoder differential, so
+ *           wheel slip shows up as heading error until the compass pulls it back.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "attitude.h"
+#include "imu_raw_demo.h"
+#include "odometry.h"
+#include "motor_encoder_demo.h"
+#include "magcal.h"
+#include "fxmath.h"
+#include "supervisor.h"
+
+/* ==============================
+ * Filter Configuration
+ * ============================== */
+#define ATT_MAG_GAIN_IDLE        (0.02f)    /* ~0.5 s time constant at 100 Hz */
+#define ATT_MAG_GAIN_DRIVE       (0.002f)   /* motors distort the field */
+#define ATT_DRIVE_PCT            (5.0f)     /* |command| above this = driving */
+#define ATT_TILT_GAIN            (0.05f)
+#define ATT_FIELD_GATE           (0.25f)    /* reject |B| off reference by 25% */
+#define ATT_FIELD_REF_ALPHA      (0.001f)
+#define ATT_MAG_SPAN_MAX         (10.0f)    /* cap catch-up after a compass gap */
+#define ATT_GYRO_DPS_PER_LSB     (0.00875f) /* L3GD20 +/-250 dps */
+#define ATT_GYRO_BIAS_ALPHA      (0.01f)
+#define ATT_YAW_RATE_SIGN        (-1.0f)    /* CCW body rate -> clockwise yaw */
+#define ATT_RAD_TO_DEG           (180.0f / (float)M_PI)
+#define ATT_STACK_WORDS          (1024u)
+
+/* ==============================
+ * Static State
+ * ============================== */
+static attitude_t    g_att         = { 0 };
+static volatile bool g_running     = false;
+static volatile bool g_snap_yaw    = true;
+static float         g_field_ref   = 0.0f;
+#if IMU_HAS_GYRO
+static float         g_gyro_bias_z = 0.0f;
+#endif
+static StackType_t   g_stack[ATT_STACK_WORDS];
+static StaticTask_t  g_tcb;
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static void  attitude_task_(void *pv);
+static float wrap360_(float a);
+static float wrap180_(float a);
+static float yaw_rate_dps_(bool driving);
+static bool  compass_yaw_(const imu_sample_t *m, float pitch_deg, float roll_deg,
+                          float *yaw_deg);
+static void  tilt_update_(attitude_t *st, const imu_sample_t *a);
+
+/* ==============================
+ * Helpers
+ * ============================== */
+static float wrap360_(float a)
+{
+    while (a < 0.0f)    a += 360.0f;
+    while (a >= 360.0f) a -= 360.0f;
+    return a;
+}
+
+static float wrap180_(float a)
+{
+    while (a > 180.0f)   a -= 360.0f;
+    while (a <= -180.0f) a += 360.0f;
+    return a;
+}
+
+static float yaw_rate_dps_(bool driving)
+{
+#if IMU_HAS_GYRO
+    int16_t gx, gy, gz;
+    if (read_gyro_raw(&gx, &gy, &gz))
+    {
+        float rate = (float)gz * ATT_GYRO_DPS_PER_LSB;
+        if (!driving)
+        {
+            g_gyro_bias_z += ATT_GYRO_BIAS_ALPHA * (rate - g_gyro_bias_z);
+        }
+        return ATT_YAW_RATE_SIGN * (rate - g_gyro_bias_z);
+    }
+#else
+    (void)driving;
+#endif
+    odom_pose_t p;
+    odometry_get_pose(&p);
+    return ATT_YAW_RATE_SIGN * p.w_rad_s * ATT_RAD_TO_DEG;
+}
+
+/* Tilt-compensated heading, same convention as calc_yaw_() in IMU_movement.c. */
+static bool compass_yaw_(const imu_sample_t *m, float pitch_deg, float roll_deg,
+                         float *yaw_deg)
+{
+    float fx, fy, fz;
+    magcal_apply(m->x, m->y, m->z, &fx, &fy, &fz);
+    int32_t x = (int32_t)fx;
+    int32_t y = (int32_t)fy;
+    int32_t z = (int32_t)fz;
+    float norm = (float)fx_sqrt_u32((uint32_t)((x * x) + (y * y) + (z * z)));
+    if (g_field_ref <= 0.0f)
+    {
+        g_field_ref = norm;
+    }
+    if (fabsf(norm - g_field_ref) > (ATT_FIELD_GATE * g_field_ref))
+    {
+        return false;
+    }
+    g_field_ref += ATT_FIELD_REF_ALPHA * (norm - g_field_ref);
+
+    int16_t sp, cp, sr, cr;
+    fx_sincos(FX_DEG(pitch_deg), &sp, &cp);
+    fx_sincos(FX_DEG(roll_deg),  &sr, &cr);
+
+    /* Q15 products; |B| < 2^12 LSB */
+    int32_t hx = (x * cp) + (z * sp);
+    int32_t hy = (int32_t)(((int64_t)sr * ((x * sp) - (z * cp))) >> 15) + (y * cr);
+    *yaw_deg = wrap360_(FX_TO_DEG(fx_atan2_deg(-hy, hx)));
+    return true;
+}
+
+/* Tilt: low-passed accelerometer angles (no gyro roll/pitch needed for a
+ * ground robot). Gain is per 100 Hz sample. */
+static void tilt_update_(attitude_t *st, const imu_sample_t *a)
+{
+    int32_t  ax = a->x, ay = a->y, az = a->z;
+    uint32_t yz = fx_sqrt_u32((uint32_t)((ay * ay) + (az * az)));
+    float pitch = FX_TO_DEG(fx_atan2_deg(-ax, (int32_t)yz));
+    float roll  = FX_TO_DEG(fx_atan2_deg(ay, az));
+    st->pitch_deg += ATT_TILT_GAIN * wrap180_(pitch - st->pitch_deg);
+    st->roll_deg  += ATT_TILT_GAIN * wrap180_(roll - st->roll_deg);
+}
+
+/* ==============================
+ * Task
+ * ============================== */
+static void attitude_task_(void *pv)
+{
+    (void)pv;
+    TickType_t last_wake   = xTaskGetTickCount();
+    uint32_t   last_us     = time_us_32();
+    uint32_t   last_mag_us = last_us;
+    attitude_t st          = { 0 };
+
+    while (1)
+    {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(ATTITUDE_PERIOD_MS));
+        supervisor_beat(SUP_ATTITUDE);
+
+        uint32_t now_us = time_us_32();
+        float    dt_s   = (float)(now_us - last_us) * 1e-6f;
+        last_us = now_us;
+
+        float lcmd, rcmd;
+        motor_get_command(&lcmd, &rcmd);
+        bool driving = (fabsf(lcmd) > ATT_DRIVE_PCT) || (fabsf(rcmd) > ATT_DRIVE_PCT);
+
+        /* Drain whatever the driver has completed since the last tick */
+        imu_batch_t  b;
+        imu_sample_t mag;
+        bool         have_mag = false;
+        while (imu_get_batch(&b, 0))
+        {
+            for (uint8_t i = 0; i < b.n_accel; i++)
+            {
+                tilt_update_(&st, &b.accel[i]);
+            }
+            if (b.mag_valid)
+            {
+                mag      = b.mag;
+                have_mag = true;
+            }
+        }
+
+        /* Predict (odometry integrated here so the encoder rate shares dt) */
+        odometry_update();
+        st.yaw_rate_dps = yaw_rate_dps_(driving);
+        st.yaw_deg      = wrap360_(st.yaw_deg + (st.yaw_rate_dps * dt_s));
+
+        /* Correct (gain scaled to the time since the last compass sample) */
+        float mag_yaw;
+        st.mag_ok = have_mag && compass_yaw_(&mag, st.pitch_deg, st.roll_deg, &mag_yaw);
+        if (st.mag_ok)
+        {
+            st.mag_yaw_deg = mag_yaw;
+            if (g_snap_yaw)
+            {
+                st.yaw_deg = mag_yaw;
+                g_snap_yaw = false;
+            }
+            else
+            {
+                float span = (float)(mag.t_us - last_mag_us) * 1e-6f /
+                             ((float)ATTITUDE_PERIOD_MS * 1e-3f);
+                float k    = (driving ? ATT_MAG_GAIN_DRIVE : ATT_MAG_GAIN_IDLE) *
+                             fminf(fmaxf(span, 1.0f), ATT_MAG_SPAN_MAX);
+                st.yaw_deg = wrap360_(st.yaw_deg + (k * wrap180_(mag_yaw - st.yaw_deg)));
+            }
+            last_mag_us = mag.t_us;
+        }
+        st.timestamp_us = now_us;
+
+        taskENTER_CRITICAL();
+        g_att = st;
+        taskEXIT_CRITICAL();
+        g_running = !g_snap_yaw;    /* yaw means nothing until the compass snap */
+    }
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+bool attitude_start(uint32_t priority)
+{
+    odometry_init();
+    if (xTaskCreateStatic(attitude_task_, "attitude", ATT_STACK_WORDS, NULL, priority,
+                          g_stack, &g_tcb) == NULL)
+    {
+        printf("[ATT] task create failed\n");
+        return false;
+    }
+    printf("[ATT] %u Hz, rate from %s\n", 1000u / ATTITUDE_PERIOD_MS,
+           IMU_HAS_GYRO ? "gyro" : "encoders");
+    return true;
+}
+
+bool attitude_running(void)
+{
+    return g_running;
+}
+
+void attitude_get(attitude_t *out)
+{
+    if (out == NULL) return;
+    taskENTER_CRITICAL();
+    *out = g_att;
+    taskEXIT_CRITICAL();
+}
+
+float attitude_get_yaw_deg(void)
+{
+    attitude_t a;
+    attitude_get(&a);
+    return a.yaw_deg;
+}
+
+void attitude_reset_yaw(void)
+{
+    g_snap_yaw = true;
+    g_running  = false;
+}
+
+/*** end of file ***/
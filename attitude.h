@@ -0,0 +1,56 @@
+//attitude.h
+
+/*
+Fixed-rate attitude estimator (complementary filter).
+
+Yaw is propagated from a rate source at 100 Hz and pulled towards the
+tilt-compensated compass heading with a small gain. The rate comes from
+the gyro when one is fitted (IMU_HAS_GYRO), otherwise from the wheel
+encoder yaw rate, so heading stays responsive on the accel+mag-only
+LSM303. The compass gain is cut while the motors are driven and compass
+samples with a disturbed field magnitude are ignored.
+
+Angles follow read_imu_data(): yaw 0..360 deg clockwise (compass).
+ */
+
+#ifndef ATTITUDE_H
+#define ATTITUDE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef IMU_HAS_GYRO
+#define IMU_HAS_GYRO 0
+#endif
+
+#define ATTITUDE_PERIOD_MS   10u
+
+typedef struct {
+    float    yaw_deg;         // Fused heading 0..360
+    float    pitch_deg;
+    float    roll_deg;
+    float    yaw_rate_dps;    // Rate used for propagation (clockwise positive)
+    float    mag_yaw_deg;     // Last accepted compass heading
+    uint32_t timestamp_us;
+    bool     mag_ok;          // Last compass sample passed the field gate
+} attitude_t;
+
+// Create the estimator task (after imu_init()). The task also integrates
+// odometry, so this resets the pose and must precede odometry readers.
+bool attitude_start(uint32_t priority);
+
+// True once the yaw has been snapped to the compass (again false after
+// attitude_reset_yaw() until the next good compass sample).
+bool attitude_running(void);
+
+// Consistent snapshot of the estimate.
+void attitude_get(attitude_t *out);
+
+// Fused yaw (deg, 0..360).
+float attitude_get_yaw_deg(void);
+
+// Snap the fused yaw to the compass (e.g. after calibration); callers fall
+// back to their own heading source until it has happened.
+void attitude_reset_yaw(void);
+
+#endif
@@ -13,6 +13,7 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
 
 #include "barcode.h"
 #include "ir_sensor.h"
@@ -20,6 +21,9 @@
 #include "PID_Line_Follow.h"
 #include "mqtt_client.h"
 #include "encoder.h"
+#include "evbus.h"
+#include "diag.h"
+#include "smp.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -75,6 +79,7 @@ static volatile uint32_t g_last_edge_us   = 0;
 static volatile uint16_t g_transition_cnt = 0;
 static volatile uint32_t g_durations[MAX_TRANSITIONS];
 static volatile bool     g_frame_ready    = false;
+static volatile alarm_id_t g_quiet_alarm  = 0;
 
 /* ==============================
  * Private Types
@@ -91,7 +96,9 @@ typedef enum
  * ============================== */
 static int        code39_value_(char c);
 static char       code39_match_pattern_(const char *p);
-static void       barcode_gpio_isr_(uint gpio, uint32_t events);
+static void       barcode_gpio_isr_(void);
+static int64_t    quiet_alarm_cb_(alarm_id_t id, void *user);
+static void       frame_end_isr_(void);
 static uint32_t   estimate_narrow_us_(const uint32_t *w, uint16_t n);
 static width_t    classify_width_(uint32_t dur_us, uint32_t narrow_us);
 static bool       decode_symbols_(const uint32_t *dur, uint16_t n, char *out,
@@ -133,13 +140,30 @@ static char code39_match_pattern_(const char *p)
 /* ==============================
  * Interrupt ISR
  * ============================== */
-static void barcode_gpio_isr_(uint gpio, uint32_t events)
+/* Raw handler: shares IO_IRQ_BANK0 with the encoder callback and the
+ * ultrasonic echo handler. */
+static void barcode_gpio_isr_(void)
 {
-    (void)events;
-    if (gpio != BARCODE_IRQ_NOT_PIN)
+    uint32_t ev = gpio_get_irq_event_mask(BARCODE_IRQ_NOT_PIN) &
+                  (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+    if (ev == 0u)
     {
         return;
     }
+    gpio_acknowledge_irq(BARCODE_IRQ_NOT_PIN, ev);
+
+    if (g_frame_ready)
+    {
+        return;     /* hold the captured frame until it is decoded */
+    }
+
+    /* Every edge pushes the end-of-frame deadline out by the quiet gap */
+    if (g_quiet_alarm > 0)
+    {
+        alarm_pool_cancel_alarm(smp_alarm_pool(), g_quiet_alarm);
+    }
+    g_quiet_alarm = alarm_pool_add_alarm_in_us(smp_alarm_pool(), BARCODE_QUIET_US,
+                                               quiet_alarm_cb_, NULL, true);
 
     uint32_t now = time_us_32();
     if (!g_capturing)
@@ -159,9 +183,40 @@ static void barcode_gpio_isr_(uint gpio, uint32_t events)
     }
     else
     {
-        g_frame_ready  = true;
-        g_capturing    = false;
+        frame_end_isr_();
+    }
+}
+
+DIAG_ISR_TIMED(barcode_isr_timed_, DIAG_ISR_BARCODE, barcode_gpio_isr_)
+
+static int64_t quiet_alarm_cb_(alarm_id_t id, void *user)
+{
+    (void)id;
+    (void)user;
+    g_quiet_alarm = 0;
+    if (g_capturing)
+    {
+        frame_end_isr_();
     }
+    return 0;
+}
+
+/* Short captures are edge noise, not a frame: drop them silently. */
+static void frame_end_isr_(void)
+{
+    BaseType_t woken = pdFALSE;
+    g_capturing = false;
+    if (g_quiet_alarm > 0)
+    {
+        alarm_pool_cancel_alarm(smp_alarm_pool(), g_quiet_alarm);
+        g_quiet_alarm = 0;
+    }
+    if (g_transition_cnt >= BARCODE_MIN_TRANSITIONS)
+    {
+        g_frame_ready = true;
+        (void)evbus_post_from_isr(EVBUS_BARCODE_FRAME, g_transition_cnt, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
 }
 
 /* ==============================
@@ -179,16 +234,31 @@ void barcode_irq_init(void)
     gpio_init(RIGHT_IR_DIGITAL_PIN);
     gpio_set_dir(RIGHT_IR_DIGITAL_PIN, GPIO_IN);
     gpio_pull_up(RIGHT_IR_DIGITAL_PIN);
-    gpio_set_irq_enabled_with_callback(RIGHT_IR_DIGITAL_PIN,
-                                       GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL,
-                                       true,
-                                       &barcode_gpio_isr_);
+    gpio_add_raw_irq_handler(RIGHT_IR_DIGITAL_PIN, barcode_isr_timed_);
+    gpio_acknowledge_irq(RIGHT_IR_DIGITAL_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+    gpio_set_irq_enabled(RIGHT_IR_DIGITAL_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
     printf("[BARCODE] IRQ armed GPIO%d\n", RIGHT_IR_DIGITAL_PIN);
 }
 
+void barcode_reset_capture(void)
+{
+    uint32_t save = save_and_disable_interrupts();
+    if (g_quiet_alarm > 0)
+    {
+        alarm_pool_cancel_alarm(smp_alarm_pool(), g_quiet_alarm);
+        g_quiet_alarm = 0;
+    }
+    g_capturing      = false;
+    g_frame_ready    = false;
+    g_transition_cnt = 0;
+    restore_interrupts(save);
+}
+
 /* ==============================
  * Frame readiness check
  * ============================== */
+/* Polled fallback; with barcode_irq_init() the quiet alarm ends frames. */
 bool barcode_capture_ready(void)
 {
     if (g_frame_ready)
@@ -0,0 +1,101 @@
+/** @file boot.c
+ *  @brief Boot stage timestamps and the BASE_TOPIC/boot report.
+ *
+ *  NOTE: Barr-C style. Stamps are written once each, from the init, control
+ *        and network tasks; a stage that is already set is never touched
+ *        again, so readers need no lock.
+ *  WARNING: time_us_32() counts from reset, not from main(); the ROM and
+ *           runtime start-up before main() are included in every stamp.
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "boot.h"
+#include "mqtt_client.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define BOOT_JSON_MAX       (256u)
+
+/* ==============================
+ * Static State
+ * ============================== */
+static volatile uint32_t g_stamp_us[BOOT_STAGE_COUNT];
+static volatile bool     g_reached[BOOT_STAGE_COUNT];
+static char              g_json[BOOT_JSON_MAX];
+
+static const char *const g_stage_names[BOOT_STAGE_COUNT] =
+{
+    "stdio", "sensors", "imu", "calib", "tasks", "control", "radio", "wifi", "mqtt"
+};
+
+/* ==============================
+ * Public API
+ * ============================== */
+void boot_mark(boot_stage_t stage)
+{
+    if (stage >= BOOT_STAGE_COUNT)
+    {
+        return;
+    }
+    uint32_t now = time_us_32();
+    taskENTER_CRITICAL();
+    if (!g_reached[stage])
+    {
+        g_stamp_us[stage] = now;
+        g_reached[stage]  = true;
+    }
+    taskEXIT_CRITICAL();
+}
+
+bool boot_stage_ms(boot_stage_t stage, uint32_t *ms)
+{
+    if ((stage >= BOOT_STAGE_COUNT) || !g_reached[stage])
+    {
+        return false;
+    }
+    *ms = g_stamp_us[stage] / 1000u;
+    return true;
+}
+
+void boot_report(void)
+{
+    size_t len = 0;
+    int    w;
+
+    printf("[BOOT] stage      ms\n");
+    w = snprintf(g_json, sizeof(g_json), "{");
+    len += (w > 0) ? (size_t)w : 0u;
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++)
+    {
+        uint32_t ms;
+        if (!boot_stage_ms((boot_stage_t)i, &ms))
+        {
+            printf("[BOOT] %-8s      -\n", g_stage_names[i]);
+            continue;
+        }
+        printf("[BOOT] %-8s %6lu\n", g_stage_names[i], (unsigned long)ms);
+        if (len < sizeof(g_json))
+        {
+            w = snprintf(&g_json[len], sizeof(g_json) - len, "%s\"%s\":%lu",
+                         (len == 1u) ? "" : ",", g_stage_names[i], (unsigned long)ms);
+            len += (w > 0) ? (size_t)w : 0u;
+        }
+    }
+    if (len < sizeof(g_json))
+    {
+        w = snprintf(&g_json[len], sizeof(g_json) - len, "}");
+        len += (w > 0) ? (size_t)w : 0u;
+    }
+    if ((len < sizeof(g_json)) && mqtt_is_connected())
+    {
+        (void)mqtt_publish_raw("boot", g_json, (uint16_t)len, 1, true);
+    }
+}
+
+/*** end of file ***/
@@ -0,0 +1,45 @@
+//boot.h
+
+/*
+Boot sequencing and per-stage timing.
+
+Power-on brings up stdio, sensors and the control loop on the control core
+straight away; Wi-Fi and MQTT connect in the background on the networking
+core and retry until they succeed, so the robot can drive long before the
+broker is reachable.
+
+Each stage is stamped once, in milliseconds since reset, from whichever
+task reaches it. boot_report() prints the table and, when MQTT is up,
+publishes it retained to BASE_TOPIC/boot:
+  {"stdio":ms,"sensors":ms,...}     (stages not reached are left out)
+ */
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    BOOT_STDIO = 0,
+    BOOT_SENSORS,                // GPIO / PWM / ultrasonic / IR / barcode
+    BOOT_IMU,
+    BOOT_CALIB,                  // magcal loaded (or first-boot spin), servo
+    BOOT_TASKS,                  // sensing, motion and diagnostics tasks
+    BOOT_CONTROL,                // first control step: the robot can drive
+    BOOT_RADIO,                  // cyw43 firmware up
+    BOOT_WIFI,                   // joined the access point
+    BOOT_MQTT,                   // broker accepted the connection
+    BOOT_STAGE_COUNT
+} boot_stage_t;
+
+// Stamp a stage (first call wins; safe from any task).
+void boot_mark(boot_stage_t stage);
+
+// Milliseconds since reset at which 'stage' was reached, false if not yet.
+bool boot_stage_ms(boot_stage_t stage, uint32_t *ms);
+
+// Print the table; publish it retained when MQTT is connected.
+void boot_report(void);
+
+#endif
@@ -0,0 +1,254 @@
+/** @file bypass.c
+ *  @brief Raised-cosine bypass path planner and pure-pursuit tracker.
+ *
+ *  NOTE: Barr-C style. The path is frozen in the odometry frame at plan time;
+ *        the tracker only reads the pose (the mapping task integrates it).
+ *  WARNING: Object depth is not observable from the front scan; the pass leg
+ *           assumes max(width, BYPASS_MIN_DEPTH_CM).
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "pico/stdlib.h"
+
+#include "bypass.h"
+#include "odometry.h"
+#include "occgrid.h"
+#include "motor_encoder_demo.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define BYPASS_MAX_PCT        (100.0f)
+#define BYPASS_SIDE_LEFT      (1.0f)
+#define BYPASS_SIDE_RIGHT     (-1.0f)
+
+/* ==============================
+ * Static State
+ * ============================== */
+typedef struct
+{
+    float x_cm;
+    float y_cm;
+} waypoint_t;
+
+static waypoint_t      g_wp[BYPASS_MAX_WP];
+static uint32_t        g_wp_count   = 0;
+static uint32_t        g_wp_idx     = 0;     /* nearest waypoint, monotonic */
+static uint32_t        g_return_idx = 0;     /* first waypoint of the return leg */
+static uint32_t        g_start_ms   = 0;
+static bypass_status_t g_status     = BYPASS_IDLE;
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static float    ramp_(float u);
+static uint32_t build_path_(const bypass_obstacle_t *obs, float side,
+                            const odom_pose_t *p0);
+static bool     path_clear_(void);
+static float    dist2_(const odom_pose_t *p, const waypoint_t *w);
+
+/* ==============================
+ * Path Generation
+ * ============================== */
+
+/* Raised cosine 0..1: zero slope and curvature-continuous at both ends. */
+static float ramp_(float u)
+{
+    if (u <= 0.0f) return 0.0f;
+    if (u >= 1.0f) return 1.0f;
+    return 0.5f * (1.0f - cosf((float)M_PI * u));
+}
+
+static uint32_t build_path_(const bypass_obstacle_t *obs, float side,
+                            const odom_pose_t *p0)
+{
+    float extent = (side > 0.0f) ? obs->left_extent_cm : obs->right_extent_cm;
+    extent = fmaxf(extent, 0.0f);   /* edge already on the far side of centre */
+    float lat    = side * (extent + BYPASS_CLEARANCE_CM + BYPASS_HALF_WIDTH_CM);
+    float depth  = fmaxf(obs->width_cm, BYPASS_MIN_DEPTH_CM);
+
+    /* Axle positions: fully offset before the nose reaches the near face,
+     * back on the line once the tail has cleared the far face. */
+    float xa = fmaxf(obs->front_cm, 2.0f * BYPASS_WP_SPACING_CM);
+    float xb = obs->front_cm + (2.0f * BYPASS_SENSOR_X_CM) + depth;
+    float xc = xb + BYPASS_RETURN_CM;
+    float xd = xc + BYPASS_TAIL_CM;
+
+    float step = fmaxf(BYPASS_WP_SPACING_CM, xd / (float)BYPASS_MAX_WP);
+    float c    = cosf(p0->theta_rad);
+    float s    = sinf(p0->theta_rad);
+
+    uint32_t n = 0;
+    g_return_idx = 0;
+    for (float x = step; (x <= xd) && (n < BYPASS_MAX_WP); x += step)
+    {
+        float y;
+        if (x <= xa)
+        {
+            y = lat * ramp_(x / xa);
+        }
+        else if (x <= xb)
+        {
+            y = lat;
+        }
+        else
+        {
+            if (g_return_idx == 0u) g_return_idx = n;
+            y = lat * (1.0f - ramp_((x - xb) / BYPASS_RETURN_CM));
+        }
+        g_wp[n].x_cm = p0->x_cm + (x * c) - (y * s);
+        g_wp[n].y_cm = p0->y_cm + (x * s) + (y * c);
+        n++;
+    }
+    return n;
+}
+
+static bool path_clear_(void)
+{
+    for (uint32_t i = 1; i < g_wp_count; i++)
+    {
+        if (!occgrid_segment_clear(g_wp[i - 1u].x_cm, g_wp[i - 1u].y_cm,
+                                   g_wp[i].x_cm, g_wp[i].y_cm,
+                                   BYPASS_HALF_WIDTH_CM))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+bool bypass_plan(const bypass_obstacle_t *obs)
+{
+    if (obs == NULL)
+    {
+        return false;
+    }
+
+    odom_pose_t p0;
+    odometry_get_pose(&p0);
+
+    float first = (obs->left_extent_cm <= obs->right_extent_cm) ?
+                  BYPASS_SIDE_LEFT : BYPASS_SIDE_RIGHT;
+    float sides[2] = { first, -first };
+
+    for (uint32_t i = 0; i < 2u; i++)
+    {
+        g_wp_count = build_path_(obs, sides[i], &p0);
+        if ((g_wp_count >= 2u) && path_clear_())
+        {
+            g_wp_idx   = 0;
+            g_start_ms = to_ms_since_boot(get_absolute_time());
+            g_status   = BYPASS_RUNNING;
+            printf("[BYPASS] %s side, %lu wp, face %.0fcm\n",
+                   (sides[i] > 0.0f) ? "left" : "right",
+                   (unsigned long)g_wp_count, obs->front_cm);
+            return true;
+        }
+    }
+
+    g_status = BYPASS_FAILED;
+    printf("[BYPASS] no clear side\n");
+    return false;
+}
+
+static float dist2_(const odom_pose_t *p, const waypoint_t *w)
+{
+    float dx = w->x_cm - p->x_cm;
+    float dy = w->y_cm - p->y_cm;
+    return (dx * dx) + (dy * dy);
+}
+
+bypass_status_t bypass_tick(void)
+{
+    if (g_status != BYPASS_RUNNING)
+    {
+        return g_status;
+    }
+
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    if ((now - g_start_ms) > BYPASS_TIMEOUT_MS)
+    {
+        printf("[BYPASS] timeout at wp %lu/%lu\n",
+               (unsigned long)g_wp_idx, (unsigned long)g_wp_count);
+        bypass_abort();
+        return g_status;
+    }
+
+    odom_pose_t p;
+    odometry_get_pose(&p);
+
+    while (((g_wp_idx + 1u) < g_wp_count) &&
+           (dist2_(&p, &g_wp[g_wp_idx + 1u]) <= dist2_(&p, &g_wp[g_wp_idx])))
+    {
+        g_wp_idx++;
+    }
+
+    float c = cosf(p.theta_rad);
+    float s = sinf(p.theta_rad);
+
+    /* Done once the final waypoint is reached or already behind the axle */
+    const waypoint_t *last = &g_wp[g_wp_count - 1u];
+    float last_fwd = ((last->x_cm - p.x_cm) * c) + ((last->y_cm - p.y_cm) * s);
+    if ((g_wp_idx >= (g_wp_count - 2u)) &&
+        ((last_fwd <= BYPASS_GOAL_TOL_CM) ||
+         (dist2_(&p, last) <= (BYPASS_GOAL_TOL_CM * BYPASS_GOAL_TOL_CM))))
+    {
+        all_stop();
+        g_status = BYPASS_DONE;
+        printf("[BYPASS] done in %lums\n", (unsigned long)(now - g_start_ms));
+        return g_status;
+    }
+
+    /* Lookahead point: first waypoint at least one lookahead away */
+    uint32_t j = g_wp_idx;
+    while (((j + 1u) < g_wp_count) &&
+           (dist2_(&p, &g_wp[j]) < (BYPASS_LOOKAHEAD_CM * BYPASS_LOOKAHEAD_CM)))
+    {
+        j++;
+    }
+
+    float dx = g_wp[j].x_cm - p.x_cm;
+    float dy = g_wp[j].y_cm - p.y_cm;
+    float ly = (-s * dx) + (c * dy);
+    float l2 = (dx * dx) + (dy * dy);
+    float k  = (l2 > 1.0f) ? ((2.0f * ly) / l2) : 0.0f;
+
+    const float k_max = 1.0f / BYPASS_MIN_RADIUS_CM;
+    if (k >  k_max) k =  k_max;
+    if (k < -k_max) k = -k_max;
+
+    float diff  = k * ODOM_WHEEL_BASE_CM * 0.5f;
+    float left  = BYPASS_CRUISE_PCT * (1.0f - diff);
+    float right = BYPASS_CRUISE_PCT * (1.0f + diff);
+
+    /* Scale both wheels together so the curvature survives saturation */
+    float peak = fmaxf(fabsf(left * MOTOR_LEFT_TRIM), fabsf(right));
+    if (peak > BYPASS_MAX_PCT)
+    {
+        left  *= BYPASS_MAX_PCT / peak;
+        right *= BYPASS_MAX_PCT / peak;
+    }
+    drive_signed(left * MOTOR_LEFT_TRIM, right);
+    return g_status;
+}
+
+void bypass_abort(void)
+{
+    if (g_status == BYPASS_RUNNING)
+    {
+        all_stop();
+        g_status = BYPASS_FAILED;
+    }
+}
+
+bool bypass_returning(void)
+{
+    return (g_status == BYPASS_RUNNING) && (g_return_idx > 0u) &&
+           (g_wp_idx >= g_return_idx);
+}
+
+/*** end of file ***/
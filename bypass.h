@@ -0,0 +1,66 @@
+//bypass.h
+
+/*
+Smooth obstacle bypass: plans a continuous path around a scanned object and
+back onto the original line heading, then follows it with a pure-pursuit
+tracker on top of drive_signed().
+
+The path is an S-shaped lane change (raised-cosine lateral profile, so
+curvature is continuous and zero at both ends), a straight pass alongside
+the object, and a mirrored lane change back. It is laid down in the
+odometry frame at plan time and checked against the occupancy grid.
+ */
+
+#ifndef BYPASS_H
+#define BYPASS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Geometry (cm)
+#define BYPASS_CLEARANCE_CM     10.0f   // gap kept between chassis side and object
+#define BYPASS_HALF_WIDTH_CM     8.0f   // half chassis width
+#define BYPASS_SENSOR_X_CM       8.0f   // ultrasonic ahead of the wheel axle
+#define BYPASS_MIN_DEPTH_CM     15.0f   // assumed object depth when unknown
+#define BYPASS_RETURN_CM        40.0f   // length of the lane change back
+#define BYPASS_TAIL_CM          20.0f   // straight run-out on the line
+#define BYPASS_WP_SPACING_CM     4.0f
+#define BYPASS_MAX_WP           64u
+
+// Tracker
+#define BYPASS_LOOKAHEAD_CM     12.0f
+#define BYPASS_MIN_RADIUS_CM     8.0f
+#define BYPASS_CRUISE_PCT       40.0f
+#define BYPASS_GOAL_TOL_CM       4.0f
+#define BYPASS_TIMEOUT_MS     8000u
+
+typedef enum {
+    BYPASS_IDLE = 0,
+    BYPASS_RUNNING,
+    BYPASS_DONE,
+    BYPASS_FAILED
+} bypass_status_t;
+
+// Object as seen from the ultrasonic at plan time (robot frame, y left):
+// distance to its near face and how far its edges extend to each side.
+typedef struct {
+    float front_cm;
+    float left_extent_cm;
+    float right_extent_cm;
+    float width_cm;
+} bypass_obstacle_t;
+
+// Plan a path around the object, trying the shorter side first.
+// Returns false if neither side is clear in the occupancy grid.
+bool bypass_plan(const bypass_obstacle_t *obs);
+
+// One tracker step; call every control cycle while BYPASS_RUNNING.
+bypass_status_t bypass_tick(void);
+
+// Stop tracking and the motors.
+void bypass_abort(void);
+
+// True once the robot is on the return leg (line may be re-acquired).
+bool bypass_returning(void);
+
+#endif
@@ -0,0 +1,266 @@
+/** @file collision.c
+ *  @brief Impact / wheel-slip detector: accelerometer vs encoder motion at 100 Hz.
+ *
+ *  NOTE: Barr-C style. Chassis speed is propagated from the accelerometer and
+ *        pulled slowly towards the wheel speed (complementary, ~0.5 s), so
+ *        accelerometer bias only produces a small steady offset while a real
+ *        disagreement shows up within a few samples. Wheel speed only
+ *        changes on an encoder edge, so it is differentiated edge-to-edge
+ *        across at least COLLISION_ACC_ENC_WIN_US, and the relative impact
+ *        test stays disarmed until COLLISION_ARM_TICKS edges after a start
+ *        (the 0 -> first-period step is not a deceleration).
+ *  WARNING: COLLISION_FWD_AXIS_SIGN assumes the LSM303 +X points backwards
+ *           (pitch = atan2(-ax, ...) in IMU_movement.c); flip it if the board
+ *           is remounted.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "event_groups.h"
+
+#include "collision.h"
+#include "IMU_movement.h"
+#include "imu_raw_demo.h"
+#include "encoder.h"
+#include "motor_encoder_demo.h"
+#include "filter.h"
+#include "evbus.h"
+#include "power.h"
+#include "supervisor.h"
+#include "trace.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define COLLISION_FWD_AXIS_SIGN    (-1.0f)
+#define COLLISION_CM_S2_PER_G      (981.0f)
+#define COLLISION_DRIVE_PCT        (5.0f)     /* |command| above this = driving */
+#define COLLISION_SPEED_TIMEOUT_MS (100u)
+#define COLLISION_BIAS_ALPHA       (0.02f)    /* bias tracking while stationary */
+#define COLLISION_ACC_ENC_ALPHA    (0.3f)     /* smooth encoder differentiation */
+#define COLLISION_ACC_ENC_WIN_US   (40000u)   /* differentiate across >= this */
+#define COLLISION_ARM_TICKS        (3u)       /* fresh ticks before impact test */
+#define COLLISION_V_CORR_TAU_S     (0.5f)
+#define COLLISION_STACK_WORDS      (1024u)
+
+/* ==============================
+ * Static State
+ * ============================== */
+static EventGroupHandle_t g_events   = NULL;
+static StaticEventGroup_t g_events_mem;
+static StackType_t        g_stack[COLLISION_STACK_WORDS];
+static StaticTask_t       g_tcb;
+static collision_state_t  g_state    = { 0 };
+static filter_iir_t       g_bias;
+static filter_iir_t       g_acc_enc;
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static void  collision_task_(void *pv);
+static bool  read_accel_g_(imu_data_t *d);
+static float wheel_speed_cm_s_(float *cmd_avg);
+static void  raise_(collision_state_t *st, EventBits_t bit, evbus_type_t type,
+                    uint32_t now_ms);
+
+/* ==============================
+ * Inputs
+ * ============================== */
+/* Cached driver sample in the same units as imu_data_t (g). Not
+ * read_imu_data(): that would advance IMU_movement's per-axis filters
+ * from a second task. */
+static bool read_accel_g_(imu_data_t *d)
+{
+    int16_t ax, ay, az;
+    if (!read_accel_raw(&ax, &ay, &az))
+    {
+        return false;
+    }
+    d->accel_x = ax / 1000.0f;
+    d->accel_y = ay / 1000.0f;
+    d->accel_z = az / 1000.0f;
+    return true;
+}
+
+/* Encoders are unsigned; the direction comes from the motor command. */
+static float wheel_speed_cm_s_(float *cmd_avg)
+{
+    float lcmd, rcmd;
+    motor_get_command(&lcmd, &rcmd);
+    *cmd_avg = 0.5f * (lcmd + rcmd);
+
+    float vl = encoder_get_speed_cm_s_timeout(ENCODER_LEFT_GPIO,  COLLISION_SPEED_TIMEOUT_MS);
+    float vr = encoder_get_speed_cm_s_timeout(ENCODER_RIGHT_GPIO, COLLISION_SPEED_TIMEOUT_MS);
+    float v  = 0.5f * (vl + vr);
+    return (*cmd_avg < 0.0f) ? -v : v;
+}
+
+static void raise_(collision_state_t *st, EventBits_t bit, evbus_type_t type,
+                   uint32_t now_ms)
+{
+    st->last_event_ms = now_ms;
+    xEventGroupSetBits(g_events, bit);
+    (void)evbus_post(type, now_ms);
+}
+
+/* ==============================
+ * Task
+ * ============================== */
+static void collision_task_(void *pv)
+{
+    (void)pv;
+    TickType_t last_wake    = xTaskGetTickCount();
+    uint32_t   last_us      = time_us_32();
+    float      v_ref        = 0.0f;     /* speed at the last differentiation edge */
+    uint32_t   ref_us       = last_us;
+    float      a_enc        = 0.0f;
+    uint32_t   armed_ticks  = 0;
+    int32_t    tl_prev      = encoder_get_odom_ticks(ENCODER_LEFT_GPIO);
+    int32_t    tr_prev      = encoder_get_odom_ticks(ENCODER_RIGHT_GPIO);
+    float      v_chassis    = 0.0f;
+    uint32_t   slip_ms      = 0;
+    uint32_t   last_impact  = 0;
+    uint32_t   last_slip    = 0;
+    collision_state_t st    = { 0 };
+
+    filter_iir_init(&g_bias, COLLISION_BIAS_ALPHA);
+    filter_iir_init(&g_acc_enc, COLLISION_ACC_ENC_ALPHA);
+
+    while (1)
+    {
+        /* Parked: nothing can slip, and a hard knock still shows at 20 Hz */
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(power_parked() ? COLLISION_PARKED_MS
+                                                                  : COLLISION_PERIOD_MS));
+        supervisor_beat(SUP_COLLISION);
+
+        uint32_t now_us = time_us_32();
+        uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+        float    dt_s   = (float)(now_us - last_us) * 1e-6f;
+        last_us = now_us;
+        if (dt_s <= 0.0f)
+        {
+            continue;
+        }
+
+        imu_data_t imu = { 0 };
+        if (!read_accel_g_(&imu))
+        {
+            continue;
+        }
+
+        float cmd;
+        float v       = wheel_speed_cm_s_(&cmd);
+        bool  driving = fabsf(cmd) > COLLISION_DRIVE_PCT;
+
+        /* Encoder acceleration: only on a new edge, over >= one window */
+        int32_t tl   = encoder_get_odom_ticks(ENCODER_LEFT_GPIO);
+        int32_t tr   = encoder_get_odom_ticks(ENCODER_RIGHT_GPIO);
+        bool    edge = (tl != tl_prev) || (tr != tr_prev);
+        tl_prev = tl;
+        tr_prev = tr;
+        if (!driving || (v == 0.0f))
+        {
+            armed_ticks = 0u;
+        }
+        else if (edge && (armed_ticks < COLLISION_ARM_TICKS))
+        {
+            armed_ticks++;
+        }
+        bool armed = (armed_ticks >= COLLISION_ARM_TICKS);
+        if (!armed)
+        {
+            filter_iir_init(&g_acc_enc, COLLISION_ACC_ENC_ALPHA);
+            a_enc  = 0.0f;
+            v_ref  = v;
+            ref_us = now_us;
+        }
+        else if (edge && ((now_us - ref_us) >= COLLISION_ACC_ENC_WIN_US))
+        {
+            a_enc  = filter_iir_push(&g_acc_enc,
+                                     (v - v_ref) / ((float)(now_us - ref_us) * 1e-6f));
+            v_ref  = v;
+            ref_us = now_us;
+        }
+
+        /* Gravity from tilt and sensor offset: learned while parked */
+        float a_raw   = COLLISION_FWD_AXIS_SIGN * imu.accel_x * COLLISION_CM_S2_PER_G;
+        if (!driving && (v == 0.0f))
+        {
+            (void)filter_iir_push(&g_bias, a_raw);
+            v_chassis = 0.0f;
+        }
+        float a_imu = a_raw - g_bias.y;
+
+        v_chassis += (a_imu * dt_s) + ((v - v_chassis) * (dt_s / COLLISION_V_CORR_TAU_S));
+        float slip = v - v_chassis;
+
+        /* Impact: deceleration along the direction of travel */
+        float dir   = (v < 0.0f) ? -1.0f : 1.0f;
+        float decel = -dir * (a_imu - a_enc);
+        bool  hit   = (armed && (decel > COLLISION_IMPACT_CM_S2)) ||
+                      (fabsf(a_imu) > COLLISION_IMPACT_HARD_CM_S2);
+        if (hit && ((now_ms - last_impact) > COLLISION_HOLDOFF_MS))
+        {
+            last_impact = now_ms;
+            st.impacts++;
+            raise_(&st, COLLISION_EVT_IMPACT, EVBUS_IMPACT, now_ms);
+            TRACE(TR_IMPACT, (int32_t)a_imu, (int32_t)a_enc, 0, 0);
+        }
+
+        /* Slip: sustained disagreement while the motors are driven */
+        st.slipping = driving && (fabsf(slip) > COLLISION_SLIP_CM_S);
+        slip_ms = st.slipping ? (slip_ms + COLLISION_PERIOD_MS) : 0u;
+        if ((slip_ms >= COLLISION_SLIP_MS) && ((now_ms - last_slip) > COLLISION_HOLDOFF_MS))
+        {
+            last_slip = now_ms;
+            st.slips++;
+            raise_(&st, COLLISION_EVT_SLIP, EVBUS_SLIP, now_ms);
+            TRACE(TR_SLIP, TRACE_CENTI(slip), 0, 0, 0);
+        }
+
+        st.accel_imu_cm_s2 = a_imu;
+        st.accel_enc_cm_s2 = a_enc;
+        st.v_enc_cm_s      = v;
+        st.slip_cm_s       = slip;
+
+        taskENTER_CRITICAL();
+        g_state = st;
+        taskEXIT_CRITICAL();
+    }
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+bool collision_start(uint32_t priority)
+{
+    g_events = xEventGroupCreateStatic(&g_events_mem);
+    if (xTaskCreateStatic(collision_task_, "collision", COLLISION_STACK_WORDS, NULL,
+                          priority, g_stack, &g_tcb) == NULL)
+    {
+        printf("[COLL] task create failed\n");
+        return false;
+    }
+    printf("[COLL] %u Hz, impact >%.0f cm/s2, slip >%.0f cm/s\n",
+           1000u / COLLISION_PERIOD_MS, COLLISION_IMPACT_CM_S2, COLLISION_SLIP_CM_S);
+    return true;
+}
+
+EventGroupHandle_t collision_get_events(void)
+{
+    return g_events;
+}
+
+void collision_get_state(collision_state_t *out)
+{
+    if (out == NULL) return;
+    taskENTER_CRITICAL();
+    *out = g_state;
+    taskEXIT_CRITICAL();
+}
+
+/*** end of file ***/
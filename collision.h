@@ -0,0 +1,66 @@
+//collision.h
+
+/*
+Impact and wheel-slip detection.
+
+A 100 Hz task compares the chassis' forward acceleration from the
+accelerometer with the acceleration implied by the wheel encoders:
+
+  impact  the chassis decelerates much harder than the wheels do (or
+          beyond a hard limit), e.g. a low obstacle the ultrasonic missed
+  slip    the wheel speed and the IMU-propagated chassis speed drift apart
+          for longer than a few samples (wheels spinning on a slick tile,
+          or pushing against something while the wheels turn)
+
+Detections are posted to the event bus (EVBUS_IMPACT / EVBUS_SLIP) and
+mirrored in the event group returned by collision_get_events(), in the same
+way as ranging.
+ */
+
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "event_groups.h"
+
+#define COLLISION_PERIOD_MS          10u
+#define COLLISION_PARKED_MS          50u      // while power_parked()
+
+// Impact: deceleration not explained by the wheels, and a hard limit
+#define COLLISION_IMPACT_CM_S2      300.0f    // ~0.3 g residual
+#define COLLISION_IMPACT_HARD_CM_S2 800.0f    // ~0.8 g regardless of wheels
+
+// Slip: |v_wheels - v_chassis| above this for COLLISION_SLIP_MS
+#define COLLISION_SLIP_CM_S          10.0f
+#define COLLISION_SLIP_MS            60u
+
+// No repeat detection of the same kind within this window
+#define COLLISION_HOLDOFF_MS        500u
+
+// Event bits set in collision_get_events()
+#define COLLISION_EVT_IMPACT        (1u << 0)
+#define COLLISION_EVT_SLIP          (1u << 1)
+
+typedef struct {
+    float    accel_imu_cm_s2;    // Forward accel from the IMU, bias removed
+    float    accel_enc_cm_s2;    // Forward accel from the encoders
+    float    v_enc_cm_s;         // Signed wheel speed
+    float    slip_cm_s;          // v_enc - IMU-propagated chassis speed
+    uint32_t impacts;            // Detections since boot
+    uint32_t slips;
+    uint32_t last_event_ms;
+    bool     slipping;           // Slip condition currently present
+} collision_state_t;
+
+// Create the detector task (after imu_init() and encoders_init()).
+bool collision_start(uint32_t priority);
+
+// Event group carrying COLLISION_EVT_* bits (bits are not auto-cleared).
+EventGroupHandle_t collision_get_events(void);
+
+// Consistent snapshot for telemetry.
+void collision_get_state(collision_state_t *out);
+
+#endif
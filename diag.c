@@ -0,0 +1,254 @@
+/** @file diag.c
+ *  @brief CPU / stack / heap / ISR diagnostics published to BASE_TOPIC/diag.
+ *
+ *  NOTE: Barr-C style. Loads are deltas between two uxTaskGetSystemState()
+ *        snapshots, so the 32-bit microsecond counter wrapping (~71 min)
+ *        does not matter. Tasks are matched across snapshots by task number.
+ *  WARNING: uxTaskGetSystemState() suspends the scheduler while it walks the
+ *           task lists; keep DIAG_PERIOD_MS in seconds, not milliseconds.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "diag.h"
+#include "mqtt_client.h"
+#include "power.h"
+#include "supervisor.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define DIAG_JSON_MAX       (1200u)
+#define DIAG_STACK_WORDS    (1024u)
+
+#ifdef configNUM_CORES
+#define DIAG_CORES          (configNUM_CORES)
+#else
+#define DIAG_CORES          (1u)
+#endif
+
+/* ==============================
+ * Static State
+ * ============================== */
+typedef struct
+{
+    UBaseType_t number;
+    uint32_t    runtime;
+} diag_prev_t;
+
+static TaskStatus_t      g_status[DIAG_MAX_TASKS];
+static diag_prev_t       g_prev[DIAG_MAX_TASKS];
+static uint8_t           g_prev_n        = 0;
+static uint32_t          g_prev_total    = 0;
+static volatile uint32_t g_isr_us[DIAG_ISR_COUNT];
+static uint32_t          g_isr_prev[DIAG_ISR_COUNT];
+static volatile uint32_t g_malloc_fail   = 0;
+static char              g_json[DIAG_JSON_MAX];
+static StackType_t       g_stack[DIAG_STACK_WORDS];
+static StaticTask_t      g_tcb;
+static StackType_t       g_idle_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t      g_idle_tcb;
+static StackType_t       g_timer_stack[configTIMER_TASK_STACK_DEPTH];
+static StaticTask_t      g_timer_tcb;
+
+static const char *const g_isr_names[DIAG_ISR_COUNT] =
+{
+    "enc", "echo", "bc", "imu", "dma"
+};
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static void     diag_task_(void *pv);
+static uint32_t prev_runtime_(UBaseType_t number);
+static size_t   build_json_(uint32_t window);
+
+/* ==============================
+ * Counters
+ * ============================== */
+uint32_t diag_runtime_us(void)
+{
+    return time_us_32();
+}
+
+void diag_isr_end(diag_isr_t id, uint32_t t0_us)
+{
+    g_isr_us[id] += time_us_32() - t0_us;
+}
+
+/* A task created inside the window started counting from zero. */
+static uint32_t prev_runtime_(UBaseType_t number)
+{
+    for (uint8_t i = 0; i < g_prev_n; i++)
+    {
+        if (g_prev[i].number == number)
+        {
+            return g_prev[i].runtime;
+        }
+    }
+    return 0u;
+}
+
+/* ==============================
+ * Snapshot
+ * ============================== */
+static size_t build_json_(uint32_t window)
+{
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    UBaseType_t n = uxTaskGetSystemState(g_status, DIAG_MAX_TASKS, &total);
+    uint32_t    span = (uint32_t)(total - g_prev_total) * DIAG_CORES;
+    if (span == 0u)
+    {
+        span = 1u;
+    }
+
+    power_stats_t pwr;
+    power_get_stats(&pwr);
+
+    size_t len = 0;
+    int    w   = snprintf(g_json, sizeof(g_json),
+                          "{\"up\":%lu,\"heap\":%u,\"heap_min\":%u,\"mfail\":%lu,"
+                          "\"pwr\":{\"park\":%u,\"sleep\":%lu,\"mA\":%.1f},\"isr\":{",
+                          (unsigned long)(to_ms_since_boot(get_absolute_time()) / 1000u),
+                          (unsigned)xPortGetFreeHeapSize(),
+                          (unsigned)xPortGetMinimumEverFreeHeapSize(),
+                          (unsigned long)g_malloc_fail,
+                          pwr.parked ? 1u : 0u, (unsigned long)pwr.sleep_pm,
+                          (double)pwr.est_ma);
+    len = (w > 0) ? (size_t)w : 0u;
+
+    for (uint8_t i = 0; (i < DIAG_ISR_COUNT) && (len < sizeof(g_json)); i++)
+    {
+        uint32_t us = g_isr_us[i];
+        uint32_t pm = (uint32_t)(((uint64_t)(us - g_isr_prev[i]) * 1000u) / window);
+        g_isr_prev[i] = us;
+        w = snprintf(&g_json[len], sizeof(g_json) - len, "%s\"%s\":%lu",
+                     (i == 0u) ? "" : ",", g_isr_names[i], (unsigned long)pm);
+        len += (w > 0) ? (size_t)w : 0u;
+    }
+    if (len < sizeof(g_json))
+    {
+        w = snprintf(&g_json[len], sizeof(g_json) - len, "},\"tasks\":[");
+        len += (w > 0) ? (size_t)w : 0u;
+    }
+
+    for (UBaseType_t i = 0; (i < n) && (len < sizeof(g_json)); i++)
+    {
+        const TaskStatus_t *t = &g_status[i];
+        uint32_t run = (uint32_t)t->ulRunTimeCounter;
+        uint32_t pm  = (uint32_t)(((uint64_t)(run - prev_runtime_(t->xTaskNumber)) * 1000u) / span);
+        w = snprintf(&g_json[len], sizeof(g_json) - len, "%s[\"%s\",%lu,%lu]",
+                     (i == 0u) ? "" : ",", t->pcTaskName, (unsigned long)pm,
+                     (unsigned long)t->usStackHighWaterMark);
+        len += (w > 0) ? (size_t)w : 0u;
+    }
+    if (len < sizeof(g_json))
+    {
+        w = snprintf(&g_json[len], sizeof(g_json) - len, "]}");
+        len += (w > 0) ? (size_t)w : 0u;
+    }
+
+    g_prev_n = 0;
+    for (UBaseType_t i = 0; (i < n) && (i < DIAG_MAX_TASKS); i++)
+    {
+        g_prev[g_prev_n].number  = g_status[i].xTaskNumber;
+        g_prev[g_prev_n].runtime = (uint32_t)g_status[i].ulRunTimeCounter;
+        g_prev_n++;
+    }
+    g_prev_total = (uint32_t)total;
+
+    if (len >= sizeof(g_json))
+    {
+        printf("[DIAG] snapshot truncated (%u tasks)\n", (unsigned)n);
+        return 0u;
+    }
+    return len;
+}
+
+/* ==============================
+ * Task
+ * ============================== */
+static void diag_task_(void *pv)
+{
+    (void)pv;
+    TickType_t last_wake = xTaskGetTickCount();
+    uint32_t   last_us   = time_us_32();
+
+    while (1)
+    {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(DIAG_PERIOD_MS));
+
+        uint32_t now_us = time_us_32();
+        uint32_t window = now_us - last_us;
+        last_us = now_us;
+
+        size_t len = build_json_((window == 0u) ? 1u : window);
+        if (len == 0u)
+        {
+            continue;
+        }
+        if (mqtt_is_connected())
+        {
+            (void)mqtt_publish_raw("diag", g_json, (uint16_t)len, 0, false);
+        }
+        else
+        {
+            printf("[DIAG] %s\n", g_json);
+        }
+    }
+}
+
+/* ==============================
+ * Kernel Hooks
+ * ============================== */
+void vApplicationStackOverflowHook(TaskHandle_t task, char *name)
+{
+    (void)task;
+    supervisor_fault(SUP_FAULT_STACK, SUP_CLIENT_COUNT);    /* motors off first */
+    panic("[DIAG] stack overflow in %s", name);
+}
+
+void vApplicationMallocFailedHook(void)
+{
+    g_malloc_fail++;
+    printf("[DIAG] malloc failed, heap free %u\n", (unsigned)xPortGetFreeHeapSize());
+}
+
+/* Kernel-owned tasks live in .bss like ours (the SMP kernel places the
+ * other core's minimal idle task itself). */
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack,
+                                   uint32_t *words)
+{
+    *tcb   = &g_idle_tcb;
+    *stack = g_idle_stack;
+    *words = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack,
+                                    uint32_t *words)
+{
+    *tcb   = &g_timer_tcb;
+    *stack = g_timer_stack;
+    *words = configTIMER_TASK_STACK_DEPTH;
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+bool diag_start(uint32_t priority)
+{
+    if (xTaskCreateStatic(diag_task_, "diag", DIAG_STACK_WORDS, NULL, priority,
+                          g_stack, &g_tcb) == NULL)
+    {
+        printf("[DIAG] task create failed\n");
+        return false;
+    }
+    return true;
+}
+
+/*** end of file ***/
@@ -0,0 +1,55 @@
+//diag.h
+
+/*
+Runtime diagnostics: per-task CPU load, stack high-water marks, heap use and
+interrupt time, published as one compact JSON document to BASE_TOPIC/diag
+every DIAG_PERIOD_MS (printed to stdio while MQTT is down).
+
+Task CPU comes from the FreeRTOS run-time stats counter, clocked from the
+1 MHz hardware timer. ISR time is measured by wrapping the registered
+handlers with DIAG_ISR_TIMED(). Loads are per mille of the window (on SMP,
+of both cores together). Stack marks are the minimum free words ever seen.
+
+Payload:
+  {"up":s,"heap":free,"heap_min":min_ever,"mfail":n,
+   "pwr":{"park":0|1,"sleep":pm,"mA":est},"isr":{"enc":pm,...},"tasks":[["name",cpu_pm,free_words],...]}
+ */
+
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+
+#define DIAG_PERIOD_MS           5000u
+#define DIAG_MAX_TASKS           24u
+
+typedef enum {
+    DIAG_ISR_ENCODER = 0,
+    DIAG_ISR_ECHO,
+    DIAG_ISR_BARCODE,
+    DIAG_ISR_IMU_INT,
+    DIAG_ISR_IMU_DMA,
+    DIAG_ISR_COUNT
+} diag_isr_t;
+
+// Create the publisher task (after wifi_and_mqtt_start()).
+bool diag_start(uint32_t priority);
+
+// Run-time stats clock (portGET_RUN_TIME_COUNTER_VALUE), microseconds.
+uint32_t diag_runtime_us(void);
+
+// ISR accounting; use through DIAG_ISR_TIMED.
+void diag_isr_end(diag_isr_t id, uint32_t t0_us);
+
+// Define 'wrapper' as a timed void(void) handler that calls 'handler'.
+#define DIAG_ISR_TIMED(wrapper, id, handler)        \
+    static void wrapper(void)                       \
+    {                                               \
+        uint32_t t0_ = time_us_32();                \
+        handler();                                  \
+        diag_isr_end((id), t0_);                    \
+    }
+
+#endif
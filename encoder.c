@@ -8,13 +8,14 @@
 #include "hardware/gpio.h"
 #include "pico/time.h"
 #include "motor_encoder_demo.h"
+#include "diag.h"
 #include <stdio.h>
 
 /* ==============================
  * Static Instances
  * ============================== */
-encoder_t left_encoder  = { ENCODER_LEFT_GPIO,  0, 0, 0, 0.0f };
-encoder_t right_encoder = { ENCODER_RIGHT_GPIO, 0, 0, 0, 0.0f };
+encoder_t left_encoder  = { ENCODER_LEFT_GPIO,  0, 0, 0, 0.0f, 0 };
+encoder_t right_encoder = { ENCODER_RIGHT_GPIO, 0, 0, 0, 0.0f, 0 };
 
 /* ==============================
  * ISR
@@ -25,13 +26,18 @@ void encoder_global_isr(uint gpio, uint32_t events)
     uint32_t now = time_us_32();
 
     encoder_t *enc = NULL;
+    float cmd_l, cmd_r;
+    motor_get_command(&cmd_l, &cmd_r);
+    float cmd = 0.0f;
     if (gpio == ENCODER_LEFT_GPIO)
     {
         enc = &left_encoder;
+        cmd = cmd_l;
     }
     else if (gpio == ENCODER_RIGHT_GPIO)
     {
         enc = &right_encoder;
+        cmd = cmd_r;
     }
     else
     {
@@ -39,6 +45,7 @@ void encoder_global_isr(uint gpio, uint32_t events)
     }
 
     enc->pulse_count++;
+    enc->odom_ticks += (cmd < 0.0f) ? -1 : 1;
     if (enc->last_time_us > 0)
     {
         uint32_t period = now - enc->last_time_us;
@@ -53,6 +60,13 @@ void encoder_global_isr(uint gpio, uint32_t events)
     enc->last_time_us = now;
 }
 
+static void encoder_isr_timed_(uint gpio, uint32_t events)
+{
+    uint32_t t0 = time_us_32();
+    encoder_global_isr(gpio, events);
+    diag_isr_end(DIAG_ISR_ENCODER, t0);
+}
+
 /* ==============================
  * Initialization
  * ============================== */
@@ -95,7 +109,7 @@ void encoders_init(bool pull_up)
 
     gpio_set_irq_enabled(ENCODER_LEFT_GPIO, GPIO_IRQ_EDGE_RISE, true);
     gpio_set_irq_enabled(ENCODER_RIGHT_GPIO, GPIO_IRQ_EDGE_RISE, true);
-    gpio_set_irq_callback(encoder_global_isr);
+    gpio_set_irq_callback(encoder_isr_timed_);
 
     irq_set_enabled(IO_IRQ_BANK0, true);
 }
@@ -115,6 +129,12 @@ int32_t encoder_get_pulse_count(uint gpio_pin)
     return enc->pulse_count;
 }
 
+int32_t encoder_get_odom_ticks(uint gpio_pin)
+{
+    encoder_t *enc = (gpio_pin == ENCODER_LEFT_GPIO) ? &left_encoder : &right_encoder;
+    return enc->odom_ticks;
+}
+
 void encoder_reset_distance(uint gpio_pin)
 {
     encoder_t *enc = (gpio_pin == ENCODER_LEFT_GPIO) ? &left_encoder : &right_encoder;
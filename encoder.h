@@ -18,6 +18,7 @@ typedef struct {
     volatile uint32_t last_time_us;
     volatile int32_t last_period_us;
     float distance_cm;  // Total distance traveled in cm
+    volatile int32_t odom_ticks;  // Signed ticks for odometry, never reset
 } encoder_t;
 
 void encoder_init(bool pull_up);
@@ -27,10 +28,12 @@ int32_t encoder_measure_period_us(uint gpio_pin, uint32_t timeout_us);
 // New functions for speed and distance
 void encoders_init(bool pull_up);
 float encoder_get_speed_cm_s(uint gpio_pin);
+float encoder_get_speed_cm_s_timeout(uint gpio_pin, uint32_t timeout_ms);
 float encoder_get_distance_cm(uint gpio_pin);
 void encoder_update_measurements(void);
 int32_t encoder_get_pulse_count(uint gpio_pin);
 void encoder_reset_distance(uint gpio_pin);
+int32_t encoder_get_odom_ticks(uint gpio_pin);
 
 // Global encoder instances
 extern encoder_t left_encoder;
@@ -44,6 +47,7 @@ static inline float period_us_to_hz(int32_t period_us) {
 // Constants for wheel calculations
 #define WHEEL_DIAMETER_CM 6.5f  // Adjust based on your wheel size
 #define PULSES_PER_REVOLUTION 20.0f  // Adjust based on your encoder
+#define ENCODER_CM_PER_TICK ((WHEEL_DIAMETER_CM * 3.14159f) / PULSES_PER_REVOLUTION)
 
 #ifdef __cplusplus
 }
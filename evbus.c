@@ -0,0 +1,97 @@
+/** @file evbus.c
+ *  @brief Typed event queue from detectors (tasks and ISRs) to the control task.
+ *
+ *  NOTE: Barr-C style. One FreeRTOS queue carries every event so the consumer
+ *        sees them in post order and blocks in exactly one place.
+ *  WARNING: A full queue drops the new event (counted); producers must not
+ *           post per-sample, only on state changes.
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "queue.h"
+
+#include "evbus.h"
+#include "trace.h"
+
+/* ==============================
+ * Static State
+ * ============================== */
+static QueueHandle_t     g_queue   = NULL;
+static StaticQueue_t     g_queue_mem;
+static uint8_t           g_queue_buf[EVBUS_DEPTH * sizeof(evbus_event_t)];
+static volatile uint32_t g_dropped = 0;
+
+static const char *const g_names[EVBUS_TYPE_COUNT] =
+{
+    "OBSTACLE", "BARCODE", "IMPACT", "SLIP", "MOTION_DONE"
+};
+
+/* ==============================
+ * Public API
+ * ============================== */
+bool evbus_init(void)
+{
+    if (g_queue != NULL)
+    {
+        return true;
+    }
+    g_queue = xQueueCreateStatic(EVBUS_DEPTH, sizeof(evbus_event_t),
+                                 g_queue_buf, &g_queue_mem);
+    return true;
+}
+
+bool evbus_post(evbus_type_t type, uint32_t arg)
+{
+    if (g_queue == NULL)
+    {
+        return false;
+    }
+    evbus_event_t ev = { type, to_ms_since_boot(get_absolute_time()), arg };
+    TRACE(TR_EVBUS, type, arg, 0, 0);
+    if (xQueueSend(g_queue, &ev, 0) != pdPASS)
+    {
+        g_dropped++;
+        return false;
+    }
+    return true;
+}
+
+bool evbus_post_from_isr(evbus_type_t type, uint32_t arg, BaseType_t *woken)
+{
+    if (g_queue == NULL)
+    {
+        return false;
+    }
+    evbus_event_t ev = { type, to_ms_since_boot(get_absolute_time()), arg };
+    TRACE(TR_EVBUS, type, arg, 1, 0);
+    if (xQueueSendFromISR(g_queue, &ev, woken) != pdPASS)
+    {
+        g_dropped++;
+        return false;
+    }
+    return true;
+}
+
+bool evbus_wait(evbus_event_t *out, TickType_t wait_ticks)
+{
+    if ((g_queue == NULL) || (out == NULL))
+    {
+        return false;
+    }
+    return (xQueueReceive(g_queue, out, wait_ticks) == pdPASS);
+}
+
+uint32_t evbus_dropped(void)
+{
+    return g_dropped;
+}
+
+const char *evbus_type_name(evbus_type_t type)
+{
+    return (type < EVBUS_TYPE_COUNT) ? g_names[type] : "UNK";
+}
+
+/*** end of file ***/
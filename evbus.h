@@ -0,0 +1,54 @@
+//evbus.h
+
+/*
+Single event queue between the detectors and the control task.
+
+Producers (ranging, collision and motion tasks, barcode quiet-gap alarm)
+post typed events; the control task blocks on evbus_wait() for at most its
+control period, so an event is handled as soon as the producer posts it
+instead of at the next poll of a detector task.
+ */
+
+#ifndef EVBUS_H
+#define EVBUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+
+// Queue depth; events are small and consumed every control cycle
+#define EVBUS_DEPTH              16u
+
+typedef enum {
+    EVBUS_OBSTACLE = 0,          // Ranging TTC / near-distance brake
+    EVBUS_BARCODE_FRAME,         // IR edge capture ended (quiet gap or buffer full)
+    EVBUS_IMPACT,                // Collision detector
+    EVBUS_SLIP,
+    EVBUS_MOTION_DONE,           // Motion sequence finished (arg: see motion.h)
+    EVBUS_TYPE_COUNT
+} evbus_type_t;
+
+typedef struct {
+    evbus_type_t type;
+    uint32_t     t_ms;           // Post time
+    uint32_t     arg;            // Type-specific (e.g. barcode transition count)
+} evbus_event_t;
+
+// Create the queue. Call before any producer starts.
+bool evbus_init(void);
+
+// Post from task context; never blocks. Returns false if the queue is full.
+bool evbus_post(evbus_type_t type, uint32_t arg);
+
+// Post from an interrupt (GPIO, alarm); pass *woken to portYIELD_FROM_ISR.
+bool evbus_post_from_isr(evbus_type_t type, uint32_t arg, BaseType_t *woken);
+
+// Block up to wait_ticks for the next event.
+bool evbus_wait(evbus_event_t *out, TickType_t wait_ticks);
+
+// Events lost to a full queue since boot.
+uint32_t evbus_dropped(void);
+
+const char *evbus_type_name(evbus_type_t type);
+
+#endif
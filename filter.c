@@ -0,0 +1,151 @@
+/** @file filter.c
+ *  @brief Per-channel O(1) sample filters: moving average, IIR, median-of-3/5.
+ *
+ *  NOTE: Barr-C style. The moving average keeps a running sum, so each push
+ *        is one add and one subtract regardless of window length. Medians
+ *        use fixed comparison networks (3 compares / 6 compares), no sort.
+ */
+
+#include <string.h>
+
+#include "filter.h"
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static float min_(float a, float b);
+static float max_(float a, float b);
+
+/* ==============================
+ * Helpers
+ * ============================== */
+static float min_(float a, float b)
+{
+    return (a < b) ? a : b;
+}
+
+static float max_(float a, float b)
+{
+    return (a > b) ? a : b;
+}
+
+/* ==============================
+ * Moving Average
+ * ============================== */
+void filter_ma_init(filter_ma_t *f, uint8_t len)
+{
+    memset(f, 0, sizeof(*f));
+    if (len < 1u)           len = 1u;
+    if (len > FILTER_MA_MAX) len = FILTER_MA_MAX;
+    f->len = len;
+}
+
+int16_t filter_ma_push(filter_ma_t *f, int16_t x)
+{
+    if (f->count < f->len)
+    {
+        f->count++;
+    }
+    else
+    {
+        f->sum -= f->buf[f->idx];
+    }
+    f->buf[f->idx] = x;
+    f->sum += x;
+    f->idx = (uint8_t)((f->idx + 1u == f->len) ? 0u : (f->idx + 1u));
+    return (int16_t)(f->sum / (int32_t)f->count);
+}
+
+/* ==============================
+ * First-Order IIR
+ * ============================== */
+void filter_iir_init(filter_iir_t *f, float alpha)
+{
+    f->y      = 0.0f;
+    f->alpha  = alpha;
+    f->primed = false;
+}
+
+float filter_iir_push(filter_iir_t *f, float x)
+{
+    if (!f->primed)
+    {
+        f->y      = x;
+        f->primed = true;
+    }
+    else
+    {
+        f->y += f->alpha * (x - f->y);
+    }
+    return f->y;
+}
+
+/* ==============================
+ * Median
+ * ============================== */
+float filter_median3(float a, float b, float c)
+{
+    return max_(min_(a, b), min_(max_(a, b), c));
+}
+
+float filter_median5(float a, float b, float c, float d, float e)
+{
+    float t;
+    if (a > b) { t = a; a = b; b = t; }
+    if (c > d) { t = c; c = d; d = t; }
+
+    /* The smaller of a, c is below three others: drop it, put e in its pair */
+    if (a < c)
+    {
+        a = e;
+        if (a > b) { t = a; a = b; b = t; }
+    }
+    else
+    {
+        c = e;
+        if (c > d) { t = c; c = d; d = t; }
+    }
+
+    /* Median of five = second smallest of the remaining four */
+    return (a < c) ? min_(b, c) : min_(a, d);
+}
+
+void filter_med_init(filter_med_t *f, uint8_t len)
+{
+    f->len = (len == 3u) ? 3u : 5u;
+    filter_med_reset(f);
+}
+
+void filter_med_reset(filter_med_t *f)
+{
+    f->idx   = 0;
+    f->count = 0;
+}
+
+float filter_med_push(filter_med_t *f, float x)
+{
+    f->buf[f->idx] = x;
+    f->idx = (uint8_t)((f->idx + 1u == f->len) ? 0u : (f->idx + 1u));
+    if (f->count < f->len)
+    {
+        f->count++;
+    }
+
+    const float *v = f->buf;
+    switch (f->count)
+    {
+        case 1u: return v[0];
+        case 2u: return max_(v[0], v[1]);                 /* upper of two */
+        case 3u: return filter_median3(v[0], v[1], v[2]);
+        case 4u:
+        {
+            /* Upper median of four: second largest */
+            float lo1 = min_(v[0], v[1]), hi1 = max_(v[0], v[1]);
+            float lo2 = min_(v[2], v[3]), hi2 = max_(v[2], v[3]);
+            return max_(min_(hi1, hi2), max_(lo1, lo2));
+        }
+        default: return filter_median5(v[0], v[1], v[2], v[3], v[4]);
+    }
+}
+
+/*** end of file ***/
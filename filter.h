@@ -0,0 +1,63 @@
+//filter.h
+
+/*
+Small filter bank for sensor sample paths.
+
+Every filter keeps its own state struct, so each channel (accel axis,
+sensor, ...) gets an independent instance. All updates are O(1):
+
+  filter_ma_t    running-sum moving average over int16 samples
+  filter_iir_t   first-order low-pass  y += alpha * (x - y)
+  filter_med_t   sliding median of 3 or 5 (comparison network)
+
+The median and average return a result from the first sample on, using
+the samples seen so far until the window is full.
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FILTER_MA_MAX     16u     // Longest moving-average window
+
+typedef struct {
+    int32_t sum;
+    uint8_t len;
+    uint8_t idx;
+    uint8_t count;
+    int16_t buf[FILTER_MA_MAX];
+} filter_ma_t;
+
+typedef struct {
+    float y;
+    float alpha;
+    bool  primed;                // First sample seeds the output
+} filter_iir_t;
+
+typedef struct {
+    float   buf[5];
+    uint8_t len;                 // 3 or 5
+    uint8_t idx;
+    uint8_t count;
+} filter_med_t;
+
+// Moving average (len clamped to 1..FILTER_MA_MAX)
+void    filter_ma_init(filter_ma_t *f, uint8_t len);
+int16_t filter_ma_push(filter_ma_t *f, int16_t x);
+
+// First-order IIR, alpha in (0, 1]
+void  filter_iir_init(filter_iir_t *f, float alpha);
+float filter_iir_push(filter_iir_t *f, float x);
+
+// Sliding median; len other than 3 uses 5
+void  filter_med_init(filter_med_t *f, uint8_t len);
+void  filter_med_reset(filter_med_t *f);
+float filter_med_push(filter_med_t *f, float x);
+
+// Stateless medians
+float filter_median3(float a, float b, float c);
+float filter_median5(float a, float b, float c, float d, float e);
+
+#endif
@@ -0,0 +1,299 @@
+/** @file fxmath.c
+ *  @brief Fixed-point atan2 / sin / cos / inverse sqrt (table + interpolation).
+ *
+ *  NOTE: Barr-C style. Tables hold 257 points over one octant (atan) and one
+ *        quadrant (sin); everything else is folded onto them by symmetry.
+ *        Tables were generated with libm in double precision and rounded.
+ *  WARNING: fx_atan2_deg() pre-scales large inputs to 15 bits before the
+ *           ratio divide; that is where its error bound comes from.
+ */
+
+#include <stddef.h>
+
+#include "fxmath.h"
+
+/* The SDK is only needed for the target benchmark; the kernels themselves
+ * build unchanged on a host (tests/host/fxmath_host.c). */
+#if FX_BENCH
+#include <stdio.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#endif
+
+/* ==============================
+ * Constants
+ * ============================== */
+#define FX_TABLE_BITS      (8u)
+#define FX_TABLE_N         (1u << FX_TABLE_BITS)
+#define FX_DEG_90          (90 * FX_DEG_ONE)
+#define FX_DEG_180         (180 * FX_DEG_ONE)
+#define FX_DEG_360         (360 * FX_DEG_ONE)
+#define FX_SIN_STEP        (FX_DEG_90 / (int32_t)FX_TABLE_N)   /* 23040, exact */
+#define FX_RATIO_BITS      (16u)
+#define FX_FRAC_BITS       (FX_RATIO_BITS - FX_TABLE_BITS)
+#define FX_RATIO_MAX_DEN   (1u << 15)
+#define FX_RSQRT_ITER      (2u)
+
+/* ==============================
+ * Tables
+ * ============================== */
+/* atan(i / 256) in degrees Q16.16, i = 0..256 */
+static const int32_t g_atan_tab[FX_TABLE_N + 1u] =
+{
+          0,   14668,   29335,   44001,   58666,   73329,   87990,  102648,
+     117304,  131955,  146603,  161246,  175884,  190517,  205144,  219765,
+     234379,  248986,  263585,  278177,  292760,  307334,  321899,  336454,
+     350999,  365534,  380058,  394570,  409070,  423558,  438034,  452496,
+     466945,  481380,  495801,  510207,  524598,  538973,  553333,  567676,
+     582003,  596312,  610605,  624879,  639135,  653372,  667591,  681790,
+     695970,  710129,  724268,  738387,  752484,  766560,  780613,  794645,
+     808654,  822641,  836604,  850544,  864460,  878352,  892219,  906062,
+     919879,  933671,  947438,  961178,  974893,  988580, 1002241, 1015875,
+    1029481, 1043060, 1056611, 1070133, 1083627, 1097092, 1110529, 1123936,
+    1137313, 1150661, 1163979, 1177267, 1190524, 1203751, 1216947, 1230111,
+    1243245, 1256347, 1269417, 1282455, 1295461, 1308435, 1321376, 1334285,
+    1347161, 1360004, 1372813, 1385590, 1398332, 1411041, 1423717, 1436358,
+    1448965, 1461538, 1474076, 1486580, 1499049, 1511483, 1523882, 1536246,
+    1548575, 1560868, 1573127, 1585349, 1597536, 1609687, 1621803, 1633882,
+    1645926, 1657933, 1669904, 1681839, 1693738, 1705600, 1717426, 1729215,
+    1740967, 1752683, 1764362, 1776004, 1787610, 1799179, 1810710, 1822205,
+    1833663, 1845084, 1856467, 1867814, 1879123, 1890396, 1901631, 1912829,
+    1923990, 1935113, 1946200, 1957249, 1968261, 1979236, 1990173, 2001074,
+    2011937, 2022763, 2033552, 2044303, 2055018, 2065695, 2076336, 2086939,
+    2097505, 2108034, 2118526, 2128981, 2139399, 2149780, 2160125, 2170432,
+    2180703, 2190937, 2201134, 2211295, 2221419, 2231507, 2241558, 2251572,
+    2261551, 2271492, 2281398, 2291267, 2301101, 2310898, 2320659, 2330384,
+    2340074, 2349727, 2359345, 2368927, 2378474, 2387985, 2397460, 2406901,
+    2416306, 2425675, 2435010, 2444310, 2453574, 2462804, 2471999, 2481159,
+    2490285, 2499376, 2508433, 2517455, 2526443, 2535397, 2544317, 2553203,
+    2562055, 2570873, 2579658, 2588409, 2597126, 2605811, 2614461, 2623079,
+    2631664, 2640215, 2648734, 2657220, 2665673, 2674093, 2682482, 2690837,
+    2699161, 2707452, 2715711, 2723939, 2732134, 2740298, 2748430, 2756531,
+    2764600, 2772638, 2780644, 2788620, 2796564, 2804478, 2812361, 2820213,
+    2828035, 2835826, 2843587, 2851318, 2859019, 2866690, 2874330, 2881941,
+    2889523, 2897075, 2904597, 2912090, 2919554, 2926989, 2934395, 2941772,
+    2949120
+};
+
+/* sin(i * 90 / 256 deg) in Q15, i = 0..256 (last entry 1.0 = 32768) */
+static const uint16_t g_sin_tab[FX_TABLE_N + 1u] =
+{
+        0,   201,   402,   603,   804,  1005,  1206,  1407,  1608,  1809,
+     2009,  2210,  2411,  2611,  2811,  3012,  3212,  3412,  3612,  3812,
+     4011,  4211,  4410,  4609,  4808,  5007,  5205,  5404,  5602,  5800,
+     5998,  6195,  6393,  6590,  6787,  6983,  7180,  7376,  7571,  7767,
+     7962,  8157,  8351,  8546,  8740,  8933,  9127,  9319,  9512,  9704,
+     9896, 10088, 10279, 10469, 10660, 10850, 11039, 11228, 11417, 11605,
+    11793, 11980, 12167, 12354, 12540, 12725, 12910, 13095, 13279, 13463,
+    13646, 13828, 14010, 14192, 14373, 14553, 14733, 14912, 15091, 15269,
+    15447, 15624, 15800, 15976, 16151, 16326, 16500, 16673, 16846, 17018,
+    17190, 17361, 17531, 17700, 17869, 18037, 18205, 18372, 18538, 18703,
+    18868, 19032, 19195, 19358, 19520, 19681, 19841, 20001, 20160, 20318,
+    20475, 20632, 20788, 20943, 21097, 21251, 21403, 21555, 21706, 21856,
+    22006, 22154, 22302, 22449, 22595, 22740, 22884, 23028, 23170, 23312,
+    23453, 23593, 23732, 23870, 24008, 24144, 24279, 24414, 24548, 24680,
+    24812, 24943, 25073, 25202, 25330, 25457, 25583, 25708, 25833, 25956,
+    26078, 26199, 26320, 26439, 26557, 26674, 26791, 26906, 27020, 27133,
+    27246, 27357, 27467, 27576, 27684, 27791, 27897, 28002, 28106, 28209,
+    28311, 28411, 28511, 28610, 28707, 28803, 28899, 28993, 29086, 29178,
+    29269, 29359, 29448, 29535, 29622, 29707, 29792, 29875, 29957, 30038,
+    30118, 30196, 30274, 30350, 30425, 30499, 30572, 30644, 30715, 30784,
+    30853, 30920, 30986, 31050, 31114, 31177, 31238, 31298, 31357, 31415,
+    31471, 31527, 31581, 31634, 31686, 31737, 31786, 31834, 31881, 31927,
+    31972, 32015, 32058, 32099, 32138, 32177, 32214, 32251, 32286, 32319,
+    32352, 32383, 32413, 32442, 32470, 32496, 32522, 32546, 32568, 32590,
+    32610, 32629, 32647, 32664, 32679, 32693, 32706, 32718, 32729, 32738,
+    32746, 32753, 32758, 32762, 32766, 32767, 32768
+};
+
+/* 1/sqrt(m) seed in Q30 for m in [k/16, (k+1)/16), k = 4..15, taken at
+ * the bucket centre */
+static const uint32_t g_rsqrt_seed[12] =
+{
+    2024667000u, 1831380208u, 1684624773u, 1568300315u, 1473161629u, 1393471397u,
+    1325455684u, 1266516759u, 1214800200u, 1168942037u, 1127913670u, 1090922784u
+};
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static uint32_t uabs_(int32_t v);
+static int16_t  sat_q15_(int32_t v);
+
+/* ==============================
+ * Helpers
+ * ============================== */
+static uint32_t uabs_(int32_t v)
+{
+    return (v < 0) ? (0u - (uint32_t)v) : (uint32_t)v;
+}
+
+static int16_t sat_q15_(int32_t v)
+{
+    if (v >  FX_ONE_Q15) return FX_ONE_Q15;
+    if (v < -FX_ONE_Q15) return -FX_ONE_Q15;
+    return (int16_t)v;
+}
+
+/* ==============================
+ * atan2
+ * ============================== */
+fx_deg_t fx_atan2_deg(int32_t y, int32_t x)
+{
+    uint32_t ax = uabs_(x);
+    uint32_t ay = uabs_(y);
+    if ((ax == 0u) && (ay == 0u))
+    {
+        return 0;
+    }
+
+    /* Fold onto the first octant: ratio num/den in [0, 1] */
+    bool     swap = (ay > ax);
+    uint32_t num  = swap ? ax : ay;
+    uint32_t den  = swap ? ay : ax;
+    while (den >= FX_RATIO_MAX_DEN)
+    {
+        num >>= 1;
+        den >>= 1;
+    }
+    uint32_t r    = (num << FX_RATIO_BITS) / den;          /* Q16, 0..65536 */
+    uint32_t idx  = r >> FX_FRAC_BITS;
+    int32_t  frac = (int32_t)(r & ((1u << FX_FRAC_BITS) - 1u));
+
+    int32_t a = g_atan_tab[idx];
+    if (idx < FX_TABLE_N)
+    {
+        a += ((g_atan_tab[idx + 1u] - a) * frac) >> FX_FRAC_BITS;
+    }
+
+    if (swap)  a = FX_DEG_90 - a;
+    if (x < 0) a = FX_DEG_180 - a;
+    if (y < 0) a = -a;
+    return a;
+}
+
+/* ==============================
+ * sin / cos
+ * ============================== */
+void fx_sincos(fx_deg_t a, int16_t *s, int16_t *c)
+{
+    a %= FX_DEG_360;
+    if (a < 0) a += FX_DEG_360;
+
+    uint32_t quad = (uint32_t)a / (uint32_t)FX_DEG_90;
+    int32_t  rem  = a - ((int32_t)quad * FX_DEG_90);
+    uint32_t idx  = (uint32_t)rem / (uint32_t)FX_SIN_STEP;
+    int32_t  frac = rem - ((int32_t)idx * FX_SIN_STEP);        /* 0..23039 */
+
+    /* sin(rem) rises through the table; cos(rem) = sin(90 - rem) runs back */
+    int32_t s0 = g_sin_tab[idx];
+    int32_t c0 = g_sin_tab[FX_TABLE_N - idx];
+    int32_t sv = s0;
+    int32_t cv = c0;
+    if (idx < FX_TABLE_N)
+    {
+        sv += (((int32_t)g_sin_tab[idx + 1u] - s0) * frac) / FX_SIN_STEP;
+        cv += (((int32_t)g_sin_tab[FX_TABLE_N - idx - 1u] - c0) * frac) / FX_SIN_STEP;
+    }
+
+    int32_t so, co;
+    switch (quad)
+    {
+        case 0u:  so =  sv; co =  cv; break;
+        case 1u:  so =  cv; co = -sv; break;
+        case 2u:  so = -sv; co = -cv; break;
+        default:  so = -cv; co =  sv; break;
+    }
+    if (s != NULL) *s = sat_q15_(so);
+    if (c != NULL) *c = sat_q15_(co);
+}
+
+/* ==============================
+ * Square Roots
+ * ============================== */
+uint32_t fx_rsqrt_q16(uint32_t x)
+{
+    if (x == 0u)
+    {
+        return 0u;
+    }
+
+    /* x = m * 2^-e with m = x << e in [2^30, 2^32), e even */
+    uint32_t e = (uint32_t)__builtin_clz(x) & ~1u;
+    uint32_t m = x << e;
+
+    /* Newton on y = 1/sqrt(M), M = m / 2^32 in [0.25, 1), y in Q30 */
+    uint32_t y = g_rsqrt_seed[(m >> 28) - 4u];
+    for (uint32_t i = 0; i < FX_RSQRT_ITER; i++)
+    {
+        uint32_t y2 = (uint32_t)(((uint64_t)y * y) >> 30);            /* Q30 */
+        uint32_t my = (uint32_t)(((uint64_t)m * y2) >> 32);           /* Q30 */
+        uint32_t k  = (3u << 30) - my;                                /* Q30 */
+        y = (uint32_t)(((uint64_t)y * k) >> 31);
+    }
+
+    /* X = M * 2^(16 - e)  ->  1/sqrt(X) = y * 2^((e - 16) / 2); Q30 -> Q16 */
+    int32_t sh = 14 - (((int32_t)e - 16) / 2);
+    return (sh >= 0) ? (y >> sh) : (y << -sh);
+}
+
+uint32_t fx_sqrt_u32(uint32_t x)
+{
+    uint32_t res = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > x)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0u)
+    {
+        if (x >= (res + bit))
+        {
+            x  -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+        {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+/* ==============================
+ * Target Benchmark
+ * ============================== */
+#if FX_BENCH
+void fx_bench(uint32_t iterations)
+{
+    volatile int32_t sink_i = 0;
+    volatile float   sink_f = 0.0f;
+    int16_t s, c;
+
+    uint32_t t0 = time_us_32();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        sink_i += fx_atan2_deg((int32_t)i - 500, 700);
+        fx_sincos((fx_deg_t)(i * 4099u), &s, &c);
+        sink_i += s + c + (int32_t)fx_sqrt_u32(i * 977u);
+    }
+    uint32_t t1 = time_us_32();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        float a = (float)(i * 4099u) * (1.0f / 65536.0f) * ((float)M_PI / 180.0f);
+        sink_f += atan2f((float)i - 500.0f, 700.0f);
+        sink_f += sinf(a) + cosf(a) + sqrtf((float)(i * 977u));
+    }
+    uint32_t t2 = time_us_32();
+
+    (void)sink_i;
+    (void)sink_f;
+    printf("[FX] %lu iters: fixed %lu ns/iter, libm %lu ns/iter\n",
+           (unsigned long)iterations,
+           (unsigned long)(((t1 - t0) * 1000u) / iterations),
+           (unsigned long)(((t2 - t1) * 1000u) / iterations));
+}
+#endif
+
+/*** end of file ***/
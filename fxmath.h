@@ -0,0 +1,54 @@
+//fxmath.h
+
+/*
+Fixed-point trig for the heading path (no FPU on the RP2040).
+
+Angles are degrees in Q16.16 (fx_deg_t, 1.0 deg = 65536). sin/cos are
+returned in Q15. All kernels are table + linear interpolation with
+integer arithmetic only; the divides go to the SIO hardware divider.
+
+Error bounds (swept on the host against double-precision libm; reproduce
+with the fxmath_host target in tests/host, which ctest runs):
+  fx_atan2_deg   |err| <= 0.005 deg        (any int32 inputs, not both zero)
+  fx_sincos      |err| <= 2 LSB Q15        (6.1e-5)
+  fx_rsqrt_q16   rel err <= 5e-5 + 1 LSB   (x > 0)
+  fx_sqrt_u32    exact floor
+ */
+
+#ifndef FXMATH_H
+#define FXMATH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int32_t fx_deg_t;
+
+#define FX_ONE_Q15        32767
+#define FX_DEG_ONE        65536
+#define FX_DEG(f)         ((fx_deg_t)((f) * 65536.0f))
+#define FX_TO_DEG(q)      ((float)(q) * (1.0f / 65536.0f))
+#define FX_Q15_TO_F(q)    ((float)(q) * (1.0f / 32768.0f))
+
+// Build the timing comparison against libm into fx_bench()
+#ifndef FX_BENCH
+#define FX_BENCH 0
+#endif
+
+// atan2(y, x) in (-180, 180] degrees Q16.16; 0 when both are zero
+fx_deg_t fx_atan2_deg(int32_t y, int32_t x);
+
+// sin and cos (Q15) of an angle in degrees Q16.16 (any range)
+void fx_sincos(fx_deg_t a, int16_t *s, int16_t *c);
+
+// 1/sqrt(x) with x and result in Q16.16; 0 when x == 0
+uint32_t fx_rsqrt_q16(uint32_t x);
+
+// floor(sqrt(x))
+uint32_t fx_sqrt_u32(uint32_t x);
+
+#if FX_BENCH
+// Time the kernels against atan2f/sinf/cosf/sqrtf and print per-call cost
+void fx_bench(uint32_t iterations);
+#endif
+
+#endif
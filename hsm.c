@@ -0,0 +1,257 @@
+/** @file hsm.c
+ *  @brief Table-driven hierarchical state machine with transition trace.
+ *
+ *  NOTE: Barr-C style. No allocation, no OS calls: time comes from the
+ *        definition's now_ms() hook, so the engine also runs on a host.
+ *  WARNING: Entry/exit actions must not dispatch events; tick actions and
+ *           transition actions may (the nested transition completes first).
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "hsm.h"
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static const hsm_state_def_t *state_(const hsm_t *m, hsm_state_id_t s);
+static bool            is_ancestor_or_self_(const hsm_t *m, hsm_state_id_t a,
+                                            hsm_state_id_t s);
+static hsm_state_id_t  common_ancestor_(const hsm_t *m, hsm_state_id_t src,
+                                        hsm_state_id_t dst);
+static void            enter_from_(hsm_t *m, hsm_state_id_t lca, hsm_state_id_t dst);
+static void            transition_(hsm_t *m, hsm_state_id_t dst, hsm_event_id_t ev,
+                                   hsm_action_fn action);
+static void            trace_(hsm_t *m, hsm_state_id_t from, hsm_event_id_t ev);
+
+/* ==============================
+ * Tree Helpers
+ * ============================== */
+static const hsm_state_def_t *state_(const hsm_t *m, hsm_state_id_t s)
+{
+    return &m->def->states[s];
+}
+
+static bool is_ancestor_or_self_(const hsm_t *m, hsm_state_id_t a, hsm_state_id_t s)
+{
+    for (uint8_t d = 0; d <= HSM_MAX_DEPTH; d++)
+    {
+        if (s == a)
+        {
+            return true;
+        }
+        if (s == HSM_ROOT)
+        {
+            break;
+        }
+        s = state_(m, s)->parent;
+    }
+    return false;
+}
+
+/* Lowest strict ancestor of dst that contains src: a self- or
+ * parent-transition exits and re-enters (external semantics). */
+static hsm_state_id_t common_ancestor_(const hsm_t *m, hsm_state_id_t src,
+                                       hsm_state_id_t dst)
+{
+    hsm_state_id_t a = state_(m, dst)->parent;
+    for (uint8_t d = 0; d < HSM_MAX_DEPTH; d++)
+    {
+        if ((a == HSM_ROOT) || is_ancestor_or_self_(m, a, src))
+        {
+            break;
+        }
+        a = state_(m, a)->parent;
+    }
+    return a;
+}
+
+/* Entry actions top-down from below lca to dst, then initial children. */
+static void enter_from_(hsm_t *m, hsm_state_id_t lca, hsm_state_id_t dst)
+{
+    hsm_state_id_t path[HSM_MAX_DEPTH];
+    uint8_t        n = 0;
+    for (hsm_state_id_t s = dst; (s != lca) && (n < HSM_MAX_DEPTH); s = state_(m, s)->parent)
+    {
+        path[n++] = s;
+    }
+    while (n > 0u)
+    {
+        const hsm_state_def_t *sd = state_(m, path[--n]);
+        if (sd->entry != NULL)
+        {
+            sd->entry(m);
+        }
+    }
+
+    hsm_state_id_t leaf = dst;
+    for (uint8_t d = 0; (d < HSM_MAX_DEPTH) && (state_(m, leaf)->initial != HSM_NO_CHILD); d++)
+    {
+        leaf = state_(m, leaf)->initial;
+        if (state_(m, leaf)->entry != NULL)
+        {
+            state_(m, leaf)->entry(m);
+        }
+    }
+    m->current    = leaf;
+    m->entered_ms = m->def->now_ms();
+}
+
+static void transition_(hsm_t *m, hsm_state_id_t dst, hsm_event_id_t ev,
+                        hsm_action_fn action)
+{
+    hsm_state_id_t src = m->current;
+    hsm_state_id_t lca = common_ancestor_(m, src, dst);
+
+    for (hsm_state_id_t s = src; s != lca; s = state_(m, s)->parent)
+    {
+        if (state_(m, s)->exit != NULL)
+        {
+            state_(m, s)->exit(m);
+        }
+        if (s == HSM_ROOT)
+        {
+            break;
+        }
+    }
+    if (action != NULL)
+    {
+        action(m);
+    }
+    enter_from_(m, lca, dst);
+    trace_(m, src, ev);
+}
+
+/* ==============================
+ * Trace
+ * ============================== */
+static void trace_(hsm_t *m, hsm_state_id_t from, hsm_event_id_t ev)
+{
+    hsm_trace_t *t = &m->trace[m->trace_count & (HSM_TRACE_LEN - 1u)];
+    t->t_ms  = m->entered_ms;
+    t->from  = from;
+    t->to    = m->current;
+    t->event = ev;
+    m->trace_count++;
+}
+
+bool hsm_trace_get(const hsm_t *m, uint32_t age, hsm_trace_t *out)
+{
+    if ((age >= m->trace_count) || (age >= HSM_TRACE_LEN))
+    {
+        return false;
+    }
+    *out = m->trace[(m->trace_count - 1u - age) & (HSM_TRACE_LEN - 1u)];
+    return true;
+}
+
+void hsm_trace_dump(const hsm_t *m)
+{
+    hsm_trace_t t;
+    char        ev[8];
+    printf("[HSM] last transitions (of %lu):\n", (unsigned long)m->trace_count);
+    for (uint32_t age = HSM_TRACE_LEN; age-- > 0u;)
+    {
+        if (hsm_trace_get(m, age, &t))
+        {
+            if (t.event == HSM_EVT_INIT)
+            {
+                snprintf(ev, sizeof(ev), "init");
+            }
+            else if (t.event == HSM_EVT_TIMEOUT)
+            {
+                snprintf(ev, sizeof(ev), "timeout");
+            }
+            else
+            {
+                snprintf(ev, sizeof(ev), "%u", t.event);
+            }
+            printf("[HSM] %8lu %-12s -> %-12s ev %s\n", (unsigned long)t.t_ms,
+                   hsm_state_name(m, t.from), hsm_state_name(m, t.to), ev);
+        }
+    }
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+void hsm_init(hsm_t *m, const hsm_def_t *def, hsm_state_id_t initial, void *ctx)
+{
+    m->def         = def;
+    m->ctx         = ctx;
+    m->current     = HSM_ROOT;
+    m->trace_count = 0;
+    enter_from_(m, HSM_ROOT, initial);
+    trace_(m, HSM_ROOT, HSM_EVT_INIT);
+}
+
+bool hsm_dispatch(hsm_t *m, hsm_event_id_t ev)
+{
+    if (ev >= m->def->n_events)
+    {
+        return false;
+    }
+    hsm_state_id_t s = m->current;
+    for (uint8_t d = 0; d <= HSM_MAX_DEPTH; d++)
+    {
+        const hsm_trans_t *t = &m->def->table[(s * m->def->n_events) + ev];
+        if ((t->target != HSM_NONE) && ((t->guard == NULL) || t->guard(m)))
+        {
+            if (t->target == HSM_INTERNAL)
+            {
+                if (t->action != NULL)
+                {
+                    t->action(m);
+                }
+            }
+            else
+            {
+                transition_(m, t->target, ev, t->action);
+            }
+            return true;
+        }
+        if (s == HSM_ROOT)
+        {
+            break;
+        }
+        s = state_(m, s)->parent;
+    }
+    return false;
+}
+
+void hsm_tick(hsm_t *m)
+{
+    const hsm_state_def_t *sd = state_(m, m->current);
+    if ((sd->timeout_ms != 0u) && (hsm_time_in_state_ms(m) >= sd->timeout_ms))
+    {
+        transition_(m, sd->on_timeout, HSM_EVT_TIMEOUT, NULL);
+        return;
+    }
+    if (sd->tick != NULL)
+    {
+        sd->tick(m);
+    }
+}
+
+hsm_state_id_t hsm_current(const hsm_t *m)
+{
+    return m->current;
+}
+
+const char *hsm_state_name(const hsm_t *m, hsm_state_id_t s)
+{
+    return (s < m->def->n_states) ? state_(m, s)->name : "?";
+}
+
+bool hsm_in_state(const hsm_t *m, hsm_state_id_t s)
+{
+    return is_ancestor_or_self_(m, s, m->current);
+}
+
+uint32_t hsm_time_in_state_ms(const hsm_t *m)
+{
+    return m->def->now_ms() - m->entered_ms;
+}
+
+/*** end of file ***/
@@ -0,0 +1,99 @@
+//hsm.h
+
+/*
+Table-driven hierarchical state machine.
+
+States and transitions are const tables built at compile time. Dispatch is a
+direct index into a [state][event] table; an event a state does not handle
+(no entry, or its guard is false) is offered to the parent state, up to the
+root (state 0). A transition runs exit actions up to the common ancestor,
+the transition action, then entry actions down to the target and its initial
+children. Each state may carry a timeout that fires from hsm_tick().
+
+The machine has a single owner: call hsm_dispatch()/hsm_tick() from one task
+only. Every state change is recorded in a ring buffer for post-mortems.
+ */
+
+#ifndef HSM_H
+#define HSM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HSM_ROOT                 0u      // Implicit top state; never a target
+#define HSM_NONE                 0u      // "no transition" in table entries
+#define HSM_INTERNAL             0xFEu   // Run the action, stay in the state
+#define HSM_NO_CHILD             0xFFu   // Leaf state (no initial child)
+#define HSM_MAX_DEPTH            4u
+#define HSM_TRACE_LEN            32u     // Power of two
+
+typedef uint8_t hsm_state_id_t;
+typedef uint8_t hsm_event_id_t;
+
+typedef struct hsm hsm_t;
+typedef void (*hsm_action_fn)(hsm_t *m);
+typedef bool (*hsm_guard_fn)(const hsm_t *m);
+
+typedef struct {
+    const char     *name;
+    hsm_state_id_t  parent;      // HSM_ROOT for top-level states
+    hsm_state_id_t  initial;     // Child entered with this state, or HSM_NO_CHILD
+    hsm_action_fn   entry;
+    hsm_action_fn   exit;
+    hsm_action_fn   tick;        // Run by hsm_tick() for the active leaf
+    uint32_t        timeout_ms;  // 0 = none
+    hsm_state_id_t  on_timeout;  // Target when timeout_ms elapses
+} hsm_state_def_t;
+
+typedef struct {
+    hsm_state_id_t  target;      // HSM_NONE = unhandled, HSM_INTERNAL = no change
+    hsm_guard_fn    guard;       // NULL = always
+    hsm_action_fn   action;      // NULL = none
+} hsm_trans_t;
+
+typedef struct {
+    const hsm_state_def_t *states;   // [n_states], index 0 is the root
+    const hsm_trans_t     *table;    // [n_states][n_events], row-major
+    uint8_t                n_states;
+    uint8_t                n_events;
+    uint32_t             (*now_ms)(void);
+} hsm_def_t;
+
+typedef struct {
+    uint32_t        t_ms;
+    hsm_state_id_t  from;
+    hsm_state_id_t  to;
+    hsm_event_id_t  event;           // Or one of the trace markers below
+} hsm_trace_t;
+
+#define HSM_EVT_TIMEOUT          0xFFu   // Trace marker, not a table column
+#define HSM_EVT_INIT             0xFEu   // Trace marker for hsm_init()
+
+struct hsm {
+    const hsm_def_t *def;
+    hsm_state_id_t   current;        // Active leaf
+    uint32_t         entered_ms;
+    void            *ctx;            // Owner data for actions/guards
+    hsm_trace_t      trace[HSM_TRACE_LEN];
+    uint32_t         trace_count;    // Total transitions since init
+};
+
+// Enter 'initial' (and its initial children) with entry actions.
+void hsm_init(hsm_t *m, const hsm_def_t *def, hsm_state_id_t initial, void *ctx);
+
+// Offer an event to the active leaf and its ancestors. True if handled.
+bool hsm_dispatch(hsm_t *m, hsm_event_id_t ev);
+
+// Fire a due timeout, then run the active leaf's tick action.
+void hsm_tick(hsm_t *m);
+
+hsm_state_id_t hsm_current(const hsm_t *m);
+const char    *hsm_state_name(const hsm_t *m, hsm_state_id_t s);
+bool           hsm_in_state(const hsm_t *m, hsm_state_id_t s);   // leaf or ancestor
+uint32_t       hsm_time_in_state_ms(const hsm_t *m);
+
+// Trace entry 'age' transitions back (0 = newest). False if not recorded.
+bool hsm_trace_get(const hsm_t *m, uint32_t age, hsm_trace_t *out);
+void hsm_trace_dump(const hsm_t *m);
+
+#endif
@@ -0,0 +1,518 @@
+/** @file imu_raw_demo.c
+ *  @brief LSM303DLHC driver: accel FIFO + watermark IRQ, DMA I2C burst reads,
+ *         timestamped sample batches for the fusion layer.
+ *
+ *  NOTE: Barr-C style. INT1 is a level interrupt that is masked while a burst
+ *        is in flight and unmasked when it completes, so a FIFO that is still
+ *        above the watermark simply fires again (no lost edges). One burst is
+ *        a single DMA transfer pair: TX feeds the register address and the
+ *        read commands (RESTART first, STOP last) into IC_DATA_CMD, RX drains
+ *        the bytes. No task ever waits on the bus.
+ *  WARNING: Sample times are back-dated from the IRQ time at the tracked ODR.
+ *           If the FIFO holds more than one batch (IRQ latency), the older
+ *           batch is stamped late by up to one batch period.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "imu_raw_demo.h"
+#include "magcal.h"
+#include "attitude.h"
+#include "diag.h"
+#include "smp.h"
+
+/* ==============================
+ * Device Registers
+ * ============================== */
+#define IMU_I2C                 (i2c1)
+#define ACC_ADDR                (0x19u)
+#define MAG_ADDR                (0x1Eu)
+
+#define ACC_CTRL_REG1           (0x20u)
+#define ACC_CTRL_REG3           (0x22u)
+#define ACC_CTRL_REG4           (0x23u)
+#define ACC_CTRL_REG5           (0x24u)
+#define ACC_OUT_X_L             (0x28u)
+#define ACC_FIFO_CTRL           (0x2Eu)
+#define ACC_AUTO_INC            (0x80u)
+
+#define ACC_REG1_100HZ_XYZ      (0x57u)
+#define ACC_REG3_I1_WTM         (0x04u)
+#define ACC_REG4_BDU_HR_2G      (0x88u)
+#define ACC_REG5_FIFO_EN        (0x40u)
+#define ACC_FIFO_BYPASS         (0x00u)
+#define ACC_FIFO_STREAM         (0x80u)
+
+#define MAG_CRA_REG             (0x00u)
+#define MAG_CRB_REG             (0x01u)
+#define MAG_MR_REG              (0x02u)
+#define MAG_OUT_X_H             (0x03u)
+#define MAG_CRA_75HZ            (0x18u)
+#define MAG_CRB_1G3             (0x20u)
+#define MAG_MR_CONTINUOUS       (0x00u)
+
+/* ==============================
+ * Driver Configuration
+ * ============================== */
+#define IMU_SAMPLE_BYTES        (6u)
+#define IMU_BURST_MAX           (IMU_FIFO_WATERMARK * IMU_SAMPLE_BYTES)
+#define IMU_ODR_PERIOD_US       (10000u)     /* 100 Hz nominal */
+#define IMU_ODR_MIN_US          (8000u)
+#define IMU_ODR_MAX_US          (12000u)
+#define IMU_ODR_TRACK_SHIFT     (3)          /* 1/8 per batch */
+#define IMU_BUS_TIMEOUT_US      (5000u)
+#define IMU_CFG_TIMEOUT_US      (2000u)
+#define IMU_QUEUE_LEN           (4u)
+#define IMU_RAD_TO_DEG          (180.0f / (float)M_PI)
+
+/* ==============================
+ * Static State
+ * ============================== */
+typedef enum
+{
+    BUS_IDLE = 0,
+    BUS_ACCEL,
+    BUS_MAG
+} bus_stage_t;
+
+static QueueHandle_t      g_queue       = NULL;
+static StaticQueue_t      g_queue_mem;
+static uint8_t            g_queue_buf[IMU_QUEUE_LEN * sizeof(imu_batch_t)];
+static int                g_tx_ch       = -1;
+static int                g_rx_ch       = -1;
+static dma_channel_config g_tx_cfg;
+static dma_channel_config g_rx_cfg;
+static uint32_t           g_cmd[IMU_BURST_MAX + 1u];
+static uint8_t            g_rx[IMU_BURST_MAX];
+static volatile bus_stage_t g_stage     = BUS_IDLE;
+static alarm_id_t         g_alarm       = 0;
+static bool               g_ready       = false;
+
+static imu_batch_t        g_pending;
+static uint32_t           g_irq_us      = 0;
+static uint32_t           g_prev_irq_us = 0;
+static uint32_t           g_period_us   = IMU_ODR_PERIOD_US;
+static uint32_t           g_seq         = 0;
+static volatile uint32_t  g_dropped     = 0;
+static volatile uint32_t  g_bus_errors  = 0;
+
+static imu_sample_t       g_last_accel;
+static imu_sample_t       g_last_mag;
+static bool               g_have_accel  = false;
+static bool               g_have_mag    = false;
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static bool    write_reg_(uint8_t addr, uint8_t reg, uint8_t val);
+static void    bus_start_(uint8_t addr, uint8_t reg, uint32_t nbytes);
+static void    bus_finish_(bool ok);
+static int64_t bus_timeout_cb_(alarm_id_t id, void *user);
+static void    int1_isr_(void);
+static void    dma_isr_(void);
+static void    unpack_accel_(void);
+static void    unpack_mag_(void);
+static bool    latest_(const imu_sample_t *s, const bool *have,
+                       int16_t *x, int16_t *y, int16_t *z);
+
+/* ==============================
+ * Blocking Configuration Access
+ * ============================== */
+static bool write_reg_(uint8_t addr, uint8_t reg, uint8_t val)
+{
+    uint8_t buf[2] = { reg, val };
+    return (i2c_write_timeout_us(IMU_I2C, addr, buf, 2, false, IMU_CFG_TIMEOUT_US) == 2);
+}
+
+/* ==============================
+ * DMA Burst Engine (IRQ context)
+ * ============================== */
+static void bus_start_(uint8_t addr, uint8_t reg, uint32_t nbytes)
+{
+    i2c_hw_t *hw = i2c_get_hw(IMU_I2C);
+    while (hw->status & I2C_IC_STATUS_ACTIVITY_BITS)
+    {
+        tight_loop_contents();      /* previous STOP still on the wire (<30 us) */
+    }
+    hw->enable = 0;
+    hw->tar    = addr;
+    hw->enable = 1;
+
+    g_cmd[0] = reg;
+    for (uint32_t i = 0; i < nbytes; i++)
+    {
+        uint32_t c = I2C_IC_DATA_CMD_CMD_BITS;
+        if (i == 0u)            c |= I2C_IC_DATA_CMD_RESTART_BITS;
+        if (i == (nbytes - 1u)) c |= I2C_IC_DATA_CMD_STOP_BITS;
+        g_cmd[1u + i] = c;
+    }
+
+    dma_channel_configure((uint)g_rx_ch, &g_rx_cfg, g_rx, &hw->data_cmd, nbytes, false);
+    dma_channel_configure((uint)g_tx_ch, &g_tx_cfg, &hw->data_cmd, g_cmd, nbytes + 1u, false);
+    g_alarm = alarm_pool_add_alarm_in_us(smp_alarm_pool(), IMU_BUS_TIMEOUT_US,
+                                         bus_timeout_cb_, NULL, true);
+    dma_start_channel_mask((1u << g_rx_ch) | (1u << g_tx_ch));
+}
+
+static void bus_finish_(bool ok)
+{
+    if (g_alarm > 0)
+    {
+        alarm_pool_cancel_alarm(smp_alarm_pool(), g_alarm);
+        g_alarm = 0;
+    }
+
+    if (ok && (g_pending.n_accel > 0u))
+    {
+        BaseType_t woken = pdFALSE;
+        if (xQueueIsQueueFullFromISR(g_queue))
+        {
+            /* Consumer behind: keep the newest batches */
+            imu_batch_t stale;
+            (void)xQueueReceiveFromISR(g_queue, &stale, &woken);
+            g_dropped++;
+        }
+        (void)xQueueSendFromISR(g_queue, &g_pending, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+
+    g_stage = BUS_IDLE;
+    gpio_set_irq_enabled(IMU_INT1_PIN, GPIO_IRQ_LEVEL_HIGH, true);
+}
+
+/* A NACK aborts the transfer and the RX channel never completes. */
+static int64_t bus_timeout_cb_(alarm_id_t id, void *user)
+{
+    (void)id;
+    (void)user;
+    g_alarm = 0;
+    if (g_stage == BUS_IDLE)
+    {
+        return 0;
+    }
+
+    dma_channel_abort((uint)g_tx_ch);
+    dma_channel_abort((uint)g_rx_ch);
+    i2c_hw_t *hw = i2c_get_hw(IMU_I2C);
+    (void)hw->clr_tx_abrt;
+    hw->enable = 0;
+    g_bus_errors++;
+    g_prev_irq_us = 0;
+    bus_finish_(false);
+    return 0;
+}
+
+static void int1_isr_(void)
+{
+    if ((gpio_get_irq_event_mask(IMU_INT1_PIN) & GPIO_IRQ_LEVEL_HIGH) == 0u)
+    {
+        return;
+    }
+    /* Level source: mask until the FIFO has been drained */
+    gpio_set_irq_enabled(IMU_INT1_PIN, GPIO_IRQ_LEVEL_HIGH, false);
+    if (g_stage != BUS_IDLE)
+    {
+        return;
+    }
+
+    g_irq_us = time_us_32();
+    g_pending.n_accel   = 0;
+    g_pending.mag_valid = false;
+    g_stage = BUS_ACCEL;
+    bus_start_(ACC_ADDR, ACC_OUT_X_L | ACC_AUTO_INC, IMU_BURST_MAX);
+}
+
+DIAG_ISR_TIMED(int1_isr_timed_, DIAG_ISR_IMU_INT, int1_isr_)
+
+static void dma_isr_(void)
+{
+    if (!dma_channel_get_irq1_status((uint)g_rx_ch))
+    {
+        return;
+    }
+    dma_channel_acknowledge_irq1((uint)g_rx_ch);
+
+    i2c_hw_t *hw = i2c_get_hw(IMU_I2C);
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS)
+    {
+        (void)hw->clr_tx_abrt;
+        g_bus_errors++;
+        g_prev_irq_us = 0;
+        bus_finish_(false);
+        return;
+    }
+
+    if (g_stage == BUS_ACCEL)
+    {
+        unpack_accel_();
+        if (gpio_get(IMU_DRDY_PIN))
+        {
+            g_stage = BUS_MAG;
+            if (g_alarm > 0)
+            {
+                alarm_pool_cancel_alarm(smp_alarm_pool(), g_alarm);
+                g_alarm = 0;
+            }
+            bus_start_(MAG_ADDR, MAG_OUT_X_H, IMU_SAMPLE_BYTES);
+            return;
+        }
+    }
+    else if (g_stage == BUS_MAG)
+    {
+        unpack_mag_();
+    }
+    bus_finish_(true);
+}
+
+DIAG_ISR_TIMED(dma_isr_timed_, DIAG_ISR_IMU_DMA, dma_isr_)
+
+/* ==============================
+ * Sample Unpacking (IRQ context)
+ * ============================== */
+static void unpack_accel_(void)
+{
+    /* Track the real ODR from consecutive watermark interrupts */
+    if (g_prev_irq_us != 0u)
+    {
+        int32_t per = (int32_t)((g_irq_us - g_prev_irq_us) / IMU_FIFO_WATERMARK);
+        if ((per >= (int32_t)IMU_ODR_MIN_US) && (per <= (int32_t)IMU_ODR_MAX_US))
+        {
+            int32_t p = (int32_t)g_period_us;
+            g_period_us = (uint32_t)(p + ((per - p) >> IMU_ODR_TRACK_SHIFT));
+        }
+    }
+    g_prev_irq_us = g_irq_us;
+
+    for (uint32_t i = 0; i < IMU_FIFO_WATERMARK; i++)
+    {
+        const uint8_t *b = &g_rx[i * IMU_SAMPLE_BYTES];
+        imu_sample_t  *s = &g_pending.accel[i];
+        /* 12-bit left-justified, 1 mg/LSB at +/-2 g */
+        s->x    = (int16_t)((int16_t)((uint16_t)b[0] | ((uint16_t)b[1] << 8)) >> 4);
+        s->y    = (int16_t)((int16_t)((uint16_t)b[2] | ((uint16_t)b[3] << 8)) >> 4);
+        s->z    = (int16_t)((int16_t)((uint16_t)b[4] | ((uint16_t)b[5] << 8)) >> 4);
+        s->t_us = g_irq_us - ((IMU_FIFO_WATERMARK - 1u - i) * g_period_us);
+    }
+    g_pending.n_accel = (uint8_t)IMU_FIFO_WATERMARK;
+    g_pending.seq     = ++g_seq;
+    g_last_accel      = g_pending.accel[IMU_FIFO_WATERMARK - 1u];
+    g_have_accel      = true;
+}
+
+static void unpack_mag_(void)
+{
+    /* Output order is X, Z, Y, big-endian */
+    imu_sample_t *s = &g_pending.mag;
+    s->x    = (int16_t)(((uint16_t)g_rx[0] << 8) | g_rx[1]);
+    s->z    = (int16_t)(((uint16_t)g_rx[2] << 8) | g_rx[3]);
+    s->y    = (int16_t)(((uint16_t)g_rx[4] << 8) | g_rx[5]);
+    s->t_us = time_us_32();
+    g_pending.mag_valid = true;
+    g_last_mag          = *s;
+    g_have_mag          = true;
+}
+
+/* ==============================
+ * Cached Sample Access
+ * ============================== */
+static bool latest_(const imu_sample_t *s, const bool *have,
+                    int16_t *x, int16_t *y, int16_t *z)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    imu_sample_t c  = *s;
+    bool         ok = *have;
+    restore_interrupts(irq);
+
+    if (!ok || ((time_us_32() - c.t_us) > (IMU_STALE_MS * 1000u)))
+    {
+        return false;
+    }
+    if (x != NULL) *x = c.x;
+    if (y != NULL) *y = c.y;
+    if (z != NULL) *z = c.z;
+    return true;
+}
+
+/* ==============================
+ * Initialization
+ * ============================== */
+void imu_init(void)
+{
+    if (g_ready)
+    {
+        return;
+    }
+
+    i2c_init(IMU_I2C, IMU_I2C_BAUD);
+    gpio_set_function(IMU_I2C_SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(IMU_I2C_SCL_PIN, GPIO_FUNC_I2C);
+    gpio_pull_up(IMU_I2C_SDA_PIN);
+    gpio_pull_up(IMU_I2C_SCL_PIN);
+
+    gpio_init(IMU_INT1_PIN);
+    gpio_set_dir(IMU_INT1_PIN, GPIO_IN);
+    gpio_init(IMU_DRDY_PIN);
+    gpio_set_dir(IMU_DRDY_PIN, GPIO_IN);
+
+    /* Bypass first to flush the FIFO, then stream with watermark on INT1 */
+    bool ok = write_reg_(ACC_ADDR, ACC_CTRL_REG1, ACC_REG1_100HZ_XYZ) &&
+              write_reg_(ACC_ADDR, ACC_CTRL_REG4, ACC_REG4_BDU_HR_2G) &&
+              write_reg_(ACC_ADDR, ACC_CTRL_REG5, ACC_REG5_FIFO_EN) &&
+              write_reg_(ACC_ADDR, ACC_FIFO_CTRL, ACC_FIFO_BYPASS) &&
+              write_reg_(ACC_ADDR, ACC_FIFO_CTRL, ACC_FIFO_STREAM | IMU_FIFO_WATERMARK) &&
+              write_reg_(ACC_ADDR, ACC_CTRL_REG3, ACC_REG3_I1_WTM);
+    if (!ok)
+    {
+        printf("[IMU] accel not responding\n");
+        return;
+    }
+    if (!(write_reg_(MAG_ADDR, MAG_CRA_REG, MAG_CRA_75HZ) &&
+          write_reg_(MAG_ADDR, MAG_CRB_REG, MAG_CRB_1G3) &&
+          write_reg_(MAG_ADDR, MAG_MR_REG, MAG_MR_CONTINUOUS)))
+    {
+        printf("[IMU] mag not responding\n");
+        return;
+    }
+
+    g_queue = xQueueCreateStatic(IMU_QUEUE_LEN, sizeof(imu_batch_t),
+                                 g_queue_buf, &g_queue_mem);
+    g_tx_ch = dma_claim_unused_channel(false);
+    g_rx_ch = dma_claim_unused_channel(false);
+    if ((g_tx_ch < 0) || (g_rx_ch < 0))
+    {
+        printf("[IMU] DMA channel alloc failed\n");
+        return;
+    }
+
+    i2c_hw_t *hw = i2c_get_hw(IMU_I2C);
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+
+    g_tx_cfg = dma_channel_get_default_config((uint)g_tx_ch);
+    channel_config_set_transfer_data_size(&g_tx_cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&g_tx_cfg, true);
+    channel_config_set_write_increment(&g_tx_cfg, false);
+    channel_config_set_dreq(&g_tx_cfg, i2c_get_dreq(IMU_I2C, true));
+
+    g_rx_cfg = dma_channel_get_default_config((uint)g_rx_ch);
+    channel_config_set_transfer_data_size(&g_rx_cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&g_rx_cfg, false);
+    channel_config_set_write_increment(&g_rx_cfg, true);
+    channel_config_set_dreq(&g_rx_cfg, i2c_get_dreq(IMU_I2C, false));
+
+    irq_add_shared_handler(DMA_IRQ_1, dma_isr_timed_, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    dma_channel_set_irq1_enabled((uint)g_rx_ch, true);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    gpio_add_raw_irq_handler(IMU_INT1_PIN, int1_isr_timed_);
+    gpio_set_irq_enabled(IMU_INT1_PIN, GPIO_IRQ_LEVEL_HIGH, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    g_ready = true;
+    printf("[IMU] LSM303DLHC FIFO wm=%u, DMA ch %d/%d\n",
+           IMU_FIFO_WATERMARK, g_tx_ch, g_rx_ch);
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+bool imu_get_batch(imu_batch_t *out, uint32_t wait_ms)
+{
+    if ((out == NULL) || (g_queue == NULL))
+    {
+        return false;
+    }
+    return (xQueueReceive(g_queue, out, pdMS_TO_TICKS(wait_ms)) == pdTRUE);
+}
+
+uint32_t imu_dropped_batches(void)
+{
+    return g_dropped;
+}
+
+uint32_t imu_bus_errors(void)
+{
+    return g_bus_errors;
+}
+
+bool read_accel_raw(int16_t *raw_ax, int16_t *raw_ay, int16_t *raw_az)
+{
+    return latest_(&g_last_accel, &g_have_accel, raw_ax, raw_ay, raw_az);
+}
+
+bool read_mag_raw(int16_t *mx, int16_t *my, int16_t *mz)
+{
+    return latest_(&g_last_mag, &g_have_mag, mx, my, mz);
+}
+
+bool read_gyro_raw(int16_t *gx, int16_t *gy, int16_t *gz)
+{
+    (void)gx;
+    (void)gy;
+    (void)gz;
+    return false;   /* LSM303DLHC has no gyro */
+}
+
+float calculate_simple_yaw(int16_t mx, int16_t my)
+{
+    float cx, cy, cz;
+    magcal_apply(mx, my, 0, &cx, &cy, &cz);
+    float yaw = atan2f(-cy, cx) * IMU_RAD_TO_DEG;
+    return (yaw < 0.0f) ? (yaw + 360.0f) : yaw;
+}
+
+float get_heading_fast(float *direction_str)
+{
+    float compass = -1.0f;
+    int16_t mx, my, mz;
+    if (read_mag_raw(&mx, &my, &mz))
+    {
+        compass = calculate_simple_yaw(mx, my);
+    }
+    if (direction_str != NULL)
+    {
+        *direction_str = compass;   /* untilted compass, -1 when stale */
+    }
+    return attitude_running() ? attitude_get_yaw_deg() : compass;
+}
+
+void compute_and_print_imu_data(void)
+{
+    int16_t ax, ay, az, mx, my, mz;
+    bool acc = read_accel_raw(&ax, &ay, &az);
+    bool mag = read_mag_raw(&mx, &my, &mz);
+    if (!acc || !mag)
+    {
+        printf("[IMU] no data (acc=%d mag=%d err=%lu)\n",
+               acc, mag, (unsigned long)g_bus_errors);
+        return;
+    }
+    printf("[IMU] A(%d,%d,%d) mg  M(%d,%d,%d)  yaw %.1f  odr %lu us  drop %lu err %lu\n",
+           ax, ay, az, mx, my, mz, calculate_simple_yaw(mx, my),
+           (unsigned long)g_period_us, (unsigned long)g_dropped,
+           (unsigned long)g_bus_errors);
+}
+
+void imu_task(void *params)
+{
+    (void)params;
+    imu_init();
+    while (true)
+    {
+        compute_and_print_imu_data();
+        vTaskDelay(pdMS_TO_TICKS(500));
+    }
+}
+
+/*** end of file ***/
@@ -4,10 +4,49 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/*
+LSM303DLHC accelerometer + magnetometer driver.
+
+The accelerometer runs at 100 Hz into its FIFO (stream mode). INT1 fires
+at the watermark and the driver reads the whole FIFO batch, plus the
+magnetometer when its DRDY line is high, in DMA-driven I2C bursts. Each
+accel sample is timestamped from the interrupt time and the measured
+output data rate. Completed batches are queued for the fusion layer;
+the read_*_raw() calls return the newest cached sample and never touch
+the bus.
+ */
+
+// Wiring (I2C1)
+#define IMU_I2C_SDA_PIN      18u
+#define IMU_I2C_SCL_PIN      19u
+#define IMU_INT1_PIN         20u     // Accel INT1 (FIFO watermark)
+#define IMU_DRDY_PIN         21u     // Mag DRDY
+#define IMU_I2C_BAUD         400000u
+
+// Accel samples per FIFO batch (100 Hz ODR -> 25 batches/s)
+#define IMU_FIFO_WATERMARK   4u
+
+// read_*_raw() report false when the cache is older than this
+#define IMU_STALE_MS         100u
+
+typedef struct {
+    uint32_t t_us;           // Estimated sample time (time_us_32)
+    int16_t  x, y, z;        // Accel: mg; Mag: raw LSB (1100/gauss xy, 980 z)
+} imu_sample_t;
+
+typedef struct {
+    uint32_t     seq;
+    uint8_t      n_accel;
+    bool         mag_valid;
+    imu_sample_t accel[IMU_FIFO_WATERMARK];   // Oldest first
+    imu_sample_t mag;
+} imu_batch_t;
+
 // Function declarations
 void imu_init(void);
 bool read_accel_raw(int16_t *raw_ax, int16_t *raw_ay, int16_t *raw_az);
 bool read_mag_raw(int16_t *mx, int16_t *my, int16_t *mz);  // Add mz parameter
+bool read_gyro_raw(int16_t *gx, int16_t *gy, int16_t *gz); // false when no gyro is fitted
 void compute_and_print_imu_data(void);
 void imu_task(void *params);
 float calculate_simple_yaw(int16_t mx, int16_t my);
@@ -15,4 +54,11 @@ float get_heading_fast(float *direction_str);
 void reset_heading_reference(void);
 void simple_calibration(void);
 
-#endif // IMU_RAW_DEMO_H
\ No newline at end of file
+// Next completed batch; waits up to wait_ms (0 = poll). Single consumer.
+bool imu_get_batch(imu_batch_t *out, uint32_t wait_ms);
+
+// Batches discarded because the consumer fell behind, and bus errors.
+uint32_t imu_dropped_batches(void);
+uint32_t imu_bus_errors(void);
+
+#endif // IMU_RAW_DEMO_H
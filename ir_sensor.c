@@ -5,6 +5,7 @@
  */
 
 #include "ir_sensor.h"
+#include "filter.h"
 #include "hardware/adc.h"
 #include "pico/time.h"
 #include "hardware/gpio.h"
@@ -12,6 +13,11 @@
 #include <stdio.h>
 #include <string.h>
 
+/* ==============================
+ * Constants
+ * ============================== */
+#define IR_BURST_N   (5u)
+
 /* ==============================
  * Initialization
  * ============================== */
@@ -36,20 +42,19 @@ void ir_digital_init(void)
 }
 
 /* ==============================
- * Read Raw (Averaged)
+ * Read Raw (Median of Burst)
  * ============================== */
 uint16_t ir_read_raw(void)
 {
+    /* Back-to-back conversions (2 us each); median drops ADC spikes that
+     * the old 12-sample mean smeared into the reading */
     (void)adc_read();
-    sleep_us(5);
-    const int N = 12;
-    uint32_t acc = 0;
-    for (int i = 0; i < N; i++)
+    float s[IR_BURST_N];
+    for (uint32_t i = 0; i < IR_BURST_N; i++)
     {
-        acc += adc_read();
-        sleep_us(5);
+        s[i] = (float)adc_read();
     }
-    return (uint16_t)(acc / N);
+    return (uint16_t)filter_median5(s[0], s[1], s[2], s[3], s[4]);
 }
 
 bool ir_read_digital(void)
@@ -46,7 +46,7 @@ void ir_init(ir_calib_t *cal);
 // Initialize digital IR sensor pin
 void ir_digital_init(void);
 
-// Read one 12-bit sample with small averaging
+// Read one 12-bit sample (median of a 5-conversion burst)
 uint16_t ir_read_raw(void);
 
 // Read digital IR sensor state
@@ -71,6 +71,9 @@ int  ir_classify(uint16_t sample, const ir_calib_t *cal); // 1=black, 0=white
 // Provide previous state (0=white,1=black) to apply low/high bands around threshold.
 int  ir_classify_hysteresis(uint16_t sample, const ir_calib_t *cal, int prev_state);
 
+// Fixed-threshold colour class on the raw reading: 0=white, 1=black, 2=grey
+int  classify_colour(uint16_t raw);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,342 @@
+/** @file magcal.c
+ *  @brief Spin-and-fit magnetometer calibration persisted in the last flash sector.
+ *
+ *  NOTE: Barr-C style. Conic fit A x^2 + B xy + C y^2 + D x + E y = 1 by
+ *        normal equations (5x5, double precision, run once per calibration).
+ *        Also implements simple_calibration() / reset_heading_reference()
+ *        declared in imu_raw_demo.h.
+ *  WARNING: Flash erase stalls XIP for ~50 ms; flash_safe_execute() parks the
+ *           other core and masks IRQs for that long, so only call
+ *           simple_calibration() while the robot is otherwise idle.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "magcal.h"
+#include "imu_raw_demo.h"
+#include "IMU_movement.h"
+#include "attitude.h"
+#include "motor_encoder_demo.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define MAGCAL_MAGIC           (0x4C41434Du)   /* "MCAL" */
+#define MAGCAL_VERSION         (1u)
+#define MAGCAL_FLASH_OFFSET    (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define MAGCAL_FLASH_TIMEOUT_MS (100u)          /* other core must park by then */
+#define MAGCAL_SCALE           (1000.0)        /* keep conic terms near 1 */
+#define MAGCAL_COVERAGE_BINS   (12u)
+#define MAGCAL_MAX_AXIS_RATIO  (2.0f)
+
+/* ==============================
+ * Static State
+ * ============================== */
+static magcal_t g_cal   = { 0 };
+static bool     g_valid = false;
+static int16_t  g_sx[MAGCAL_MAX_SAMPLES];
+static int16_t  g_sy[MAGCAL_MAX_SAMPLES];
+static uint8_t  g_page[FLASH_PAGE_SIZE];
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static uint32_t crc32_(const uint8_t *p, size_t n);
+static void     set_identity_(magcal_t *c);
+static bool     solve5_(double m[5][6], double x[5]);
+static bool     fit_ellipse_(uint32_t n, magcal_t *out);
+static bool     coverage_ok_(uint32_t n, const magcal_t *c);
+static void     flash_write_(void *param);
+static bool     flash_store_(const magcal_t *c);
+
+/* ==============================
+ * Helpers
+ * ============================== */
+static uint32_t crc32_(const uint8_t *p, size_t n)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; i++)
+    {
+        crc ^= p[i];
+        for (uint32_t b = 0; b < 8u; b++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+static void set_identity_(magcal_t *c)
+{
+    memset(c, 0, sizeof(*c));
+    c->soft[0] = 1.0f;
+    c->soft[3] = 1.0f;
+}
+
+/* Gaussian elimination with partial pivoting on an augmented 5x6 matrix. */
+static bool solve5_(double m[5][6], double x[5])
+{
+    for (int col = 0; col < 5; col++)
+    {
+        int piv = col;
+        for (int r = col + 1; r < 5; r++)
+        {
+            if (fabs(m[r][col]) > fabs(m[piv][col])) piv = r;
+        }
+        if (fabs(m[piv][col]) < 1e-12)
+        {
+            return false;
+        }
+        if (piv != col)
+        {
+            for (int k = 0; k < 6; k++)
+            {
+                double t = m[col][k]; m[col][k] = m[piv][k]; m[piv][k] = t;
+            }
+        }
+        for (int r = col + 1; r < 5; r++)
+        {
+            double f = m[r][col] / m[col][col];
+            for (int k = col; k < 6; k++) m[r][k] -= f * m[col][k];
+        }
+    }
+    for (int r = 4; r >= 0; r--)
+    {
+        double s = m[r][5];
+        for (int k = r + 1; k < 5; k++) s -= m[r][k] * x[k];
+        x[r] = s / m[r][r];
+    }
+    return true;
+}
+
+/* ==============================
+ * Ellipse Fit
+ * ============================== */
+static bool fit_ellipse_(uint32_t n, magcal_t *out)
+{
+    double m[5][6];
+    memset(m, 0, sizeof(m));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        double x = g_sx[i] / MAGCAL_SCALE;
+        double y = g_sy[i] / MAGCAL_SCALE;
+        double phi[5] = { x * x, x * y, y * y, x, y };
+        for (int r = 0; r < 5; r++)
+        {
+            for (int c = 0; c < 5; c++) m[r][c] += phi[r] * phi[c];
+            m[r][5] += phi[r];
+        }
+    }
+
+    double p[5];
+    if (!solve5_(m, p))
+    {
+        return false;
+    }
+    double A = p[0], B = p[1], C = p[2], D = p[3], E = p[4];
+
+    /* Centre: gradient of the conic is zero */
+    double det = (4.0 * A * C) - (B * B);
+    if (det <= 0.0)
+    {
+        return false;       /* not an ellipse */
+    }
+    double x0 = ((B * E) - (2.0 * C * D)) / det;
+    double y0 = ((B * D) - (2.0 * A * E)) / det;
+
+    /* Centred quadratic form Q with u^T Q u = 1 */
+    double g = 1.0 - ((A * x0 * x0) + (B * x0 * y0) + (C * y0 * y0) + (D * x0) + (E * y0));
+    if (g <= 0.0)
+    {
+        return false;
+    }
+    double q11 = A / g, q12 = (B * 0.5) / g, q22 = C / g;
+    double qdet = (q11 * q22) - (q12 * q12);
+    if ((q11 <= 0.0) || (qdet <= 0.0))
+    {
+        return false;
+    }
+
+    /* sqrtm of a 2x2 SPD matrix, scaled so the circle radius is the
+     * geometric mean of the semi-axes */
+    double sd = sqrt(qdet);
+    double t  = sqrt(q11 + q22 + (2.0 * sd));
+    double r  = 1.0 / sqrt(sd);
+    double w11 = r * (q11 + sd) / t;
+    double w12 = r * q12 / t;
+    double w22 = r * (q22 + sd) / t;
+
+    /* Semi-axis ratio sanity check */
+    double tr   = q11 + q22;
+    double disc = sqrt(fmax((tr * tr * 0.25) - qdet, 0.0));
+    double lmax = (tr * 0.5) + disc;
+    double lmin = (tr * 0.5) - disc;
+    if ((lmin <= 0.0) || (sqrt(lmax / lmin) > MAGCAL_MAX_AXIS_RATIO))
+    {
+        return false;
+    }
+
+    set_identity_(out);
+    out->magic     = MAGCAL_MAGIC;
+    out->version   = MAGCAL_VERSION;
+    out->samples   = (uint16_t)n;
+    out->offset[0] = (float)(x0 * MAGCAL_SCALE);
+    out->offset[1] = (float)(y0 * MAGCAL_SCALE);
+    out->offset[2] = 0.0f;
+    out->soft[0]   = (float)w11;
+    out->soft[1]   = (float)w12;
+    out->soft[2]   = (float)w12;
+    out->soft[3]   = (float)w22;
+    out->radius    = (float)(r * MAGCAL_SCALE);
+    return true;
+}
+
+/* Every 30 degree sector around the fitted centre must have been seen. */
+static bool coverage_ok_(uint32_t n, const magcal_t *c)
+{
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        float a = atan2f((float)g_sy[i] - c->offset[1], (float)g_sx[i] - c->offset[0]);
+        uint32_t bin = (uint32_t)(((a + (float)M_PI) / (2.0f * (float)M_PI)) *
+                                  (float)MAGCAL_COVERAGE_BINS);
+        if (bin >= MAGCAL_COVERAGE_BINS) bin = MAGCAL_COVERAGE_BINS - 1u;
+        seen |= (1u << bin);
+    }
+    return (seen == ((1u << MAGCAL_COVERAGE_BINS) - 1u));
+}
+
+/* ==============================
+ * Flash Storage
+ * ============================== */
+/* Runs with both cores kept off flash; must not touch XIP itself. */
+static void flash_write_(void *param)
+{
+    flash_range_erase(MAGCAL_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(MAGCAL_FLASH_OFFSET, (const uint8_t *)param, FLASH_PAGE_SIZE);
+}
+
+static bool flash_store_(const magcal_t *c)
+{
+    memset(g_page, 0xFF, sizeof(g_page));
+    memcpy(g_page, c, sizeof(*c));
+
+    /* Parks the other core (and this core's IRQs) off XIP for the write */
+    int rc = flash_safe_execute(flash_write_, g_page, MAGCAL_FLASH_TIMEOUT_MS);
+    if (rc != PICO_OK)
+    {
+        printf("[MAGCAL] flash write failed (%d)\n", rc);
+        return false;
+    }
+
+    const uint8_t *stored = (const uint8_t *)(XIP_BASE + MAGCAL_FLASH_OFFSET);
+    return (memcmp(stored, c, sizeof(*c)) == 0);
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+bool magcal_load(void)
+{
+    magcal_t c;
+    memcpy(&c, (const void *)(XIP_BASE + MAGCAL_FLASH_OFFSET), sizeof(c));
+
+    uint32_t crc = crc32_((const uint8_t *)&c, offsetof(magcal_t, crc));
+    g_valid = (c.magic == MAGCAL_MAGIC) && (c.version == MAGCAL_VERSION) && (c.crc == crc);
+    if (g_valid)
+    {
+        g_cal = c;
+        printf("[MAGCAL] loaded off(%.0f,%.0f) r=%.0f n=%u\n",
+               c.offset[0], c.offset[1], c.radius, (unsigned)c.samples);
+    }
+    else
+    {
+        set_identity_(&g_cal);
+        printf("[MAGCAL] none stored\n");
+    }
+    return g_valid;
+}
+
+bool magcal_is_valid(void)
+{
+    return g_valid;
+}
+
+void magcal_get(magcal_t *out)
+{
+    if (out != NULL)
+    {
+        *out = g_cal;
+    }
+}
+
+void magcal_apply(int16_t mx, int16_t my, int16_t mz,
+                  float *cx, float *cy, float *cz)
+{
+    float x = (float)mx - g_cal.offset[0];
+    float y = (float)my - g_cal.offset[1];
+    *cx = (g_cal.soft[0] * x) + (g_cal.soft[1] * y);
+    *cy = (g_cal.soft[2] * x) + (g_cal.soft[3] * y);
+    *cz = (float)mz - g_cal.offset[2];
+}
+
+void simple_calibration(void)
+{
+    printf("[MAGCAL] spinning %lu ms\n", (unsigned long)MAGCAL_SPIN_MS);
+
+    uint32_t n  = 0;
+    uint32_t t0 = to_ms_since_boot(get_absolute_time());
+    drive_signed(-MAGCAL_SPIN_PCT * MOTOR_LEFT_TRIM, MAGCAL_SPIN_PCT);
+    while (((to_ms_since_boot(get_absolute_time()) - t0) < MAGCAL_SPIN_MS) &&
+           (n < MAGCAL_MAX_SAMPLES))
+    {
+        int16_t mx, my, mz;
+        if (read_mag_raw(&mx, &my, &mz))
+        {
+            g_sx[n] = mx;
+            g_sy[n] = my;
+            n++;
+        }
+        vTaskDelay(pdMS_TO_TICKS(MAGCAL_SAMPLE_MS));
+    }
+    all_stop();
+
+    magcal_t c;
+    if ((n < MAGCAL_MIN_SAMPLES) || !fit_ellipse_(n, &c) || !coverage_ok_(n, &c))
+    {
+        printf("[MAGCAL] fit rejected (%lu samples)\n", (unsigned long)n);
+        return;
+    }
+    c.crc = crc32_((const uint8_t *)&c, offsetof(magcal_t, crc));
+
+    g_cal   = c;
+    g_valid = true;
+    bool stored = flash_store_(&c);
+    printf("[MAGCAL] off(%.0f,%.0f) W[%.3f %.3f; %.3f %.3f] r=%.0f %s\n",
+           c.offset[0], c.offset[1], c.soft[0], c.soft[1], c.soft[2], c.soft[3],
+           c.radius, stored ? "stored" : "STORE FAILED");
+    attitude_reset_yaw();
+}
+
+void reset_heading_reference(void)
+{
+    /* Re-seed the fused yaw from the compass and hold the current heading */
+    attitude_reset_yaw();
+    vTaskDelay(pdMS_TO_TICKS(2u * ATTITUDE_PERIOD_MS));
+    imu_data_t d;
+    if (read_imu_data(&d))
+    {
+        set_yaw_setpoint(d.yaw);
+    }
+}
+
+/*** end of file ***/
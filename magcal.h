@@ -0,0 +1,52 @@
+//magcal.h
+
+/*
+Magnetometer hard/soft-iron calibration.
+
+simple_calibration() spins the robot in place, records the horizontal
+field and least-squares fits an ellipse to it. The ellipse centre is the
+hard-iron offset; the 2x2 matrix that maps the ellipse back onto a circle
+is the soft-iron correction. The result is kept in the last flash sector
+and loaded at boot, so heading is usable immediately.
+
+The robot only rotates about z, so the z hard-iron offset is not
+observable and is left at zero (tilt compensation uses raw mz).
+ */
+
+#ifndef MAGCAL_H
+#define MAGCAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Spin used for the fit
+#define MAGCAL_SPIN_PCT        35.0f
+#define MAGCAL_SPIN_MS         8000u
+#define MAGCAL_SAMPLE_MS       40u     // One IMU driver batch
+#define MAGCAL_MAX_SAMPLES     400u
+#define MAGCAL_MIN_SAMPLES     100u
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t samples;        // Samples used in the fit
+    float    offset[3];      // Hard-iron (raw LSB)
+    float    soft[4];        // Soft-iron 2x2, row-major, applied to x/y after offset
+    float    radius;         // Corrected horizontal field magnitude (raw LSB)
+    uint32_t crc;
+} magcal_t;
+
+// Load the stored calibration. Returns false if none / corrupt.
+bool magcal_load(void);
+
+// True when a calibration is active.
+bool magcal_is_valid(void);
+
+// Active calibration (identity when none).
+void magcal_get(magcal_t *out);
+
+// Correct a raw sample (identity when no calibration).
+void magcal_apply(int16_t mx, int16_t my, int16_t mz,
+                  float *cx, float *cy, float *cz);
+
+#endif
@@ -9,154 +9,495 @@
 #include "pico/stdlib.h"
 #include "FreeRTOS.h"
 #include "task.h"
-#include "semphr.h"
+#include "event_groups.h"
 
 #include "motor_encoder_demo.h"
 #include "ir_sensor.h"
 #include "ultrasonic.h"
+#include "ranging.h"
 #include "barcode.h"
 #include "Obstacle_Avoidance.h"
 #include "PID_Line_Follow.h"
 #include "mqtt_client.h"
 #include "encoder.h"
 #include "imu_raw_demo.h"
+#include "servo.h"
+#include "occgrid.h"
+#include "turn.h"
+#include "attitude.h"
+#include "magcal.h"
+#include "fxmath.h"
+#include "straight.h"
+#include "collision.h"
+#include "evbus.h"
+#include "hsm.h"
+#include "smp.h"
+#include "motion.h"
+#include "diag.h"
+#include "power.h"
+#include "boot.h"
+#include "supervisor.h"
+#include "trace.h"
 
 /* ==============================
  * Robot States
  * ============================== */
+/* FOLLOW and SCAN are composites; their children share the parent's
+ * handling (e.g. SLIP in FOLLOW, IMPACT/BARCODE at ROOT). Manoeuvres are
+ * motion sequences started on entry and finished by EVBUS_MOTION_DONE. */
 typedef enum
 {
-    STATE_LINE_FOLLOWING,
-    STATE_OBSTACLE_AVOIDANCE,
-    STATE_BARCODE_SCANNING,
-    STATE_WAITING_FOR_JUNCTION,
-    STATE_EXECUTING_TURN
+    RS_ROOT = HSM_ROOT,
+    RS_FOLLOW,
+    RS_LINE,
+    RS_WAIT,
+    RS_AVOID,
+    RS_SCAN,
+    RS_SCAN_BACK,
+    RS_SCAN_DECODE,
+    RS_TURN,
+    RS_BACKOFF,
+    RS_COUNT
 } robot_state_t;
 
+/* Bus events map 1:1 onto HSM events; DONE is raised by tick actions. */
+#define RE_DONE                   ((hsm_event_id_t)EVBUS_TYPE_COUNT)
+#define RE_COUNT                  (EVBUS_TYPE_COUNT + 1)
+
+/* ==============================
+ * Junction Turn
+ * ============================== */
+#define JUNCTION_APPROACH_CM      (8.0f)
+#define JUNCTION_APPROACH_PCT     (40.0f)
+
+/* ==============================
+ * Collision / Slip Response
+ * ============================== */
+#define COLLISION_BACKOFF_CM      (5.0f)
+#define COLLISION_BACKOFF_PCT     (35.0f)
+#define SLIP_PAUSE_MS             (150u)
+
+/* ==============================
+ * Barcode Stop
+ * ============================== */
+#define BARCODE_SETTLE_MS         (500u)
+#define BARCODE_BACKUP_PCT        (30.0f)
+#define BARCODE_BACKUP_MS         (400u)
+
 /* ==============================
- * Shared State
+ * Control Timing
  * ============================== */
-static volatile robot_state_t g_state           = STATE_LINE_FOLLOWING;
-static volatile bool          g_system_active   = true;
-static volatile bool          g_obstacle_flag   = false;
-static volatile char          g_pending_turn[10]= "";
+#define CONTROL_PERIOD_MS         (10u)
+#define SPEED_UPDATE_MS           (100u)
+#define TELEMETRY_MS              (2000u)
+#define TELEMETRY_BEAT_MS         (1000u)   /* heartbeat while nothing is queued */
 
-static SemaphoreHandle_t g_obstacle_mutex;
-static SemaphoreHandle_t g_state_mutex;
-static SemaphoreHandle_t g_turn_mutex;
+/* ==============================
+ * Network Bring-up
+ * ============================== */
+#define NET_RETRY_MS              (5000u)   /* after a failed join/connect */
+#define NET_REPORT_WAIT_MS        (10000u)  /* for the broker before the boot report */
+#define NET_POLL_MS               (100u)
+
+/* ==============================
+ * Telemetry Hand-off
+ * ============================== */
+/* Control (SMP_CORE_CTRL) -> publisher (SMP_CORE_NET); lwIP never runs
+ * in the control task. */
+#define TELEMETRY_SLOTS           (8u)
+#define TELEMETRY_STATE_LEN       (16u)
+
+typedef struct
+{
+    float speed;
+    float distance;
+    float yaw;
+    float ultra;
+    char  state[TELEMETRY_STATE_LEN];
+} telemetry_snap_t;
+
+SMP_RING_DEFINE(g_telemetry_ring, telemetry_snap_t, TELEMETRY_SLOTS);
+static TaskHandle_t g_telemetry_task = NULL;
+
+/* ==============================
+ * Task Storage
+ * ============================== */
+/* Stacks in words. Trim against the high-water marks on BASE_TOPIC/diag,
+ * keeping ~25% headroom; an overflow panics via the stack-check hook. */
+#define INIT_STACK_WORDS          (2048u)
+#define WIFI_STACK_WORDS          (2048u)
+#define TELEMETRY_STACK_WORDS     (1024u)
+#define CONTROL_STACK_WORDS       (4096u)
+
+static StackType_t  g_init_stack[INIT_STACK_WORDS];
+static StaticTask_t g_init_tcb;
+static StackType_t  g_wifi_stack[WIFI_STACK_WORDS];
+static StaticTask_t g_wifi_tcb;
+static StackType_t  g_telemetry_stack[TELEMETRY_STACK_WORDS];
+static StaticTask_t g_telemetry_tcb;
+static StackType_t  g_control_stack[CONTROL_STACK_WORDS];
+static StaticTask_t g_control_tcb;
+
+/* ==============================
+ * Control-Task State
+ * ============================== */
+/* Owned by robot_control_task_: detectors only post events, so no locking. */
+static hsm_t         g_hsm;
+static volatile bool g_system_active   = true;
+static bool          g_turn_right      = true;
+static bool          g_obstacle_done   = false;
+static bool          g_impact_on_line  = false;
+static avoid_status_t g_avoid_result   = AVOID_IDLE;
+static uint32_t      g_pause_until_ms  = 0;
+static uint16_t      g_motion_id       = 0;     /* sequence the HSM waits for */
 
 /* ==============================
  * Prototypes
  * ============================== */
-static void obstacle_detection_task_(void *pv);
-static void barcode_detection_task_(void *pv);
-static void junction_detection_task_(void *pv);
 static void robot_control_task_(void *pv);
 static void wifi_connection_task_(void *pv);
 static void init_task_(void *pv);
-
-static void execute_turn_(const char *dir);
+static void telemetry_task_(void *pv);
 static void initialize_all_systems_(void);
+static void start_tasks_(void);
 static void snapshot_publish_(const char *state_str);
+static uint32_t now_ms_(void);
+
+static void follow_tick_(hsm_t *m);
+static void slip_pause_(hsm_t *m);
+static bool obstacle_pending_(const hsm_t *m);
+static void avoid_entry_(hsm_t *m);
+static void avoid_exit_(hsm_t *m);
+static void avoid_tick_(hsm_t *m);
+static void avoid_done_(hsm_t *m);
+static void run_motion_(const motion_cmd_t *seq, uint8_t n);
+static void motion_exit_(hsm_t *m);
+static void scan_entry_(hsm_t *m);
+static void scan_decode_tick_(hsm_t *m);
+static void discard_frame_(hsm_t *m);
+static void turn_entry_(hsm_t *m);
+static bool pivoting_(const hsm_t *m);
+static void turn_done_(hsm_t *m);
+static void note_impact_(hsm_t *m);
+static void backoff_entry_(hsm_t *m);
+static bool impact_on_line_(const hsm_t *m);
 
 /* ==============================
- * Snapshot Telemetry
+ * State Machine Tables
  * ============================== */
-static void snapshot_publish_(const char *state_str)
+static const hsm_state_def_t g_states[RS_COUNT] =
 {
-    if (!mqtt_is_connected()) return;
-    float speed    = get_current_speed_cm_s();
-    float distance = get_total_distance_cm();
-    float ultra    = ultrasonic_get_distance_cm();
-    float direction= 0.0f;
-    float yaw      = get_heading_fast(&direction);
-    mqtt_publish_telemetry(speed, distance, yaw, ultra, state_str);
-}
+    /*                    name         parent   initial          entry             exit         tick               timeout             on_timeout */
+    [RS_ROOT]          = { "ROOT",      RS_ROOT,  HSM_NO_CHILD,    NULL,             NULL,        NULL,              0u,                 RS_ROOT },
+    [RS_FOLLOW]        = { "FOLLOW",    RS_ROOT,  RS_LINE,         NULL,             NULL,        NULL,              0u,                 RS_ROOT },
+    [RS_LINE]          = { "LINE",      RS_FOLLOW, HSM_NO_CHILD,   NULL,             NULL,        follow_tick_,      0u,                 RS_ROOT },
+    [RS_WAIT]          = { "WAIT",      RS_FOLLOW, HSM_NO_CHILD,   NULL,             NULL,        follow_tick_,      0u,                 RS_ROOT },
+    [RS_AVOID]         = { "AVOID",     RS_ROOT,  HSM_NO_CHILD,    avoid_entry_,     avoid_exit_, avoid_tick_,       0u,                 RS_ROOT },
+    [RS_SCAN]          = { "SCAN",      RS_ROOT,  RS_SCAN_BACK,    scan_entry_,      motion_exit_, NULL,             0u,                 RS_ROOT },
+    [RS_SCAN_BACK]     = { "SCAN_BACK", RS_SCAN,  HSM_NO_CHILD,    NULL,             NULL,        NULL,              0u,                 RS_ROOT },
+    [RS_SCAN_DECODE]   = { "SCAN",      RS_SCAN,  HSM_NO_CHILD,    NULL,             NULL,        scan_decode_tick_, 0u,                 RS_ROOT },
+    [RS_TURN]          = { "TURN",      RS_ROOT,  HSM_NO_CHILD,    turn_entry_,      motion_exit_, NULL,             0u,                 RS_ROOT },
+    [RS_BACKOFF]       = { "BACKOFF",   RS_ROOT,  HSM_NO_CHILD,    backoff_entry_,   motion_exit_, NULL,             0u,                 RS_ROOT },
+};
+
+static const hsm_trans_t g_table[RS_COUNT][RE_COUNT] =
+{
+    [RS_ROOT] =
+    {
+        [EVBUS_BARCODE_FRAME] = { HSM_INTERNAL,   NULL,              discard_frame_ },
+        [EVBUS_IMPACT]        = { RS_BACKOFF,     NULL,              note_impact_ },
+        [EVBUS_MOTION_DONE]   = { RS_LINE,        NULL,              NULL },
+        [RE_DONE]             = { RS_LINE,        NULL,              NULL },
+    },
+    [RS_FOLLOW] =
+    {
+        [EVBUS_SLIP]          = { HSM_INTERNAL,   NULL,              slip_pause_ },
+    },
+    [RS_LINE] =
+    {
+        [EVBUS_OBSTACLE]      = { RS_AVOID,       obstacle_pending_, NULL },
+        [EVBUS_BARCODE_FRAME] = { RS_SCAN,        NULL,              NULL },
+    },
+    [RS_WAIT] =
+    {
+        /* The junction marker is the next frame on the same sensor */
+        [EVBUS_BARCODE_FRAME] = { RS_TURN,        NULL,              discard_frame_ },
+    },
+    [RS_AVOID] =
+    {
+        [RE_DONE]             = { RS_LINE,        NULL,              avoid_done_ },
+    },
+    [RS_SCAN_BACK] =
+    {
+        [EVBUS_MOTION_DONE]   = { RS_SCAN_DECODE, NULL,              NULL },
+    },
+    [RS_SCAN_DECODE] =
+    {
+        [RE_DONE]             = { RS_WAIT,        NULL,              NULL },
+    },
+    [RS_TURN] =
+    {
+        /* Pivots legitimately disagree with the wheels; the approach does not */
+        [EVBUS_IMPACT]        = { HSM_INTERNAL,   pivoting_,         NULL },
+        [EVBUS_MOTION_DONE]   = { RS_LINE,        NULL,              turn_done_ },
+    },
+    [RS_BACKOFF] =
+    {
+        [EVBUS_IMPACT]        = { HSM_INTERNAL,   NULL,              NULL },
+        /* Something below the ultrasonic beam: go round it; else ROOT -> LINE */
+        [EVBUS_MOTION_DONE]   = { RS_AVOID,       impact_on_line_,   NULL },
+    },
+};
+
+static const hsm_def_t g_robot_hsm =
+{
+    .states   = g_states,
+    .table    = &g_table[0][0],
+    .n_states = RS_COUNT,
+    .n_events = RE_COUNT,
+    .now_ms   = now_ms_,
+};
 
 /* ==============================
- * Tasks
+ * Snapshot Telemetry
  * ============================== */
-static void obstacle_detection_task_(void *pv)
+/* Sampled here, published by telemetry_task_; never blocks on the network. */
+static void snapshot_publish_(const char *state_str)
 {
-    (void)pv;
-    const TickType_t interval = pdMS_TO_TICKS(300);
-    while (1)
+    if (!mqtt_is_connected() || (g_telemetry_task == NULL)) return;
+    telemetry_snap_t snap;
+    float direction = 0.0f;
+    snap.speed    = get_current_speed_cm_s();
+    snap.distance = get_total_distance_cm();
+    snap.ultra    = ranging_get_distance_cm();
+    snap.yaw      = get_heading_fast(&direction);
+    strncpy(snap.state, state_str, sizeof(snap.state) - 1u);
+    snap.state[sizeof(snap.state) - 1u] = '\0';
+    if (smp_ring_push(&g_telemetry_ring, &snap))
     {
-        if (ultrasonic_detect_obstacle_fast())
-        {
-            xSemaphoreTake(g_obstacle_mutex, portMAX_DELAY);
-            g_obstacle_flag = true;
-            xSemaphoreGive(g_obstacle_mutex);
-        }
-        vTaskDelay(interval);
+        xTaskNotifyGive(g_telemetry_task);
     }
 }
 
-static void barcode_detection_task_(void *pv)
+static void telemetry_task_(void *pv)
 {
     (void)pv;
-    const TickType_t interval = pdMS_TO_TICKS(100);
+    telemetry_snap_t snap;
     while (1)
     {
-        if (barcode_capture_ready())
+        (void)ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TELEMETRY_BEAT_MS));
+        supervisor_beat(SUP_TELEMETRY);
+        while (smp_ring_pop(&g_telemetry_ring, &snap))
         {
-            xSemaphoreTake(g_state_mutex, portMAX_DELAY);
-            if (g_state == STATE_LINE_FOLLOWING)
-            {
-                g_state = STATE_BARCODE_SCANNING;
-                all_stop();
-                sleep_ms(500);
-                drive_signed(-30.0f * 1.25f, -30.0f);
-                sleep_ms(400);
-                all_stop();
-            }
-            xSemaphoreGive(g_state_mutex);
+            mqtt_publish_telemetry(snap.speed, snap.distance, snap.yaw, snap.ultra, snap.state);
         }
-        vTaskDelay(interval);
     }
 }
 
-static void junction_detection_task_(void *pv)
+static uint32_t now_ms_(void)
 {
-    (void)pv;
-    const TickType_t interval = pdMS_TO_TICKS(50);
-    while (1)
+    return to_ms_since_boot(get_absolute_time());
+}
+
+/* ==============================
+ * Line Following
+ * ============================== */
+static void follow_tick_(hsm_t *m)
+{
+    (void)m;
+    if ((int32_t)(g_pause_until_ms - now_ms_()) > 0)
     {
-        xSemaphoreTake(g_state_mutex, portMAX_DELAY);
-        bool check_junction = (g_state == STATE_WAITING_FOR_JUNCTION);
-        xSemaphoreGive(g_state_mutex);
-        if (check_junction && barcode_capture_ready())
-        {
-            xSemaphoreTake(g_state_mutex, portMAX_DELAY);
-            g_state = STATE_EXECUTING_TURN;
-            xSemaphoreGive(g_state_mutex);
-        }
-        vTaskDelay(interval);
+        return;     /* slip pause: motors already stopped */
     }
+    follow_line_simple();
+}
+
+/* Let the wheels regain grip before the PID winds up */
+static void slip_pause_(hsm_t *m)
+{
+    (void)m;
+    all_stop();
+    g_pause_until_ms = now_ms_() + SLIP_PAUSE_MS;
+    snapshot_publish_("SLIP");
+}
+
+static bool obstacle_pending_(const hsm_t *m)
+{
+    (void)m;
+    return !g_obstacle_done;
 }
 
 /* ==============================
- * Turn Execution
+ * Obstacle Avoidance
  * ============================== */
-static void execute_turn_(const char *dir)
+static void avoid_entry_(hsm_t *m)
 {
+    (void)m;
     all_stop();
-    sleep_ms(500);
+    ranging_set_enabled(false); /* scan owns the sensor */
+    avoid_start();
+    snapshot_publish_("OBS_DET");
+}
+
+static void avoid_exit_(hsm_t *m)
+{
+    (void)m;
+    avoid_abort();              /* no-op when it finished on its own */
+    ranging_set_enabled(true);
+}
 
-    if (strcmp(dir, "RIGHT") == 0)
+static void avoid_tick_(hsm_t *m)
+{
+    g_avoid_result = avoid_tick();
+    const char *note = avoid_take_note();
+    if (note != NULL)
+    {
+        snapshot_publish_(note);
+    }
+    if (g_avoid_result != AVOID_RUNNING)
+    {
+        (void)hsm_dispatch(m, RE_DONE);
+    }
+}
+
+static void avoid_done_(hsm_t *m)
+{
+    (void)m;
+    g_obstacle_done = true;
+    snapshot_publish_((g_avoid_result == AVOID_DONE) ? "AVOID_DONE" : "AVOID_FAIL");
+}
+
+/* ==============================
+ * Motion Sequences
+ * ============================== */
+/* Entry actions may not dispatch: a rejected sequence is reported as a
+ * failed completion through the bus instead. */
+static void run_motion_(const motion_cmd_t *seq, uint8_t n)
+{
+    g_motion_id = motion_run(seq, n);
+    if (g_motion_id == 0u)
     {
-        drive_signed(40.0f, 40.0f);
-        sleep_ms(400);
-        drive_signed(-40.0f, 60.0f);
-        sleep_ms(400);
+        (void)evbus_post(EVBUS_MOTION_DONE, MOTION_DONE_ARG(0u, false));
+    }
+}
+
+static void motion_exit_(hsm_t *m)
+{
+    (void)m;
+    motion_cancel();
+}
+
+/* ==============================
+ * Barcode Scan
+ * ============================== */
+/* Settle, then back over the code before decoding it */
+static void scan_entry_(hsm_t *m)
+{
+    (void)m;
+    static const motion_cmd_t seq[] =
+    {
+        MOTION_CMD_STOP(),
+        MOTION_CMD_HOLD(BARCODE_SETTLE_MS),
+        MOTION_CMD_DRIVE(-BARCODE_BACKUP_PCT * MOTOR_LEFT_TRIM, -BARCODE_BACKUP_PCT,
+                         BARCODE_BACKUP_MS),
+        MOTION_CMD_STOP(),
+    };
+    snapshot_publish_("SCANNING");
+    run_motion_(seq, (uint8_t)(sizeof(seq) / sizeof(seq[0])));
+}
+
+static void scan_decode_tick_(hsm_t *m)
+{
+    barcode_result_t scan;
+    if (barcode_decode_captured(&scan) && scan.valid)
+    {
+        /* Example: decode direction from data (simple heuristic) */
+        g_turn_right = !((scan.length > 0) && (scan.data[0] == 'L'));
+        snapshot_publish_("BC_DONE");
     }
     else
     {
-        drive_signed(40.0f, -40.0f);
-        sleep_ms(400);
+        g_turn_right = true;    /* Fallback default RIGHT */
+        snapshot_publish_("BC_FAIL");
     }
-    all_stop();
-    sleep_ms(800);
+    (void)hsm_dispatch(m, RE_DONE);
+}
+
+static void discard_frame_(hsm_t *m)
+{
+    (void)m;
+    barcode_reset_capture();
+}
+
+/* ==============================
+ * Junction Turn
+ * ============================== */
+static void turn_entry_(hsm_t *m)
+{
+    (void)m;
+    /* RIGHT brings the axle over the junction before pivoting */
+    static const motion_cmd_t right[] =
+    {
+        MOTION_CMD_STOP(),
+        MOTION_CMD_STRAIGHT(JUNCTION_APPROACH_CM, STRAIGHT_HOLD_HEADING, JUNCTION_APPROACH_PCT),
+        MOTION_CMD_TURN(-90.0f),
+        MOTION_CMD_STOP(),
+    };
+    static const motion_cmd_t left[] =
+    {
+        MOTION_CMD_STOP(),
+        MOTION_CMD_TURN(90.0f),
+        MOTION_CMD_STOP(),
+    };
+    if (g_turn_right)
+    {
+        run_motion_(right, (uint8_t)(sizeof(right) / sizeof(right[0])));
+    }
+    else
+    {
+        run_motion_(left, (uint8_t)(sizeof(left) / sizeof(left[0])));
+    }
+}
+
+static bool pivoting_(const hsm_t *m)
+{
+    (void)m;
+    motion_type_t t;
+    return motion_active(&t) && (t == MOTION_TURN);
+}
+
+static void turn_done_(hsm_t *m)
+{
+    (void)m;
+    printf("[TURN] %s err %.1f deg\n", g_turn_right ? "RIGHT" : "LEFT", turn_last_error_deg());
+    snapshot_publish_("TURN_DONE");
+}
+
+/* ==============================
+ * Impact Back-off
+ * ============================== */
+/* Runs after the source state's exit actions, before BACKOFF is entered. */
+static void note_impact_(hsm_t *m)
+{
+    g_impact_on_line = hsm_in_state(m, RS_LINE);
+}
+
+static void backoff_entry_(hsm_t *m)
+{
+    (void)m;
+    static const motion_cmd_t seq[] =
+    {
+        MOTION_CMD_STOP(),
+        MOTION_CMD_STRAIGHT(-COLLISION_BACKOFF_CM, STRAIGHT_HOLD_HEADING, COLLISION_BACKOFF_PCT),
+    };
+    snapshot_publish_("IMPACT");
+    run_motion_(seq, (uint8_t)(sizeof(seq) / sizeof(seq[0])));
+}
+
+static bool impact_on_line_(const hsm_t *m)
+{
+    (void)m;
+    return g_impact_on_line;
 }
 
 /* ==============================
@@ -165,186 +506,144 @@ static void execute_turn_(const char *dir)
 static void robot_control_task_(void *pv)
 {
     (void)pv;
-    uint32_t last_telemetry_ms     = 0;
-    uint32_t last_speed_update_ms  = 0;
-    bool obstacle_done             = false;
+    uint32_t   last_telemetry_ms    = 0;
+    uint32_t   last_speed_update_ms = 0;
+    TickType_t next_step            = xTaskGetTickCount();
 
     speed_calc_init();
     reset_total_distance();
+    hsm_init(&g_hsm, &g_robot_hsm, RS_LINE, NULL);
+    boot_mark(BOOT_CONTROL);
 
     while (g_system_active)
     {
-        uint32_t now = to_ms_since_boot(get_absolute_time());
-
-        if ((now - last_speed_update_ms) >= 100)
-        {
-            update_speed_and_distance_();
-            last_speed_update_ms = now;
-        }
-
-        if (mqtt_is_connected() && (now - last_telemetry_ms >= 2000))
+        /* Sleep until the next control step, waking early for events */
+        next_step += pdMS_TO_TICKS(CONTROL_PERIOD_MS);
+        evbus_event_t ev;
+        for (;;)
         {
-            const char *st = "";
-            xSemaphoreTake(g_state_mutex, portMAX_DELAY);
-            robot_state_t local = g_state;
-            xSemaphoreGive(g_state_mutex);
-
-            switch (local)
-            {
-                case STATE_LINE_FOLLOWING:     st = "LINE"; break;
-                case STATE_OBSTACLE_AVOIDANCE: st = "AVOID"; break;
-                case STATE_BARCODE_SCANNING:   st = "SCAN"; break;
-                case STATE_WAITING_FOR_JUNCTION: st = "WAIT"; break;
-                case STATE_EXECUTING_TURN:     st = "TURN"; break;
-                default:                       st = "UNK";  break;
-            }
-            snapshot_publish_(st);
-            last_telemetry_ms = now;
-        }
-
-        robot_state_t local_state;
-        xSemaphoreTake(g_state_mutex, portMAX_DELAY);
-        local_state = g_state;
-        xSemaphoreGive(g_state_mutex);
-
-        switch (local_state)
-        {
-            case STATE_LINE_FOLLOWING:
-            {
-                follow_line_simple();
-                bool obs_found = false;
-                xSemaphoreTake(g_obstacle_mutex, portMAX_DELAY);
-                obs_found = g_obstacle_flag;
-                g_obstacle_flag = false;
-                xSemaphoreGive(g_obstacle_mutex);
-
-                if (!obstacle_done && obs_found)
-                {
-                    xSemaphoreTake(g_state_mutex, portMAX_DELAY);
-                    g_state = STATE_OBSTACLE_AVOIDANCE;
-                    xSemaphoreGive(g_state_mutex);
-                    all_stop();
-                    sleep_ms(300);
-                    snapshot_publish_("OBS_DET");
-                }
-                break;
-            }
-            case STATE_OBSTACLE_AVOIDANCE:
+            int32_t left = (int32_t)(next_step - xTaskGetTickCount());
+            if (!evbus_wait(&ev, (left > 0) ? (TickType_t)left : 0u))
             {
-                avoid_obstacle_only();
-                xSemaphoreTake(g_state_mutex, portMAX_DELAY);
-                g_state = STATE_LINE_FOLLOWING;
-                xSemaphoreGive(g_state_mutex);
-                obstacle_done = true;
-                snapshot_publish_("AVOID_DONE");
                 break;
             }
-            case STATE_BARCODE_SCANNING:
+            if ((ev.type == EVBUS_MOTION_DONE) && (MOTION_DONE_ID(ev.arg) != g_motion_id))
             {
-                snapshot_publish_("SCANNING");
-                barcode_result_t scan;
-                if (barcode_decode_captured(&scan) && scan.valid)
-                {
-                    char dir[8] = "RIGHT"; /* default */
-                    /* Example: decode direction from data (simple heuristic) */
-                    if ((scan.length > 0) && (scan.data[0] == 'L'))
-                    {
-                        strcpy(dir, "LEFT");
-                    }
-                    xSemaphoreTake(g_turn_mutex, portMAX_DELAY);
-                    strncpy(g_pending_turn, dir, sizeof(g_pending_turn) - 1);
-                    xSemaphoreGive(g_turn_mutex);
-
-                    xSemaphoreTake(g_state_mutex, portMAX_DELAY);
-                    g_state = STATE_WAITING_FOR_JUNCTION;
-                    xSemaphoreGive(g_state_mutex);
-
-                    snapshot_publish_("BC_DONE");
-                }
-                else
-                {
-                    /* Fallback default RIGHT */
-                    xSemaphoreTake(g_turn_mutex, portMAX_DELAY);
-                    strncpy(g_pending_turn, "RIGHT", sizeof(g_pending_turn) - 1);
-                    xSemaphoreGive(g_turn_mutex);
-
-                    xSemaphoreTake(g_state_mutex, portMAX_DELAY);
-                    g_state = STATE_WAITING_FOR_JUNCTION;
-                    xSemaphoreGive(g_state_mutex);
-
-                    snapshot_publish_("BC_FAIL");
-                }
-                break;
-            }
-            case STATE_WAITING_FOR_JUNCTION:
-            {
-                follow_line_simple();
-                break;
+                continue;   /* completion of a sequence cancelled by a state exit */
             }
-            case STATE_EXECUTING_TURN:
-            {
-                char turn_dir[10];
-                xSemaphoreTake(g_turn_mutex, portMAX_DELAY);
-                strncpy(turn_dir, g_pending_turn, sizeof(turn_dir));
-                xSemaphoreGive(g_turn_mutex);
+            (void)hsm_dispatch(&g_hsm, (hsm_event_id_t)ev.type);
+        }
+        if ((int32_t)(xTaskGetTickCount() - next_step) > 0)
+        {
+            next_step = xTaskGetTickCount();    /* overran (blocking manoeuvre) */
+        }
+        supervisor_beat(SUP_CONTROL);
 
-                execute_turn_(turn_dir);
+        uint32_t now = now_ms_();
 
-                xSemaphoreTake(g_state_mutex, portMAX_DELAY);
-                g_state = STATE_LINE_FOLLOWING;
-                xSemaphoreGive(g_state_mutex);
+        if ((now - last_speed_update_ms) >= SPEED_UPDATE_MS)
+        {
+            update_speed_and_distance_();
+            last_speed_update_ms = now;
+        }
 
-                snapshot_publish_("TURN_DONE");
-                sleep_ms(400);
-                break;
-            }
-            default:
-                break;
+        if (mqtt_is_connected() && (now - last_telemetry_ms >= TELEMETRY_MS))
+        {
+            hsm_state_id_t s = hsm_current(&g_hsm);
+            snapshot_publish_((s == RS_AVOID) ? avoid_phase_name() : hsm_state_name(&g_hsm, s));
+            last_telemetry_ms = now;
         }
-        vTaskDelay(pdMS_TO_TICKS(10));
+
+        hsm_tick(&g_hsm);
     }
+    hsm_trace_dump(&g_hsm);
     vTaskDelete(NULL);
 }
 
 /* ==============================
  * System Init
  * ============================== */
+/* No wait for the USB host: early lines may be lost, the boot report and
+ * everything after it are not. */
 static void initialize_all_systems_(void)
 {
-    stdio_init_all();
-    sleep_ms(1500);
-
-    g_obstacle_mutex = xSemaphoreCreateMutex();
-    g_state_mutex    = xSemaphoreCreateMutex();
-    g_turn_mutex     = xSemaphoreCreateMutex();
-
     motor_encoder_init();
     ultrasonic_init();
+    ultrasonic_scheduler_start();
     ir_init(NULL);
     barcode_init();
+    barcode_irq_init();        /* quiet-gap alarm posts EVBUS_BARCODE_FRAME */
     speed_calc_init();
+    boot_mark(BOOT_SENSORS);
     imu_init();
-    servo_init_();
+    boot_mark(BOOT_IMU);
+#if FX_BENCH
+    fx_bench(10000u);
+#endif
+    if (!magcal_load())
+    {
+        simple_calibration();   /* first boot: spin once and store */
+    }
+    servo_init();
+    boot_mark(BOOT_CALIB);
+}
+
+/* None of these needs the network: publishers check mqtt_is_connected() */
+static void start_tasks_(void)
+{
+    g_telemetry_task = smp_task_create_static(telemetry_task_, "telemetry",
+                                              g_telemetry_stack, TELEMETRY_STACK_WORDS,
+                                              &g_telemetry_tcb, NULL,
+                                              tskIDLE_PRIORITY + 2, SMP_CORE_NET);
+    ranging_start(tskIDLE_PRIORITY + 2);
+    attitude_start(tskIDLE_PRIORITY + 3);   /* owns odometry: before the map */
+    occgrid_start(tskIDLE_PRIORITY + 2);
+    collision_start(tskIDLE_PRIORITY + 3);
+    motion_start(tskIDLE_PRIORITY + 4);
+    diag_start(tskIDLE_PRIORITY + 1);
+    trace_start(tskIDLE_PRIORITY + 1);
+    power_start(tskIDLE_PRIORITY + 1);
+    /* Below the timer task only; watches both cores from the network one */
+    supervisor_start(configMAX_PRIORITIES - 2);
+
+    (void)smp_pin_by_name("occ_map", SMP_CORE_NET);
+    (void)smp_pin_by_name("diag", SMP_CORE_NET);
+    (void)smp_pin_by_name("supervisor", SMP_CORE_NET);
+    (void)smp_pin_by_name("trace", SMP_CORE_NET);
+    (void)smp_pin_by_name("power", SMP_CORE_NET);
+    (void)smp_pin_by_name("ranging", SMP_CORE_CTRL);
+    (void)smp_pin_by_name("attitude", SMP_CORE_CTRL);
+    (void)smp_pin_by_name("collision", SMP_CORE_CTRL);
+    (void)smp_pin_by_name("motion", SMP_CORE_CTRL);
+    boot_mark(BOOT_TASKS);
 }
 
 /* ==============================
  * WiFi Task
  * ============================== */
+/* Runs alongside sensor init and the control loop; keeps retrying, so a
+ * late access point or broker only delays telemetry. */
 static void wifi_connection_task_(void *pv)
 {
     (void)pv;
-    if (!wifi_and_mqtt_start())
+    while (!wifi_and_mqtt_start())
     {
-        printf("[NET] WiFi/MQTT failed\n");
+        printf("[NET] WiFi/MQTT failed, retry in %u ms\n", NET_RETRY_MS);
+        vTaskDelay(pdMS_TO_TICKS(NET_RETRY_MS));
     }
-    xTaskCreate(obstacle_detection_task_, "obs_det",
-                1024, NULL, tskIDLE_PRIORITY + 2, NULL);
-    xTaskCreate(barcode_detection_task_, "bc_det",
-                1024, NULL, tskIDLE_PRIORITY + 2, NULL);
-    xTaskCreate(junction_detection_task_, "jn_det",
-                1024, NULL, tskIDLE_PRIORITY + 2, NULL);
-    xTaskCreate(robot_control_task_, "robot_ctl",
-                4096, NULL, tskIDLE_PRIORITY + 1, NULL);
+
+    /* cyw43 is up: its tasks exist and the radio accepts PM settings */
+    (void)smp_pin_by_name("tcpip_thread", SMP_CORE_NET);
+    (void)smp_pin_by_name("async_context_task", SMP_CORE_NET);
+    power_radio_up();
+
+    for (uint32_t waited = 0; !mqtt_is_connected() && (waited < NET_REPORT_WAIT_MS);
+         waited += NET_POLL_MS)
+    {
+        vTaskDelay(pdMS_TO_TICKS(NET_POLL_MS));
+    }
+    boot_report();
+    supervisor_report();
     vTaskDelete(NULL);
 }
 
@@ -354,10 +653,26 @@ static void wifi_connection_task_(void *pv)
 static void init_task_(void *pv)
 {
     (void)pv;
-    vTaskDelay(pdMS_TO_TICKS(100));
+    stdio_init_all();
+    supervisor_init();         /* read last boot's fault before anything resets it */
+    boot_mark(BOOT_STDIO);
+    (void)evbus_init();        /* before any producer (IRQ, ranging, collision) */
+    smp_alarm_pool_init();     /* sensor alarms fire on this (control) core */
+
+    /* Firmware download and the join overlap sensor init. Below init, so
+     * on one core the radio only gets the gaps; cyw43_arch_init() there
+     * claims its IRQ on the networking core. */
+    (void)smp_task_create_static(wifi_connection_task_, "wifi_conn",
+                                 g_wifi_stack, WIFI_STACK_WORDS, &g_wifi_tcb,
+                                 NULL, tskIDLE_PRIORITY + 1, SMP_CORE_NET);
+
     initialize_all_systems_();
-    xTaskCreate(wifi_connection_task_, "wifi_conn",
-                2048, NULL, tskIDLE_PRIORITY + 3, NULL);
+    start_tasks_();
+
+    /* Above the producers so a posted event preempts them immediately */
+    (void)smp_task_create_static(robot_control_task_, "robot_ctl",
+                                 g_control_stack, CONTROL_STACK_WORDS, &g_control_tcb,
+                                 NULL, tskIDLE_PRIORITY + 4, SMP_CORE_CTRL);
     vTaskDelete(NULL);
 }
 
@@ -366,8 +681,10 @@ static void init_task_(void *pv)
  * ============================== */
 int main(void)
 {
-    xTaskCreate(init_task_, "init",
-                2048, NULL, tskIDLE_PRIORITY + 3, NULL);
+    /* Sensor IRQs are enabled by init, so they land on the control core */
+    (void)smp_task_create_static(init_task_, "init",
+                                 g_init_stack, INIT_STACK_WORDS, &g_init_tcb,
+                                 NULL, tskIDLE_PRIORITY + 3, SMP_CORE_CTRL);
     vTaskStartScheduler();
     while (1)
     {
@@ -0,0 +1,271 @@
+/** @file motion.c
+ *  @brief Motion-command task: queued stop/hold/drive/straight/turn sequences.
+ *
+ *  NOTE: Barr-C style. Each 10 ms step runs under g_lock, and motion_cancel()
+ *        takes the same lock and bumps a generation counter. Once cancel
+ *        returns, the task cannot touch the motors for that sequence again.
+ *  WARNING: straight.c and turn.c keep one global move each. While a sequence
+ *           is running, nobody else may call their start/tick functions;
+ *           cancel first.
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#include "motion.h"
+#include "straight.h"
+#include "turn.h"
+#include "motor_encoder_demo.h"
+#include "evbus.h"
+#include "supervisor.h"
+#include "trace.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define MOTION_STACK_WORDS      (1024u)
+#define MOTION_IDLE_BEAT_MS     (100u)      /* heartbeat while the queue is empty */
+
+/* ==============================
+ * Static State
+ * ============================== */
+typedef struct
+{
+    motion_cmd_t cmd;
+    uint16_t     id;
+    uint16_t     gen;
+    bool         last;              /* completion is reported after this one */
+} motion_item_t;
+
+static QueueHandle_t          g_queue       = NULL;
+static SemaphoreHandle_t      g_lock        = NULL;
+static StaticQueue_t          g_queue_mem;
+static uint8_t                g_queue_buf[MOTION_QUEUE_DEPTH * sizeof(motion_item_t)];
+static StaticSemaphore_t      g_lock_mem;
+static StackType_t            g_stack[MOTION_STACK_WORDS];
+static StaticTask_t           g_tcb;
+static uint16_t               g_gen         = 0;
+static uint16_t               g_next_id     = 1;
+static uint16_t               g_failed_id   = 0;
+static volatile bool          g_active      = false;
+static volatile motion_type_t g_active_type = MOTION_STOP;
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static void motion_task_(void *pv);
+static void begin_(const motion_cmd_t *c);
+static bool step_(const motion_cmd_t *c, uint32_t elapsed_ms, bool *ok);
+static void abort_active_(void);
+
+/* ==============================
+ * Command Execution
+ * ============================== */
+static void begin_(const motion_cmd_t *c)
+{
+    switch (c->type)
+    {
+        case MOTION_DRIVE:    drive_signed(c->a, c->b);            break;
+        case MOTION_STRAIGHT: straight_start(c->a, c->b, c->c);    break;
+        case MOTION_TURN:     turn_start(c->a);                    break;
+        case MOTION_STOP:
+        case MOTION_HOLD:
+        default:              all_stop();                          break;
+    }
+}
+
+/* Returns true when the command has finished; *ok false on timeout. */
+static bool step_(const motion_cmd_t *c, uint32_t elapsed_ms, bool *ok)
+{
+    *ok = true;
+    switch (c->type)
+    {
+        case MOTION_HOLD:
+            return (elapsed_ms >= c->ms);
+        case MOTION_DRIVE:
+            if (elapsed_ms >= c->ms)
+            {
+                all_stop();
+                return true;
+            }
+            return false;
+        case MOTION_STRAIGHT:
+        {
+            straight_status_t st = straight_tick();
+            *ok = (st != STRAIGHT_TIMEOUT);
+            return (st != STRAIGHT_RUNNING);
+        }
+        case MOTION_TURN:
+        {
+            turn_status_t st = turn_tick();
+            *ok = (st != TURN_TIMEOUT);
+            return (st != TURN_RUNNING);
+        }
+        case MOTION_STOP:
+        default:
+            return true;
+    }
+}
+
+static void abort_active_(void)
+{
+    if (g_active)
+    {
+        if (g_active_type == MOTION_STRAIGHT)
+        {
+            straight_abort();
+        }
+        else if (g_active_type == MOTION_TURN)
+        {
+            turn_abort();
+        }
+        g_active = false;
+    }
+    all_stop();
+}
+
+/* ==============================
+ * Task
+ * ============================== */
+static void motion_task_(void *pv)
+{
+    (void)pv;
+    motion_item_t it;
+
+    while (1)
+    {
+        supervisor_beat(SUP_MOTION);
+        if (xQueueReceive(g_queue, &it, pdMS_TO_TICKS(MOTION_IDLE_BEAT_MS)) != pdTRUE)
+        {
+            continue;
+        }
+
+        xSemaphoreTake(g_lock, portMAX_DELAY);
+        if ((it.gen != g_gen) || (it.id == g_failed_id))
+        {
+            xSemaphoreGive(g_lock);
+            continue;               /* cancelled, or rest of a failed sequence */
+        }
+        uint32_t t0 = to_ms_since_boot(get_absolute_time());
+        g_active_type = it.cmd.type;
+        g_active      = true;
+        begin_(&it.cmd);
+        xSemaphoreGive(g_lock);
+
+        TickType_t wake      = xTaskGetTickCount();
+        bool       ok        = true;
+        bool       cancelled = false;
+        for (;;)
+        {
+            supervisor_beat(SUP_MOTION);
+            xSemaphoreTake(g_lock, portMAX_DELAY);
+            if (it.gen != g_gen)
+            {
+                xSemaphoreGive(g_lock);
+                cancelled = true;   /* motion_cancel() already stopped it */
+                break;
+            }
+            uint32_t elapsed  = to_ms_since_boot(get_absolute_time()) - t0;
+            bool     finished = step_(&it.cmd, elapsed, &ok);
+            if (finished)
+            {
+                g_active = false;
+            }
+            xSemaphoreGive(g_lock);
+            if (finished)
+            {
+                break;
+            }
+            vTaskDelayUntil(&wake, pdMS_TO_TICKS(MOTION_TICK_MS));
+        }
+
+        if (cancelled)
+        {
+            continue;
+        }
+        if (!ok)
+        {
+            all_stop();
+            g_failed_id = it.id;
+            TRACE(TR_MOTION_TO, it.id, it.cmd.type, 0, 0);
+            (void)evbus_post(EVBUS_MOTION_DONE, MOTION_DONE_ARG(it.id, false));
+        }
+        else if (it.last)
+        {
+            (void)evbus_post(EVBUS_MOTION_DONE, MOTION_DONE_ARG(it.id, true));
+        }
+    }
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+bool motion_start(uint32_t priority)
+{
+    g_queue = xQueueCreateStatic(MOTION_QUEUE_DEPTH, sizeof(motion_item_t),
+                                 g_queue_buf, &g_queue_mem);
+    g_lock  = xSemaphoreCreateMutexStatic(&g_lock_mem);
+    if (xTaskCreateStatic(motion_task_, "motion", MOTION_STACK_WORDS, NULL, priority,
+                          g_stack, &g_tcb) == NULL)
+    {
+        printf("[MOTION] task create failed\n");
+        return false;
+    }
+    return true;
+}
+
+uint16_t motion_run(const motion_cmd_t *seq, uint8_t n)
+{
+    if ((g_queue == NULL) || (seq == NULL) || (n == 0u))
+    {
+        return 0u;
+    }
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    if (uxQueueSpacesAvailable(g_queue) < n)
+    {
+        xSemaphoreGive(g_lock);
+        printf("[MOTION] queue full, sequence of %u dropped\n", n);
+        return 0u;
+    }
+    uint16_t id = g_next_id++;
+    if (g_next_id == 0u)
+    {
+        g_next_id = 1u;
+    }
+    for (uint8_t i = 0; i < n; i++)
+    {
+        motion_item_t it = { seq[i], id, g_gen, (i == (uint8_t)(n - 1u)) };
+        (void)xQueueSend(g_queue, &it, 0);
+    }
+    xSemaphoreGive(g_lock);
+    return id;
+}
+
+void motion_cancel(void)
+{
+    if (g_lock == NULL)
+    {
+        return;
+    }
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    g_gen++;
+    (void)xQueueReset(g_queue);
+    abort_active_();
+    xSemaphoreGive(g_lock);
+}
+
+bool motion_active(motion_type_t *type)
+{
+    if (type != NULL)
+    {
+        *type = g_active_type;
+    }
+    return g_active;
+}
+
+/*** end of file ***/
@@ -0,0 +1,72 @@
+//motion.h
+
+/*
+Asynchronous motion commands.
+
+A motion task executes queued commands one after another at 100 Hz:
+
+  STOP      motors off, completes immediately
+  HOLD      motors off for ms (settle time)
+  DRIVE     open-loop signed duty left/right for ms
+  STRAIGHT  yaw-hold move of cm (encoder-terminated, see straight.h)
+  TURN      closed-loop pivot of deg (see turn.h)
+
+motion_run() enqueues a whole sequence and returns its id; when the last
+command finishes (or a command times out, which drops the rest) the task
+posts EVBUS_MOTION_DONE with arg = MOTION_DONE_ARG(id, ok). The caller keeps
+running and sensing meanwhile. motion_cancel() stops everything and
+returns only once the task is no longer driving the motors, so another
+owner (line follower, avoidance) can take over straight away.
+ */
+
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MOTION_TICK_MS           10u
+#define MOTION_QUEUE_DEPTH       16u
+
+// EVBUS_MOTION_DONE argument: sequence id in the low 16 bits, bit 16 = failed
+#define MOTION_DONE_ARG(id, ok)  ((uint32_t)(id) | ((ok) ? 0u : (1u << 16)))
+#define MOTION_DONE_ID(arg)      ((uint16_t)((arg) & 0xFFFFu))
+#define MOTION_DONE_OK(arg)      (((arg) & (1u << 16)) == 0u)
+
+typedef enum {
+    MOTION_STOP = 0,
+    MOTION_HOLD,
+    MOTION_DRIVE,
+    MOTION_STRAIGHT,
+    MOTION_TURN
+} motion_type_t;
+
+typedef struct {
+    motion_type_t type;
+    float         a;             // DRIVE: left %, STRAIGHT: cm, TURN: deg (CCW +)
+    float         b;             // DRIVE: right %, STRAIGHT: heading (or HOLD)
+    float         c;             // STRAIGHT: speed %
+    uint32_t      ms;            // HOLD / DRIVE duration
+} motion_cmd_t;
+
+// Command builders for sequence initialisers
+#define MOTION_CMD_STOP()                  { MOTION_STOP, 0.0f, 0.0f, 0.0f, 0u }
+#define MOTION_CMD_HOLD(ms)                { MOTION_HOLD, 0.0f, 0.0f, 0.0f, (ms) }
+#define MOTION_CMD_DRIVE(l, r, ms)         { MOTION_DRIVE, (l), (r), 0.0f, (ms) }
+#define MOTION_CMD_STRAIGHT(cm, hdg, pct)  { MOTION_STRAIGHT, (cm), (hdg), (pct), 0u }
+#define MOTION_CMD_TURN(deg)               { MOTION_TURN, (deg), 0.0f, 0.0f, 0u }
+
+// Create the motion task.
+bool motion_start(uint32_t priority);
+
+// Enqueue n commands as one sequence. Returns its id (never 0), or 0 if the
+// queue could not take the whole sequence (nothing is enqueued then).
+uint16_t motion_run(const motion_cmd_t *seq, uint8_t n);
+
+// Drop queued commands, abort the running one and stop the motors.
+void motion_cancel(void);
+
+// Type of the command being executed; false when idle.
+bool motion_active(motion_type_t *type);
+
+#endif
@@ -53,6 +53,11 @@ typedef struct
 static enc_acc_t g_left_enc  = { 0 };
 static enc_acc_t g_right_enc = { 0 };
 
+/* Last commanded duty (signed); encoders are single-channel, so odometry
+ * takes wheel direction from here. */
+static volatile float g_cmd_left_pct  = 0.0f;
+static volatile float g_cmd_right_pct = 0.0f;
+
 /* ==============================
  * Private Prototypes
  * ============================== */
@@ -97,6 +102,9 @@ static void set_pwm_pct_(uint pin, float pct)
  * ============================== */
 void drive_signed(float left_pct, float right_pct)
 {
+    g_cmd_left_pct  = left_pct;
+    g_cmd_right_pct = right_pct;
+
     if (left_pct >= 0.0f)
     {
         set_pwm_pct_(MOTOR1_A_PIN, left_pct);
@@ -125,6 +133,12 @@ void all_stop(void)
     drive_signed(0.0f, 0.0f);
 }
 
+void motor_get_command(float *left_pct, float *right_pct)
+{
+    if (left_pct)  *left_pct  = g_cmd_left_pct;
+    if (right_pct) *right_pct = g_cmd_right_pct;
+}
+
 /* ==============================
  * Encoder Poll (Calibration Only)
  * ============================== */
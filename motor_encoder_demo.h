@@ -12,11 +12,16 @@ typedef struct {
 // External encoder structures
 extern enc_acc_t E1, E2;
 
+// Left/right duty ratio that drives the wheels at the same speed (the left
+// motor is weaker). Shared by every module that sets wheel duties directly.
+#define MOTOR_LEFT_TRIM (1.25f)
+
 // Function declarations
 void setup_pwm(uint pin);
 void set_pwm_pct(uint pin, float pct);
 void drive_signed(float left_pct, float right_pct);
 void all_stop(void);
+void motor_get_command(float *left_pct, float *right_pct);  // last signed duty
 void print_motor_help(void);
 void motor_encoder_init(void);
 void process_motor_command(char* line);
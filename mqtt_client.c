@@ -12,6 +12,7 @@
 #include "pico/cyw43_arch.h"
 
 #include "lwip/apps/mqtt.h"
+#include "lwip/apps/mqtt_priv.h"     /* mqtt_client_t layout for static use */
 #include "lwip/ip_addr.h"
 #include "lwip/dns.h"
 #include "lwip/err.h"
@@ -19,6 +20,8 @@
 #include "lwip/ip4_addr.h"
 
 #include "mqtt_client.h"
+#include "boot.h"
+#include "trace.h"
 #include "FreeRTOS.h"
 #include "task.h"
 
@@ -50,8 +53,10 @@
 /* ==============================
  * Static State
  * ============================== */
+static mqtt_client_t     g_client_mem;
 static mqtt_client_t    *g_client          = NULL;
 static volatile bool     g_mqtt_connected  = false;
+static bool              g_radio_up        = false;
 
 /* ==============================
  * Private Prototypes
@@ -115,6 +120,7 @@ static void mqtt_conn_cb_(mqtt_client_t *client,
     if (status == MQTT_CONNECT_ACCEPTED)
     {
         g_mqtt_connected = true;
+        boot_mark(BOOT_MQTT);
         printf("[MQTT] connected keepalive=%d id=%s\n",
                MQTT_KEEPALIVE_S, MQTT_CLIENT_ID);
 
@@ -157,12 +163,18 @@ bool mqtt_is_connected(void)
  * ============================== */
 bool wifi_and_mqtt_start(void)
 {
-    if (cyw43_arch_init())
+    /* Retries only redo the join and the broker connect */
+    if (!g_radio_up)
     {
-        printf("[NET] cyw43 init fail\n");
-        return false;
+        if (cyw43_arch_init())
+        {
+            printf("[NET] cyw43 init fail\n");
+            return false;
+        }
+        cyw43_arch_enable_sta_mode();
+        g_radio_up = true;
+        boot_mark(BOOT_RADIO);
     }
-    cyw43_arch_enable_sta_mode();
 
     printf("[NET] WiFi SSID=%s\n", WIFI_SSID);
     int r = cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID,
@@ -175,6 +187,7 @@ bool wifi_and_mqtt_start(void)
         return false;
     }
     printf("[NET] WiFi connected\n");
+    boot_mark(BOOT_WIFI);
 
     ip_addr_t broker_ip;
     if (!ipaddr_aton(BROKER_IP, &broker_ip))
@@ -184,14 +197,9 @@ bool wifi_and_mqtt_start(void)
     }
     log_ip_("[MQTT] broker:", &broker_ip);
 
-    cyw43_arch_lwip_begin();
-    g_client = mqtt_client_new();
-    cyw43_arch_lwip_end();
-    if (!g_client)
-    {
-        printf("[MQTT] client_new failed\n");
-        return false;
-    }
+    /* Static instead of mqtt_client_new(): no lwIP heap use, and a
+     * second start reuses the same client. */
+    g_client = &g_client_mem;
 
     struct mqtt_connect_client_info_t ci;
     memset(&ci, 0, sizeof(ci));
@@ -250,10 +258,44 @@ void mqtt_publish_telemetry(float speed,
 
     if (e != ERR_OK)
     {
-        printf("[MQTT] publish err=%d\n", (int)e);
+        TRACE(TR_MQTT_ERR, e, 1, strlen(payload), 0);
     }
 }
 
+/* ==============================
+ * Publish Raw (subtopic under BASE_TOPIC)
+ * ============================== */
+bool mqtt_publish_raw(const char *subtopic,
+                      const void *payload,
+                      uint16_t len,
+                      uint8_t qos,
+                      bool retain)
+{
+    if ((!g_client) || (!g_mqtt_connected) || (subtopic == NULL))
+    {
+        return false;
+    }
+
+    char topic[128];
+    snprintf(topic, sizeof(topic), "%s/%s", BASE_TOPIC, subtopic);
+
+    cyw43_arch_lwip_begin();
+    err_t e = mqtt_publish(g_client,
+                           topic,
+                           payload,
+                           (u16_t)len,
+                           qos, retain ? 1 : 0,
+                           NULL, NULL);
+    cyw43_arch_lwip_end();
+
+    if (e != ERR_OK)
+    {
+        TRACE(TR_MQTT_ERR, e, qos, len, 0);
+        return false;
+    }
+    return true;
+}
+
 /* ==============================
  * Optional Poll (no-op under sys_freertos)
  * ============================== */
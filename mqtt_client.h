@@ -1,5 +1,6 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -10,6 +11,8 @@ void mqtt_publish_telemetry(float speed, float distance_cm, float yaw_deg, float
 void mqtt_loop_poll(void);          // call periodically (non-RTOS)
 bool mqtt_is_connected(void);
 bool wifi_and_mqtt_start_nonblocking(void); // connect Wi-Fi + MQTT (non-blocking)
+bool mqtt_publish_raw(const char* subtopic, const void* payload, uint16_t len,
+                      uint8_t qos, bool retain);  // publish to BASE_TOPIC/<subtopic>
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,446 @@
+/** @file occgrid.c
+ *  @brief Scrolling log-odds occupancy grid fed by the ultrasonic range table.
+ *
+ *  NOTE: Barr-C style. Beams are traced as single rays (Bresenham); the HC-SR04
+ *        cone is not modelled, so walls appear slightly thin at long range.
+ *        Front readings are skipped while the servo is still moving.
+ *
+ *  Compressed map format (little endian):
+ *    [0]  'G'             [1]  version (1)
+ *    [2]  grid size N     [3]  cell size (cm)
+ *    [4]  int16 origin x (cm of cell [0][0])  [6]  int16 origin y
+ *    [8]  int16 robot x (cm)                   [10] int16 robot y
+ *    [12] int16 robot heading (centi-degrees)  [14] uint16 run count
+ *    [16] runs: (class << 6) | (length - 1), row-major from y = 0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "occgrid.h"
+#include "odometry.h"
+#include "ultrasonic.h"
+#include "servo.h"
+#include "mqtt_client.h"
+#include "power.h"
+#include "supervisor.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define OCC_L_HIT              (24)
+#define OCC_L_MISS             (-6)
+#define OCC_L_MAX              (100)
+#define OCC_L_MIN              (-100)
+#define OCC_MAX_RANGE_CM       (200.0f)
+#define OCC_MISS_FREE_CM       (60.0f)     /* trust a no-echo this far */
+#define OCC_RECENTER_MARGIN    (12)        /* cells from edge before scrolling */
+#define OCC_HEADER_BYTES       (16u)
+#define OCC_RUN_MAX            (64u)
+#define OCC_ENCODE_CAP         (OCC_HEADER_BYTES + (OCC_GRID_N * OCC_GRID_N))
+#define OCC_STACK_WORDS        (1024u)
+
+/* Sensor mounting in the robot frame (x forward, y left) */
+#define OCC_FRONT_X_CM         (8.0f)
+#define OCC_FRONT_Y_CM         (0.0f)
+#define OCC_SIDE_X_CM          (0.0f)
+#define OCC_SIDE_Y_CM          (-6.0f)
+#define OCC_SIDE_BEARING_RAD   (-(float)M_PI / 2.0f)
+
+/* ==============================
+ * Static State
+ * ============================== */
+static int8_t            g_cells[OCC_GRID_N][OCC_GRID_N];   /* [y][x] */
+static int32_t           g_origin_ix = 0;                   /* world cell of [0][0] */
+static int32_t           g_origin_iy = 0;
+static SemaphoreHandle_t g_grid_mutex = NULL;
+static StaticSemaphore_t g_grid_mutex_mem;
+static StackType_t       g_stack[OCC_STACK_WORDS];
+static StaticTask_t      g_tcb;
+static uint8_t           g_encode_buf[OCC_ENCODE_CAP];
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static int32_t world_to_cell_(float v_cm);
+static bool    local_index_(int32_t ix, int32_t iy, int *lx, int *ly);
+static void    bump_(int32_t ix, int32_t iy, int8_t delta);
+static void    recenter_(int32_t rix, int32_t riy);
+static void    trace_beam_(float sx, float sy, float ex, float ey, bool hit);
+static bool    occupied_near_(int32_t ix, int32_t iy, int32_t r);
+static void    occgrid_task_(void *pv);
+static void    integrate_sensor_(uint8_t sensor, const odom_pose_t *pose,
+                                 float range_cm);
+static void    put_i16_(uint8_t *p, int32_t v);
+
+/* ==============================
+ * Cell Helpers
+ * ============================== */
+static int32_t world_to_cell_(float v_cm)
+{
+    return (int32_t)floorf(v_cm / OCC_CELL_CM);
+}
+
+static bool local_index_(int32_t ix, int32_t iy, int *lx, int *ly)
+{
+    int32_t x = ix - g_origin_ix;
+    int32_t y = iy - g_origin_iy;
+    if ((x < 0) || (y < 0) || (x >= OCC_GRID_N) || (y >= OCC_GRID_N))
+    {
+        return false;
+    }
+    *lx = (int)x;
+    *ly = (int)y;
+    return true;
+}
+
+static void bump_(int32_t ix, int32_t iy, int8_t delta)
+{
+    int lx, ly;
+    if (!local_index_(ix, iy, &lx, &ly))
+    {
+        return;
+    }
+    int32_t v = (int32_t)g_cells[ly][lx] + delta;
+    if (v > OCC_L_MAX) v = OCC_L_MAX;
+    if (v < OCC_L_MIN) v = OCC_L_MIN;
+    g_cells[ly][lx] = (int8_t)v;
+}
+
+/* Scroll so the robot cell sits in the middle; vacated cells become unknown. */
+static void recenter_(int32_t rix, int32_t riy)
+{
+    int32_t new_ox = rix - (OCC_GRID_N / 2);
+    int32_t new_oy = riy - (OCC_GRID_N / 2);
+    int32_t sx = new_ox - g_origin_ix;
+    int32_t sy = new_oy - g_origin_iy;
+
+    static int8_t tmp[OCC_GRID_N][OCC_GRID_N];
+    memset(tmp, 0, sizeof(tmp));
+    for (int y = 0; y < OCC_GRID_N; y++)
+    {
+        int32_t oy = y + sy;
+        if ((oy < 0) || (oy >= OCC_GRID_N)) continue;
+        for (int x = 0; x < OCC_GRID_N; x++)
+        {
+            int32_t ox = x + sx;
+            if ((ox < 0) || (ox >= OCC_GRID_N)) continue;
+            tmp[y][x] = g_cells[oy][ox];
+        }
+    }
+    memcpy(g_cells, tmp, sizeof(g_cells));
+    g_origin_ix = new_ox;
+    g_origin_iy = new_oy;
+}
+
+/* ==============================
+ * Beam Tracing
+ * ============================== */
+static void trace_beam_(float sx, float sy, float ex, float ey, bool hit)
+{
+    int32_t x0 = world_to_cell_(sx);
+    int32_t y0 = world_to_cell_(sy);
+    int32_t x1 = world_to_cell_(ex);
+    int32_t y1 = world_to_cell_(ey);
+
+    int32_t dx  = abs(x1 - x0);
+    int32_t dy  = -abs(y1 - y0);
+    int32_t stx = (x0 < x1) ? 1 : -1;
+    int32_t sty = (y0 < y1) ? 1 : -1;
+    int32_t err = dx + dy;
+
+    while ((x0 != x1) || (y0 != y1))
+    {
+        bump_(x0, y0, OCC_L_MISS);
+        int32_t e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x0 += stx; }
+        if (e2 <= dx) { err += dx; y0 += sty; }
+    }
+    bump_(x1, y1, hit ? OCC_L_HIT : OCC_L_MISS);
+}
+
+static bool occupied_near_(int32_t ix, int32_t iy, int32_t r)
+{
+    for (int32_t y = iy - r; y <= iy + r; y++)
+    {
+        for (int32_t x = ix - r; x <= ix + r; x++)
+        {
+            int lx, ly;
+            if (local_index_(x, y, &lx, &ly) && (g_cells[ly][lx] >= OCC_THRESH_OCC))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+void occgrid_init(void)
+{
+    if (g_grid_mutex == NULL)
+    {
+        g_grid_mutex = xSemaphoreCreateMutexStatic(&g_grid_mutex_mem);
+    }
+    odom_pose_t pose;
+    odometry_get_pose(&pose);
+
+    xSemaphoreTake(g_grid_mutex, portMAX_DELAY);
+    memset(g_cells, 0, sizeof(g_cells));
+    g_origin_ix = world_to_cell_(pose.x_cm) - (OCC_GRID_N / 2);
+    g_origin_iy = world_to_cell_(pose.y_cm) - (OCC_GRID_N / 2);
+    xSemaphoreGive(g_grid_mutex);
+}
+
+void occgrid_integrate_beam(float sx_cm, float sy_cm, float bearing_rad, float range_cm)
+{
+    bool  hit = (range_cm > 0.0f) && (range_cm <= OCC_MAX_RANGE_CM);
+    float len = hit ? range_cm : OCC_MISS_FREE_CM;
+    float ex  = sx_cm + (len * cosf(bearing_rad));
+    float ey  = sy_cm + (len * sinf(bearing_rad));
+
+    xSemaphoreTake(g_grid_mutex, portMAX_DELAY);
+    trace_beam_(sx_cm, sy_cm, ex, ey, hit);
+    xSemaphoreGive(g_grid_mutex);
+}
+
+int8_t occgrid_get(float x_cm, float y_cm)
+{
+    int lx, ly;
+    int8_t v = 0;
+    xSemaphoreTake(g_grid_mutex, portMAX_DELAY);
+    if (local_index_(world_to_cell_(x_cm), world_to_cell_(y_cm), &lx, &ly))
+    {
+        v = g_cells[ly][lx];
+    }
+    xSemaphoreGive(g_grid_mutex);
+    return v;
+}
+
+occ_class_t occgrid_classify(float x_cm, float y_cm)
+{
+    int8_t v = occgrid_get(x_cm, y_cm);
+    if (v >= OCC_THRESH_OCC)  return OCC_OCCUPIED;
+    if (v <= OCC_THRESH_FREE) return OCC_FREE;
+    return OCC_UNKNOWN;
+}
+
+bool occgrid_segment_clear(float x0_cm, float y0_cm, float x1_cm, float y1_cm,
+                           float clearance_cm)
+{
+    int32_t r     = (int32_t)ceilf(clearance_cm / OCC_CELL_CM);
+    float   len   = hypotf(x1_cm - x0_cm, y1_cm - y0_cm);
+    int32_t steps = (int32_t)ceilf(len / (OCC_CELL_CM * 0.5f));
+    if (steps < 1) steps = 1;
+
+    bool clear = true;
+    xSemaphoreTake(g_grid_mutex, portMAX_DELAY);
+    for (int32_t i = 0; (i <= steps) && clear; i++)
+    {
+        float t = (float)i / (float)steps;
+        int32_t ix = world_to_cell_(x0_cm + (t * (x1_cm - x0_cm)));
+        int32_t iy = world_to_cell_(y0_cm + (t * (y1_cm - y0_cm)));
+        clear = !occupied_near_(ix, iy, r);
+    }
+    xSemaphoreGive(g_grid_mutex);
+    return clear;
+}
+
+float occgrid_raycast(float x_cm, float y_cm, float bearing_rad, float max_cm)
+{
+    float c = cosf(bearing_rad);
+    float s = sinf(bearing_rad);
+    float d = 0.0f;
+
+    xSemaphoreTake(g_grid_mutex, portMAX_DELAY);
+    for (d = 0.0f; d < max_cm; d += (OCC_CELL_CM * 0.5f))
+    {
+        int lx, ly;
+        if (local_index_(world_to_cell_(x_cm + (d * c)),
+                         world_to_cell_(y_cm + (d * s)), &lx, &ly) &&
+            (g_cells[ly][lx] >= OCC_THRESH_OCC))
+        {
+            break;
+        }
+    }
+    xSemaphoreGive(g_grid_mutex);
+    return (d < max_cm) ? d : max_cm;
+}
+
+/* ==============================
+ * Compressed Encoding
+ * ============================== */
+static void put_i16_(uint8_t *p, int32_t v)
+{
+    if (v >  32767) v =  32767;
+    if (v < -32768) v = -32768;
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+}
+
+size_t occgrid_encode(uint8_t *buf, size_t cap)
+{
+    if ((buf == NULL) || (cap < OCC_HEADER_BYTES))
+    {
+        return 0;
+    }
+
+    odom_pose_t pose;
+    odometry_get_pose(&pose);
+
+    buf[0] = 'G';
+    buf[1] = 1u;
+    buf[2] = (uint8_t)OCC_GRID_N;
+    buf[3] = (uint8_t)OCC_CELL_CM;
+    put_i16_(&buf[8],  (int32_t)pose.x_cm);
+    put_i16_(&buf[10], (int32_t)pose.y_cm);
+    put_i16_(&buf[12], (int32_t)(pose.theta_rad * (18000.0f / (float)M_PI)));
+
+    size_t   n    = OCC_HEADER_BYTES;
+    uint32_t runs = 0;
+    uint8_t  cls  = 0xFFu;
+    uint32_t len  = 0;
+
+    xSemaphoreTake(g_grid_mutex, portMAX_DELAY);
+    put_i16_(&buf[4], (int32_t)(g_origin_ix * (int32_t)OCC_CELL_CM));
+    put_i16_(&buf[6], (int32_t)(g_origin_iy * (int32_t)OCC_CELL_CM));
+    for (int y = 0; y < OCC_GRID_N; y++)
+    {
+        for (int x = 0; x < OCC_GRID_N; x++)
+        {
+            int8_t  v = g_cells[y][x];
+            uint8_t c = (v >= OCC_THRESH_OCC)  ? (uint8_t)OCC_OCCUPIED :
+                        (v <= OCC_THRESH_FREE) ? (uint8_t)OCC_FREE :
+                                                 (uint8_t)OCC_UNKNOWN;
+            if ((c == cls) && (len < OCC_RUN_MAX))
+            {
+                len++;
+                continue;
+            }
+            if (len > 0u)
+            {
+                if (n >= cap) break;
+                buf[n++] = (uint8_t)((cls << 6) | (len - 1u));
+                runs++;
+            }
+            cls = c;
+            len = 1u;
+        }
+    }
+    if ((len > 0u) && (n < cap))
+    {
+        buf[n++] = (uint8_t)((cls << 6) | (len - 1u));
+        runs++;
+    }
+    xSemaphoreGive(g_grid_mutex);
+
+    buf[14] = (uint8_t)(runs & 0xFFu);
+    buf[15] = (uint8_t)((runs >> 8) & 0xFFu);
+    return n;
+}
+
+/* ==============================
+ * Mapping Task
+ * ============================== */
+static void integrate_sensor_(uint8_t sensor, const odom_pose_t *pose,
+                              float range_cm)
+{
+    float mx, my, bearing;
+    if (sensor == ULTRA_SENSOR_FRONT)
+    {
+        mx = OCC_FRONT_X_CM;
+        my = OCC_FRONT_Y_CM;
+        bearing = (servo_get_angle_estimate() - SERVO_CENTER_DEG) * ((float)M_PI / 180.0f);
+    }
+    else
+    {
+        mx = OCC_SIDE_X_CM;
+        my = OCC_SIDE_Y_CM;
+        bearing = OCC_SIDE_BEARING_RAD;
+    }
+
+    float c  = cosf(pose->theta_rad);
+    float s  = sinf(pose->theta_rad);
+    float sx = pose->x_cm + (mx * c) - (my * s);
+    float sy = pose->y_cm + (mx * s) + (my * c);
+    occgrid_integrate_beam(sx, sy, pose->theta_rad + bearing, range_cm);
+}
+
+static void occgrid_task_(void *pv)
+{
+    (void)pv;
+    uint32_t   last_seq[ULTRASONIC_NUM_SENSORS] = { 0 };
+    uint32_t   last_pub_ms = 0;
+    TickType_t last_wake   = xTaskGetTickCount();
+
+    while (1)
+    {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(power_parked() ? OCC_MAP_PARKED_MS
+                                                                  : OCC_MAP_PERIOD_MS));
+        supervisor_beat(SUP_OCCGRID);
+
+        odom_pose_t pose;
+        odometry_get_pose(&pose);
+
+        /* Keep the robot away from the grid edges */
+        int32_t rix = world_to_cell_(pose.x_cm);
+        int32_t riy = world_to_cell_(pose.y_cm);
+        int lx, ly;
+        xSemaphoreTake(g_grid_mutex, portMAX_DELAY);
+        if (!local_index_(rix, riy, &lx, &ly) ||
+            (lx < OCC_RECENTER_MARGIN) || (ly < OCC_RECENTER_MARGIN) ||
+            (lx >= (OCC_GRID_N - OCC_RECENTER_MARGIN)) ||
+            (ly >= (OCC_GRID_N - OCC_RECENTER_MARGIN)))
+        {
+            recenter_(rix, riy);
+        }
+        xSemaphoreGive(g_grid_mutex);
+
+        for (uint8_t i = 0; i < ULTRASONIC_NUM_SENSORS; i++)
+        {
+            ultrasonic_range_t r;
+            if (!ultrasonic_get_latest(i, &r) || (r.seq == last_seq[i]))
+            {
+                continue;
+            }
+            last_seq[i] = r.seq;
+            if ((i == ULTRA_SENSOR_FRONT) && !servo_is_ready())
+            {
+                continue;   /* bearing unknown while the horn is moving */
+            }
+            integrate_sensor_(i, &pose, r.distance_cm);
+        }
+
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        if (mqtt_is_connected() && ((now - last_pub_ms) >= OCC_PUBLISH_MS))
+        {
+            size_t n = occgrid_encode(g_encode_buf, sizeof(g_encode_buf));
+            mqtt_publish_raw("map", g_encode_buf, (uint16_t)n, 0, false);
+            last_pub_ms = now;
+        }
+    }
+}
+
+bool occgrid_start(uint32_t priority)
+{
+    occgrid_init();
+    if (xTaskCreateStatic(occgrid_task_, "occ_map", OCC_STACK_WORDS, NULL, priority,
+                          g_stack, &g_tcb) == NULL)
+    {
+        printf("[MAP] task create failed\n");
+        return false;
+    }
+    printf("[MAP] %dx%d @ %.0fcm\n", OCC_GRID_N, OCC_GRID_N, OCC_CELL_CM);
+    return true;
+}
+
+/*** end of file ***/
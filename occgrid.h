@@ -0,0 +1,66 @@
+//occgrid.h
+
+/*
+Local occupancy grid around the robot, built from every ultrasonic range
+reading and the encoder odometry pose.
+
+64 x 64 cells of 5 cm (3.2 m square) stored as int8 log-odds. The grid is
+fixed in the odometry frame and scrolls in whole cells when the robot nears
+an edge, so memory stays constant. The avoidance planner queries it; a
+run-length compressed copy is published on BASE_TOPIC/map.
+ */
+
+#ifndef OCCGRID_H
+#define OCCGRID_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define OCC_GRID_N        64
+#define OCC_CELL_CM       5.0f
+
+// Log-odds cell value bands (int8 units)
+#define OCC_THRESH_OCC    30
+#define OCC_THRESH_FREE  (-20)
+
+// Map refresh / publish timing
+#define OCC_MAP_PERIOD_MS   25u
+#define OCC_MAP_PARKED_MS   200u        // pose is not changing: integrate slower
+#define OCC_PUBLISH_MS      2000u
+
+// Cell classes used by the compressed encoding
+typedef enum {
+    OCC_UNKNOWN = 0,
+    OCC_FREE    = 1,
+    OCC_OCCUPIED = 2
+} occ_class_t;
+
+// Clear the grid and centre it on the current odometry pose.
+void occgrid_init(void);
+
+// Create the mapping task (range integration + publish). Reads the odometry
+// pose only; start it after attitude_start(), which integrates it.
+bool occgrid_start(uint32_t priority);
+
+// Integrate one beam: sensor at (sx, sy) looking along bearing (rad, odom frame).
+// range_cm < 0 means no echo; the near part of the beam is then marked free.
+void occgrid_integrate_beam(float sx_cm, float sy_cm, float bearing_rad, float range_cm);
+
+// Log-odds at a world point (0 = unknown / outside the grid).
+int8_t occgrid_get(float x_cm, float y_cm);
+
+// Cell class at a world point.
+occ_class_t occgrid_classify(float x_cm, float y_cm);
+
+// True if no occupied cell lies within clearance_cm of the segment.
+bool occgrid_segment_clear(float x0_cm, float y0_cm, float x1_cm, float y1_cm,
+                           float clearance_cm);
+
+// Distance to the first occupied cell along a ray, or max_cm if none.
+float occgrid_raycast(float x_cm, float y_cm, float bearing_rad, float max_cm);
+
+// Run-length encode the grid (see occgrid.c for the format). Returns bytes used.
+size_t occgrid_encode(uint8_t *buf, size_t cap);
+
+#endif
@@ -0,0 +1,100 @@
+/** @file odometry.c
+ *  @brief Differential-drive dead reckoning from the signed encoder tick counters.
+ *
+ *  NOTE: Barr-C style. Uses encoder odom_ticks (never reset) so the pose survives
+ *        the encoder_reset_distance() calls made by the turn/leg helpers.
+ *  WARNING: 20 PPR wheels give ~1 cm per tick; heading drifts on slippery floors.
+ */
+
+#include <math.h>
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "odometry.h"
+#include "encoder.h"
+
+/* ==============================
+ * Static State
+ * ============================== */
+static odom_pose_t g_pose        = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0u };
+static int32_t     g_last_left   = 0;
+static int32_t     g_last_right  = 0;
+
+/* ==============================
+ * Public API
+ * ============================== */
+float odometry_wrap_angle(float a)
+{
+    while (a > (float)M_PI)   a -= 2.0f * (float)M_PI;
+    while (a <= -(float)M_PI) a += 2.0f * (float)M_PI;
+    return a;
+}
+
+void odometry_init(void)
+{
+    taskENTER_CRITICAL();
+    g_last_left  = encoder_get_odom_ticks(ENCODER_LEFT_GPIO);
+    g_last_right = encoder_get_odom_ticks(ENCODER_RIGHT_GPIO);
+    g_pose.x_cm = 0.0f;
+    g_pose.y_cm = 0.0f;
+    g_pose.theta_rad = 0.0f;
+    g_pose.v_cm_s = 0.0f;
+    g_pose.w_rad_s = 0.0f;
+    g_pose.timestamp_us = time_us_32();
+    taskEXIT_CRITICAL();
+}
+
+void odometry_update(void)
+{
+    int32_t  l   = encoder_get_odom_ticks(ENCODER_LEFT_GPIO);
+    int32_t  r   = encoder_get_odom_ticks(ENCODER_RIGHT_GPIO);
+    uint32_t now = time_us_32();
+
+    taskENTER_CRITICAL();
+    float dl = (float)(l - g_last_left)  * ENCODER_CM_PER_TICK;
+    float dr = (float)(r - g_last_right) * ENCODER_CM_PER_TICK;
+    g_last_left  = l;
+    g_last_right = r;
+    odom_pose_t p = g_pose;
+    taskEXIT_CRITICAL();
+
+    /* Midpoint integration; trig kept outside the critical section */
+    float ds  = (dl + dr) * 0.5f;
+    float dth = (dr - dl) / ODOM_WHEEL_BASE_CM;
+    float mid = p.theta_rad + (dth * 0.5f);
+    float dx  = ds * cosf(mid);
+    float dy  = ds * sinf(mid);
+    float dt_s = (float)(now - p.timestamp_us) / 1e6f;
+
+    taskENTER_CRITICAL();
+    g_pose.x_cm     += dx;
+    g_pose.y_cm     += dy;
+    g_pose.theta_rad = odometry_wrap_angle(g_pose.theta_rad + dth);
+    if (dt_s > 0.0f)
+    {
+        g_pose.v_cm_s  = ds / dt_s;
+        g_pose.w_rad_s = dth / dt_s;
+    }
+    g_pose.timestamp_us = now;
+    taskEXIT_CRITICAL();
+}
+
+void odometry_get_pose(odom_pose_t *out)
+{
+    if (out == NULL) return;
+    taskENTER_CRITICAL();
+    *out = g_pose;
+    taskEXIT_CRITICAL();
+}
+
+void odometry_reset(float x_cm, float y_cm, float theta_rad)
+{
+    taskENTER_CRITICAL();
+    g_pose.x_cm      = x_cm;
+    g_pose.y_cm      = y_cm;
+    g_pose.theta_rad = odometry_wrap_angle(theta_rad);
+    taskEXIT_CRITICAL();
+}
+
+/*** end of file ***/
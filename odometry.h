@@ -0,0 +1,43 @@
+#ifndef ODOMETRY_H
+#define ODOMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Distance between wheel contact points (measure on the chassis)
+#define ODOM_WHEEL_BASE_CM 13.5f
+
+// Robot pose in the odometry frame: x forward at reset, y left, theta CCW
+typedef struct {
+    float    x_cm;
+    float    y_cm;
+    float    theta_rad;
+    float    v_cm_s;         // Linear speed (signed)
+    float    w_rad_s;        // Yaw rate from wheel differential
+    uint32_t timestamp_us;
+} odom_pose_t;
+
+// Start integrating from the current encoder ticks with pose (0,0,0)
+void odometry_init(void);
+
+// Integrate encoder ticks since the last call (the 100 Hz attitude task)
+void odometry_update(void);
+
+// Snapshot of the current pose
+void odometry_get_pose(odom_pose_t *out);
+
+// Overwrite the pose (e.g. re-anchor on the line)
+void odometry_reset(float x_cm, float y_cm, float theta_rad);
+
+// Wrap an angle to (-pi, pi]
+float odometry_wrap_angle(float a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,176 @@
+/** @file power.c
+ *  @brief Tickless-idle accounting, parked mode, CYW43 power save, current estimate.
+ *
+ *  NOTE: Barr-C style. The sleep hooks run in the idle task with interrupts
+ *        masked, so they only touch two words; everything else happens in
+ *        the low-rate power task.
+ *  WARNING: cyw43_wifi_pm() talks to the radio over SPI. Keep the power task
+ *           on the networking core (SMP_CORE_NET) with the rest of cyw43.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "power.h"
+#include "motion.h"
+#include "encoder.h"
+#include "motor_encoder_demo.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define POWER_DRIVE_PCT          (1.0f)     /* |command| above this = driving */
+#define POWER_SPEED_TIMEOUT_MS   (200u)
+#define POWER_STACK_WORDS        (512u)
+
+#ifdef configNUM_CORES
+#define POWER_CORES              (configNUM_CORES)
+#else
+#define POWER_CORES              (1u)
+#endif
+
+/* ==============================
+ * Static State
+ * ============================== */
+static volatile bool     g_parked       = false;
+static volatile bool     g_radio_up     = false;
+static volatile uint32_t g_sleep_us     = 0;
+static uint32_t          g_sleep_t0     = 0;
+static uint32_t          g_win_sleep_us = 0;
+static uint32_t          g_win_t0       = 0;
+static StackType_t       g_stack[POWER_STACK_WORDS];
+static StaticTask_t      g_tcb;
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static void power_task_(void *pv);
+static bool commanded_(void);
+static bool still_(void);
+static void apply_wifi_pm_(bool parked);
+
+/* ==============================
+ * Inputs
+ * ============================== */
+static bool commanded_(void)
+{
+    float l, r;
+    motor_get_command(&l, &r);
+    return (fabsf(l) > POWER_DRIVE_PCT) || (fabsf(r) > POWER_DRIVE_PCT);
+}
+
+static bool still_(void)
+{
+    return (encoder_get_speed_cm_s_timeout(ENCODER_LEFT_GPIO,  POWER_SPEED_TIMEOUT_MS) == 0.0f) &&
+           (encoder_get_speed_cm_s_timeout(ENCODER_RIGHT_GPIO, POWER_SPEED_TIMEOUT_MS) == 0.0f);
+}
+
+static void apply_wifi_pm_(bool parked)
+{
+    int rc = cyw43_wifi_pm(&cyw43_state, parked ? CYW43_AGGRESSIVE_PM : CYW43_DEFAULT_PM);
+    if (rc != 0)
+    {
+        printf("[PWR] wifi pm err=%d\n", rc);
+    }
+}
+
+/* ==============================
+ * Tickless Hooks
+ * ============================== */
+void power_sleep_begin(void)
+{
+    g_sleep_t0 = time_us_32();
+}
+
+void power_sleep_end(void)
+{
+    g_sleep_us += time_us_32() - g_sleep_t0;
+}
+
+/* ==============================
+ * Task
+ * ============================== */
+static void power_task_(void *pv)
+{
+    (void)pv;
+    TickType_t last_wake = xTaskGetTickCount();
+    uint32_t   still_ms  = 0;
+    bool       pm_set    = false;
+    bool       pm_parked = false;
+
+    while (1)
+    {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(POWER_PERIOD_MS));
+
+        bool idle = !commanded_() && !motion_active(NULL) && still_();
+        still_ms  = idle ? (still_ms + POWER_PERIOD_MS) : 0u;
+
+        bool parked = (still_ms >= POWER_PARK_AFTER_MS);
+        if (parked != g_parked)
+        {
+            g_parked = parked;
+            printf("[PWR] %s\n", parked ? "parked" : "active");
+        }
+
+        /* Parked mode works without the radio; PM follows once it is up */
+        if (g_radio_up && (!pm_set || (pm_parked != parked)))
+        {
+            apply_wifi_pm_(parked);
+            pm_set    = true;
+            pm_parked = parked;
+        }
+    }
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+bool power_start(uint32_t priority)
+{
+    g_win_t0 = time_us_32();
+    if (xTaskCreateStatic(power_task_, "power", POWER_STACK_WORDS, NULL, priority,
+                          g_stack, &g_tcb) == NULL)
+    {
+        printf("[PWR] task create failed\n");
+        return false;
+    }
+    printf("[PWR] tickless idle %s\n", configUSE_TICKLESS_IDLE ? "on" : "off");
+    return true;
+}
+
+void power_radio_up(void)
+{
+    g_radio_up = true;
+}
+
+bool power_parked(void)
+{
+    return g_parked && !commanded_();
+}
+
+void power_get_stats(power_stats_t *out)
+{
+    uint32_t now   = time_us_32();
+    uint32_t slept = g_sleep_us;
+    uint32_t span  = (now - g_win_t0) * POWER_CORES;
+    uint32_t d     = slept - g_win_sleep_us;
+    g_win_t0       = now;
+    g_win_sleep_us = slept;
+
+    out->parked   = g_parked;
+    out->sleep_pm = (span == 0u) ? 0u : (uint32_t)(((uint64_t)d * 1000u) / span);
+    if (out->sleep_pm > 1000u)
+    {
+        out->sleep_pm = 1000u;
+    }
+    float s = (float)out->sleep_pm * 1e-3f;
+    out->est_ma = (POWER_MCU_RUN_MA * (1.0f - s)) + (POWER_MCU_SLEEP_MA * s) +
+                  (g_parked ? POWER_WIFI_AGGR_MA : POWER_WIFI_PM_MA);
+}
+
+/*** end of file ***/
@@ -0,0 +1,59 @@
+//power.h
+
+/*
+Power management: tickless idle accounting, a parked mode for the periodic
+tasks, CYW43 power-save selection and a supply-current estimate.
+
+With configUSE_TICKLESS_IDLE the idle task stops the tick and WFIs until the
+next task timeout or interrupt (GPIO edge, echo, alarm, DMA); the pre/post
+sleep hooks land in power_sleep_begin()/power_sleep_end() so the time
+actually slept is known. The SMP kernel has no tickless idle, so with
+ROBOT_SMP the sleep share reads 0.
+
+The robot counts as parked once the motors have been commanded off, the
+wheels are still and no motion sequence is running for POWER_PARK_AFTER_MS.
+While parked, collision and map tasks stretch their periods and the radio
+goes to CYW43_AGGRESSIVE_PM; any motor command ends it at once.
+
+The current estimate is for the Pico W itself (RP2040 + CYW43), from
+datasheet typicals; motors, servo and sensors are not included.
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define POWER_PERIOD_MS          250u
+#define POWER_PARK_AFTER_MS      2000u
+
+// Estimate inputs (mA, 3.3 V side), datasheet typicals
+#define POWER_MCU_RUN_MA         24.0f     // 125 MHz, one core busy
+#define POWER_MCU_SLEEP_MA       8.0f      // WFI, clocks running
+#define POWER_WIFI_PM_MA         12.0f     // CYW43_DEFAULT_PM, idle link
+#define POWER_WIFI_AGGR_MA       5.0f      // CYW43_AGGRESSIVE_PM
+
+typedef struct {
+    bool     parked;
+    uint32_t sleep_pm;      // share of the window spent in tickless sleep
+    float    est_ma;        // Pico W supply estimate over the window
+} power_stats_t;
+
+// Create the power task; does not need the radio (pin it with the network).
+bool power_start(uint32_t priority);
+
+// The radio is up: apply CYW43 power save from the next period on.
+void power_radio_up(void);
+
+// True while parked and the motors are still commanded off.
+bool power_parked(void);
+
+// Window since the previous call; one caller only (diag).
+void power_get_stats(power_stats_t *out);
+
+// Tickless hooks (configPRE/POST_SLEEP_PROCESSING), interrupts disabled.
+void power_sleep_begin(void);
+void power_sleep_end(void);
+
+#endif
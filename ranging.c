@@ -0,0 +1,303 @@
+/** @file ranging.c
+ *  @brief 40 Hz ultrasonic ranging task: median-of-5, 1-D Kalman, time-to-collision.
+ *
+ *  NOTE: Barr-C style. Closing speed is taken from the wheel encoders, i.e.
+ *        obstacles are assumed static; the Kalman prediction step uses it so
+ *        the estimate tracks between pings instead of lagging the median.
+ *  WARNING: Encoder speed is unsigned; TTC is only meaningful while driving
+ *           forward (line following), which is the only state that consumes it.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "event_groups.h"
+
+#include "ranging.h"
+#include "evbus.h"
+#include "ultrasonic.h"
+#include "encoder.h"
+#include "filter.h"
+#include "supervisor.h"
+
+/* ==============================
+ * Filter Configuration
+ * ============================== */
+#define RANGING_MEDIAN_N          (5u)
+#define RANGING_MEAS_VAR_CM2      (4.0f)      /* HC-SR04 noise incl. beam jitter */
+#define RANGING_PROC_VAR_CM2_S    (400.0f)    /* speed/model uncertainty per s */
+#define RANGING_INIT_VAR_CM2      (25.0f)
+#define RANGING_GATE_SIGMA2       (9.0f)      /* 3-sigma innovation gate */
+#define RANGING_MAX_REJECTS       (3u)        /* re-seed after N gated samples */
+#define RANGING_LOST_SAMPLES      (8u)        /* 200 ms without echo → lost */
+#define RANGING_MIN_CLOSING_CM_S  (1.0f)
+#define RANGING_SPEED_TIMEOUT_MS  (100u)
+#define RANGING_CLEAR_HYST_CM     (5.0f)
+#define RANGING_CLEAR_HYST_S      (0.5f)
+#define RANGING_STACK_WORDS       (1024u)
+
+/* ==============================
+ * Static State
+ * ============================== */
+static EventGroupHandle_t g_events          = NULL;
+static StaticEventGroup_t g_events_mem;
+static StackType_t        g_stack[RANGING_STACK_WORDS];
+static StaticTask_t       g_tcb;
+static volatile bool      g_enabled         = true;
+static volatile bool      g_reset_req       = false;
+static ranging_state_t    g_state           = { -1.0f, -1.0f, 0.0f, 0.0f,
+                                                RANGING_TTC_NONE, 0u, false };
+
+static filter_med_t g_median       = { .len = RANGING_MEDIAN_N };
+static uint32_t     g_miss_count   = 0;
+static uint32_t     g_reject_count = 0;
+static bool         g_hazard       = false;
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static void  ranging_task_(void *pv);
+static float next_raw_cm_(bool *have);
+static float ego_speed_cm_s_(void);
+static void  kalman_step_(ranging_state_t *st, float z, float dt_s);
+static void  update_events_(const ranging_state_t *st);
+static void  reset_filters_(void);
+
+/* ==============================
+ * Ego Speed
+ * ============================== */
+static float ego_speed_cm_s_(void)
+{
+    float l = encoder_get_speed_cm_s_timeout(ENCODER_LEFT_GPIO,  RANGING_SPEED_TIMEOUT_MS);
+    float r = encoder_get_speed_cm_s_timeout(ENCODER_RIGHT_GPIO, RANGING_SPEED_TIMEOUT_MS);
+    return (l + r) * 0.5f;
+}
+
+/* ==============================
+ * 1-D Kalman
+ * ============================== */
+static void kalman_step_(ranging_state_t *st, float z, float dt_s)
+{
+    /* Predict: static obstacle, robot closing at ego speed */
+    if (st->valid)
+    {
+        st->distance_cm  -= st->ego_speed_cm_s * dt_s;
+        st->variance_cm2 += RANGING_PROC_VAR_CM2_S * dt_s;
+    }
+
+    if (z < 0.0f)
+    {
+        return;
+    }
+
+    if (!st->valid)
+    {
+        st->distance_cm  = z;
+        st->variance_cm2 = RANGING_INIT_VAR_CM2;
+        st->valid        = true;
+        g_reject_count   = 0;
+        return;
+    }
+
+    float innov = z - st->distance_cm;
+    float s     = st->variance_cm2 + RANGING_MEAS_VAR_CM2;
+    if ((innov * innov) > (RANGING_GATE_SIGMA2 * s))
+    {
+        if (++g_reject_count < RANGING_MAX_REJECTS)
+        {
+            return;
+        }
+        /* Persistent disagreement: target changed, re-seed */
+        st->distance_cm  = z;
+        st->variance_cm2 = RANGING_INIT_VAR_CM2;
+        g_reject_count   = 0;
+        return;
+    }
+
+    g_reject_count = 0;
+    float k = st->variance_cm2 / s;
+    st->distance_cm  += k * innov;
+    st->variance_cm2 *= (1.0f - k);
+}
+
+/* ==============================
+ * Event Signalling
+ * ============================== */
+static void update_events_(const ranging_state_t *st)
+{
+    bool hazard = st->valid &&
+                  ((st->ttc_s < RANGING_TTC_BRAKE_S) ||
+                   (st->distance_cm < RANGING_NEAR_CM));
+
+    if (hazard && !g_hazard)
+    {
+        g_hazard = true;
+        xEventGroupClearBits(g_events, RANGING_EVT_CLEAR);
+        xEventGroupSetBits(g_events, RANGING_EVT_BRAKE);
+        (void)evbus_post(EVBUS_OBSTACLE, (uint32_t)st->distance_cm);
+    }
+    else if (g_hazard &&
+             (!st->valid ||
+              ((st->distance_cm > (RANGING_NEAR_CM + RANGING_CLEAR_HYST_CM)) &&
+               (st->ttc_s > (RANGING_TTC_BRAKE_S + RANGING_CLEAR_HYST_S)))))
+    {
+        g_hazard = false;
+        xEventGroupSetBits(g_events, RANGING_EVT_CLEAR);
+    }
+}
+
+/* ==============================
+ * Task
+ * ============================== */
+/* Filter state belongs to the ranging task; others ask via g_reset_req. */
+static void reset_filters_(void)
+{
+    taskENTER_CRITICAL();
+    g_state.valid = false;
+    taskEXIT_CRITICAL();
+    filter_med_reset(&g_median);
+    g_miss_count   = 0;
+    g_reject_count = 0;
+    g_hazard       = false;
+    xEventGroupClearBits(g_events, RANGING_EVT_BRAKE | RANGING_EVT_CLEAR);
+}
+
+static float next_raw_cm_(bool *have)
+{
+    /* Paced by the ultrasonic scheduler's front-sensor results */
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2u * RANGING_PERIOD_MS)) > 0u)
+    {
+        ultrasonic_range_t r;
+        ultrasonic_get_latest(ULTRA_SENSOR_FRONT, &r);
+        *have = true;
+        return (r.distance_cm <= RANGING_MAX_RANGE_CM) ? r.distance_cm : -1.0f;
+    }
+
+    /* Scheduler not running: ping directly at the timeout cadence */
+    *have = !ultrasonic_scheduler_running();
+    return *have ? ultrasonic_ping_cm(RANGING_MAX_RANGE_CM) : -1.0f;
+}
+
+static void ranging_task_(void *pv)
+{
+    (void)pv;
+    uint32_t last_ms = to_ms_since_boot(get_absolute_time());
+
+    ultrasonic_set_notify(ULTRA_SENSOR_FRONT, xTaskGetCurrentTaskHandle());
+
+    while (1)
+    {
+        supervisor_beat(SUP_RANGING);
+        bool  have = false;
+        float raw  = next_raw_cm_(&have);
+        if (!have || !g_enabled)
+        {
+            last_ms = to_ms_since_boot(get_absolute_time());
+            continue;
+        }
+        if (g_reset_req)
+        {
+            g_reset_req = false;
+            reset_filters_();
+        }
+
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        float dt_s = (now - last_ms) / 1000.0f;
+        last_ms = now;
+
+        ranging_state_t st;
+        taskENTER_CRITICAL();
+        st = g_state;
+        taskEXIT_CRITICAL();
+
+        st.raw_cm         = raw;
+        st.ego_speed_cm_s = ego_speed_cm_s_();
+
+        float z = -1.0f;
+        if (raw > 0.0f)
+        {
+            g_miss_count = 0;
+            z = filter_med_push(&g_median, raw);
+        }
+        else if (++g_miss_count >= RANGING_LOST_SAMPLES)
+        {
+            st.valid = false;
+            filter_med_reset(&g_median);
+        }
+
+        kalman_step_(&st, z, dt_s);
+
+        st.ttc_s = RANGING_TTC_NONE;
+        if (st.valid && (st.ego_speed_cm_s > RANGING_MIN_CLOSING_CM_S))
+        {
+            float ttc = st.distance_cm / st.ego_speed_cm_s;
+            st.ttc_s = (ttc < RANGING_TTC_NONE) ? ttc : RANGING_TTC_NONE;
+        }
+        st.timestamp_ms = now;
+
+        taskENTER_CRITICAL();
+        g_state = st;
+        taskEXIT_CRITICAL();
+
+        update_events_(&st);
+    }
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+bool ranging_start(uint32_t priority)
+{
+    g_events = xEventGroupCreateStatic(&g_events_mem);
+    if (xTaskCreateStatic(ranging_task_, "ranging", RANGING_STACK_WORDS, NULL, priority,
+                          g_stack, &g_tcb) == NULL)
+    {
+        printf("[RANGE] task create failed\n");
+        return false;
+    }
+    printf("[RANGE] %u Hz, TTC<%.1fs or <%.0fcm\n",
+           1000u / RANGING_PERIOD_MS, RANGING_TTC_BRAKE_S, RANGING_NEAR_CM);
+    return true;
+}
+
+void ranging_set_enabled(bool enabled)
+{
+    if (enabled && !g_enabled)
+    {
+        /* Readings taken by the previous owner were at other servo angles.
+         * Hide them from readers now; the task clears its own filters before
+         * it uses the next sample. */
+        g_reset_req = true;
+        taskENTER_CRITICAL();
+        g_state.valid = false;
+        taskEXIT_CRITICAL();
+        xEventGroupClearBits(g_events, RANGING_EVT_BRAKE | RANGING_EVT_CLEAR);
+    }
+    g_enabled = enabled;
+}
+
+EventGroupHandle_t ranging_get_events(void)
+{
+    return g_events;
+}
+
+void ranging_get_state(ranging_state_t *out)
+{
+    if (out == NULL) return;
+    taskENTER_CRITICAL();
+    *out = g_state;
+    taskEXIT_CRITICAL();
+}
+
+float ranging_get_distance_cm(void)
+{
+    ranging_state_t st;
+    ranging_get_state(&st);
+    return st.valid ? st.distance_cm : -1.0f;
+}
+
+/*** end of file ***/
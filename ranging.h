@@ -0,0 +1,64 @@
+//ranging.h
+
+/*
+Continuous forward ranging pipeline built on the HC-SR04 driver.
+
+A dedicated task pings at the sensor's repetition limit, rejects spikes with a
+median-of-5, smooths with a 1-D Kalman filter driven by encoder ego-speed and
+derives time-to-collision. Hazards are posted to the event bus
+(EVBUS_OBSTACLE) and mirrored in the event group returned by
+ranging_get_events().
+ */
+
+#ifndef RANGING_H
+#define RANGING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "event_groups.h"
+
+// Pipeline timing: one update per front-sensor result from the ultrasonic
+// scheduler (ULTRA_SLOT_US x sensors = 25 ms, 40 Hz); readings beyond the max
+// range are treated as no echo.
+#define RANGING_PERIOD_MS        25u
+#define RANGING_MAX_RANGE_CM     200.0f
+
+// Braking thresholds. TTC triggers earlier at speed; the distance floor
+// still catches obstacles approached slowly or while stationary.
+#define RANGING_TTC_BRAKE_S      1.0f
+#define RANGING_NEAR_CM          20.0f
+
+// TTC reported when the robot is not closing on the target.
+#define RANGING_TTC_NONE         99.0f
+
+// Event bits set in ranging_get_events()
+#define RANGING_EVT_BRAKE        (1u << 0)   // TTC or near-distance threshold crossed
+#define RANGING_EVT_CLEAR        (1u << 1)   // hazard cleared (hysteresis applied)
+
+typedef struct {
+    float    raw_cm;             // Last raw ping (-1 if no echo)
+    float    distance_cm;        // Kalman estimate
+    float    variance_cm2;       // Kalman covariance
+    float    ego_speed_cm_s;     // Encoder speed used as closing speed
+    float    ttc_s;              // Time-to-collision, RANGING_TTC_NONE if not closing
+    uint32_t timestamp_ms;       // Time of last filter update
+    bool     valid;              // Target currently tracked
+} ranging_state_t;
+
+// Create the ranging task (call once after ultrasonic_init()).
+bool ranging_start(uint32_t priority);
+
+// Pause pinging while another routine owns the sensor (e.g. a servo scan).
+void ranging_set_enabled(bool enabled);
+
+// Event group carrying RANGING_EVT_* bits (bits are not auto-cleared).
+EventGroupHandle_t ranging_get_events(void);
+
+// Consistent snapshot of the filter state.
+void ranging_get_state(ranging_state_t *out);
+
+// Filtered distance, or -1.0f when no target is tracked.
+float ranging_get_distance_cm(void);
+
+#endif
@@ -0,0 +1,127 @@
+/** @file servo.c
+ *  @brief SG90 servo PWM driver with slew-rate model and ready-time tracking.
+ *
+ *  NOTE: Barr-C style. Model is dead time + constant slew + settle; a move
+ *        issued mid-travel starts from the current estimate, not the old target.
+ *  WARNING: Slew constant derated for the ultrasonic sensor's inertia; re-measure
+ *           if the servo or supply voltage changes.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "hardware/pwm.h"
+
+#include "servo.h"
+
+/* ==============================
+ * PWM Configuration
+ * ============================== */
+#define SERVO_PWM_WRAP         (20000u)     /* 1 us ticks → 20 ms frame */
+#define SERVO_PWM_CLKDIV       (125.0f)
+
+/* ==============================
+ * Motion State
+ * ============================== */
+static float           g_from_deg   = SERVO_CENTER_DEG;
+static float           g_target_deg = SERVO_CENTER_DEG;
+static absolute_time_t g_cmd_time;
+static absolute_time_t g_ready_at;
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static void  write_pulse_(float angle);
+static float estimate_at_(absolute_time_t t);
+
+/* ==============================
+ * Helpers
+ * ============================== */
+static void write_pulse_(float angle)
+{
+    float pulse_width_us = SERVO_MIN_PULSE_US +
+        (angle / 180.0f) * (SERVO_MAX_PULSE_US - SERVO_MIN_PULSE_US);
+    pwm_set_gpio_level(SERVO_PIN, (uint16_t)pulse_width_us);
+}
+
+static float estimate_at_(absolute_time_t t)
+{
+    int64_t moving_us = absolute_time_diff_us(g_cmd_time, t) - SERVO_DEADTIME_US;
+    if (moving_us <= 0)
+    {
+        return g_from_deg;
+    }
+
+    float travelled = SERVO_SLEW_DEG_PER_S * ((float)moving_us / 1e6f);
+    float delta     = g_target_deg - g_from_deg;
+    if (travelled >= fabsf(delta))
+    {
+        return g_target_deg;
+    }
+    return g_from_deg + ((delta > 0.0f) ? travelled : -travelled);
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+void servo_init(void)
+{
+    gpio_set_function(SERVO_PIN, GPIO_FUNC_PWM);
+    uint slice = pwm_gpio_to_slice_num(SERVO_PIN);
+
+    pwm_config cfg = pwm_get_default_config();
+    pwm_config_set_clkdiv(&cfg, SERVO_PWM_CLKDIV);
+    pwm_config_set_wrap(&cfg, SERVO_PWM_WRAP);
+    pwm_init(slice, &cfg, true);
+
+    /* Power-on position is unknown: wait out a full-range move once */
+    servo_set_angle(SERVO_CENTER_DEG);
+    g_ready_at = delayed_by_us(g_cmd_time,
+                               SERVO_DEADTIME_US + SERVO_SETTLE_US +
+                               (uint64_t)((180.0f / SERVO_SLEW_DEG_PER_S) * 1e6f));
+    servo_wait_ready();
+    printf("[SERVO] init GPIO %d\n", SERVO_PIN);
+}
+
+void servo_set_angle(float angle)
+{
+    if (angle < 0.0f)  angle = 0.0f;
+    if (angle > 180.0f) angle = 180.0f;
+
+    absolute_time_t now = get_absolute_time();
+    g_from_deg   = estimate_at_(now);
+    g_target_deg = angle;
+    g_cmd_time   = now;
+
+    float travel_us = (fabsf(g_target_deg - g_from_deg) / SERVO_SLEW_DEG_PER_S) * 1e6f;
+    g_ready_at = delayed_by_us(now, SERVO_DEADTIME_US + SERVO_SETTLE_US +
+                                    (uint64_t)travel_us);
+    write_pulse_(angle);
+}
+
+float servo_get_commanded_angle(void)
+{
+    return g_target_deg;
+}
+
+float servo_get_angle_estimate(void)
+{
+    return estimate_at_(get_absolute_time());
+}
+
+absolute_time_t servo_ready_at(void)
+{
+    return g_ready_at;
+}
+
+bool servo_is_ready(void)
+{
+    return time_reached(g_ready_at);
+}
+
+void servo_wait_ready(void)
+{
+    sleep_until(g_ready_at);
+}
+
+/*** end of file ***/
@@ -0,0 +1,52 @@
+//servo.h
+
+/*
+SG90-class hobby servo driver with a slew-rate motion model.
+
+The PWM pulse is written instantly, but the horn takes time to get there.
+The driver tracks the commanded angle and an estimate of the actual angle,
+and exposes the time at which the servo is expected to be settled so callers
+wait exactly as long as the move needs instead of a fixed worst case.
+ */
+
+#ifndef SERVO_H
+#define SERVO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+
+#define SERVO_PIN 15
+#define SERVO_MIN_PULSE_US 500
+#define SERVO_MAX_PULSE_US 2500
+
+// Mechanical centre (sensor looking straight ahead)
+#define SERVO_CENTER_DEG 85.0f
+
+// Motion model (SG90 at 5 V: ~0.1 s / 60 deg unloaded, derated for the sensor)
+#define SERVO_SLEW_DEG_PER_S 450.0f
+#define SERVO_DEADTIME_US    20000u   // up to one 50 Hz frame before the new pulse
+#define SERVO_SETTLE_US      15000u   // overshoot damping at the end of travel
+
+// Configure PWM and centre the servo (blocks until settled).
+void servo_init(void);
+
+// Command a new angle (clamped to 0..180). Returns immediately.
+void servo_set_angle(float angle);
+
+// Last commanded angle.
+float servo_get_commanded_angle(void);
+
+// Model estimate of the horn angle right now.
+float servo_get_angle_estimate(void);
+
+// Time at which the last command is expected to be complete.
+absolute_time_t servo_ready_at(void);
+
+// True once servo_ready_at() has passed.
+bool servo_is_ready(void);
+
+// Block the calling task until the servo has settled.
+void servo_wait_ready(void);
+
+#endif
@@ -0,0 +1,124 @@
+/** @file smp.c
+ *  @brief Task core placement helpers and the cross-core SPSC ring.
+ *
+ *  NOTE: Barr-C style. The ring needs no lock: head is only written by the
+ *        producer and tail only by the consumer; a data memory barrier
+ *        orders the slot copy against the index publish on both cores.
+ *  WARNING: One producer task and one consumer task per ring. Two writers
+ *           (or an ISR and a task) on the same side need their own ring.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "smp.h"
+
+/* ==============================
+ * Static State
+ * ============================== */
+static alarm_pool_t *g_ctrl_pool = NULL;
+
+/* ==============================
+ * Task Placement
+ * ============================== */
+TaskHandle_t smp_task_create_static(TaskFunction_t fn, const char *name,
+                                    StackType_t *stack, uint32_t stack_words,
+                                    StaticTask_t *tcb, void *arg,
+                                    UBaseType_t prio, uint32_t core)
+{
+    TaskHandle_t h;
+#if SMP_AFFINITY
+    h = xTaskCreateStaticAffinitySet(fn, name, stack_words, arg, prio, stack, tcb,
+                                     (UBaseType_t)(1u << core));
+#else
+    (void)core;
+    h = xTaskCreateStatic(fn, name, stack_words, arg, prio, stack, tcb);
+#endif
+    if (h == NULL)
+    {
+        printf("[SMP] create %s failed\n", name);
+    }
+    return h;
+}
+
+bool smp_pin_by_name(const char *name, uint32_t core)
+{
+#if SMP_AFFINITY
+    TaskHandle_t h = xTaskGetHandle(name);
+    if (h == NULL)
+    {
+        printf("[SMP] no task %s to pin\n", name);
+        return false;
+    }
+    vTaskCoreAffinitySet(h, (UBaseType_t)(1u << core));
+    return true;
+#else
+    (void)name;
+    (void)core;
+    return true;
+#endif
+}
+
+uint32_t smp_core_now(void)
+{
+    return get_core_num();
+}
+
+/* ==============================
+ * Alarm Pool
+ * ============================== */
+/* The pool's alarm IRQ is enabled on the calling core, so this must run on
+ * SMP_CORE_CTRL (the init task is pinned there). */
+void smp_alarm_pool_init(void)
+{
+#if SMP_AFFINITY
+    if (g_ctrl_pool == NULL)
+    {
+        g_ctrl_pool = alarm_pool_create_with_unused_hardware_alarm(SMP_ALARM_POOL_TIMERS);
+        printf("[SMP] alarm pool on core %u\n", (unsigned)alarm_pool_core_num(g_ctrl_pool));
+    }
+#endif
+}
+
+alarm_pool_t *smp_alarm_pool(void)
+{
+    return (g_ctrl_pool != NULL) ? g_ctrl_pool : alarm_pool_get_default();
+}
+
+/* ==============================
+ * SPSC Ring
+ * ============================== */
+bool smp_ring_push(smp_ring_t *r, const void *item)
+{
+    uint32_t head = r->head;
+    if ((head - r->tail) >= r->slots)
+    {
+        r->dropped++;
+        return false;
+    }
+    memcpy(&r->buf[(head & (r->slots - 1u)) * r->elem_size], item, r->elem_size);
+    __dmb();                    /* slot visible before the new head */
+    r->head = head + 1u;
+    return true;
+}
+
+bool smp_ring_pop(smp_ring_t *r, void *item)
+{
+    uint32_t tail = r->tail;
+    if (tail == r->head)
+    {
+        return false;
+    }
+    __dmb();                    /* head read before the slot contents */
+    memcpy(item, &r->buf[(tail & (r->slots - 1u)) * r->elem_size], r->elem_size);
+    __dmb();                    /* slot copied out before it is released */
+    r->tail = tail + 1u;
+    return true;
+}
+
+/*** end of file ***/
@@ -0,0 +1,85 @@
+//smp.h
+
+/*
+Core placement for the dual-core (SMP) build profile, plus a lock-free
+single-producer/single-consumer ring for passing data between cores.
+
+With ROBOT_SMP=1 (CMake option ROBOT_SMP) the RP2040 SMP kernel runs both
+cores: networking (cyw43 / lwIP, MQTT telemetry, map publish) is pinned to
+SMP_CORE_NET and control, sensing and decode to SMP_CORE_CTRL, so Wi-Fi
+bursts do not preempt the line-following loop. GPIO and DMA interrupts are
+serviced on the core that enabled them, so sensor init must run on
+SMP_CORE_CTRL and cyw43_arch_init() on SMP_CORE_NET. SDK alarms and repeating
+timers are different: they fire on the core that created their alarm pool,
+and the default pool belongs to core 0. Sensor timing callbacks that share
+state with the sensor ISRs therefore go through smp_alarm_pool(), which the
+init task creates on SMP_CORE_CTRL.
+
+Without ROBOT_SMP the helpers collapse to plain xTaskCreateStatic()/no-ops
+and the ring is still used to keep lwIP calls out of the control task.
+ */
+
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/time.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#ifndef ROBOT_SMP
+#define ROBOT_SMP 0
+#endif
+
+#define SMP_CORE_NET             0u
+#define SMP_CORE_CTRL            1u
+
+// True when the kernel really schedules per-core (affinity honoured)
+#if defined(configUSE_CORE_AFFINITY) && (configUSE_CORE_AFFINITY == 1) && (configNUM_CORES > 1)
+#define SMP_AFFINITY             1
+#else
+#define SMP_AFFINITY             0
+#endif
+
+// Create a task pinned to 'core' (unpinned on a single-core build) on
+// caller-owned storage; 'stack' must hold stack_words words. NULL on failure.
+TaskHandle_t smp_task_create_static(TaskFunction_t fn, const char *name,
+                                    StackType_t *stack, uint32_t stack_words,
+                                    StaticTask_t *tcb, void *arg,
+                                    UBaseType_t prio, uint32_t core);
+
+// Pin an already created task, looked up by name (e.g. module or SDK tasks).
+bool smp_pin_by_name(const char *name, uint32_t core);
+
+// Core the caller is running on.
+uint32_t smp_core_now(void);
+
+// Create the control-core alarm pool; call once from a task on SMP_CORE_CTRL
+// before any sensor timer is started. No-op without SMP_AFFINITY.
+#define SMP_ALARM_POOL_TIMERS    8u
+void smp_alarm_pool_init(void);
+
+// Pool for sensor alarms/timers: the control-core pool once created, else
+// the SDK default pool.
+alarm_pool_t *smp_alarm_pool(void);
+
+/* SPSC ring: exactly one producer and one consumer, possibly on different
+ * cores. Slots must be a power of two. Full => push fails (counted). */
+typedef struct {
+    volatile uint32_t head;      // Written by the producer only
+    volatile uint32_t tail;      // Written by the consumer only
+    uint32_t          dropped;   // Producer side
+    uint16_t          elem_size;
+    uint16_t          slots;
+    uint8_t          *buf;
+} smp_ring_t;
+
+#define SMP_RING_DEFINE(name, type, n_slots)                                   \
+    static uint8_t    name##_buf_[(n_slots) * sizeof(type)];                 \
+    static smp_ring_t name = { 0u, 0u, 0u, sizeof(type), (n_slots), name##_buf_ }
+
+bool smp_ring_push(smp_ring_t *r, const void *item);
+bool smp_ring_pop(smp_ring_t *r, void *item);
+
+#endif
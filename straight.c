@@ -0,0 +1,187 @@
+/** @file straight.c
+ *  @brief Yaw-hold straight moves closed on fused heading and encoder distance.
+ *
+ *  NOTE: Barr-C style. Steering reuses drive_to_yaw_setpoint() with a private
+ *        pid_config_t / pid_state_t, so the line-hold gains stay in one place.
+ *  WARNING: Distance is from the wheel encoders (~1 cm per tick); wheel slip
+ *           reads as progress.
+ */
+
+#include <math.h>
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "straight.h"
+#include "encoder.h"
+#include "IMU_movement.h"
+#include "attitude.h"
+#include "motor_encoder_demo.h"
+#include "trace.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define STRAIGHT_MIN_PCT         (25.0f)     /* static friction breakaway */
+#define STRAIGHT_MAX_CORR_PCT    (15.0f)
+#define STRAIGHT_INTEGRAL_MAX    (30.0f)
+#define STRAIGHT_TIMEOUT_BASE_MS (500u)
+#define STRAIGHT_MIN_CM_S        (10.0f)     /* slowest expected progress */
+
+/* ==============================
+ * Static State
+ * ============================== */
+typedef struct
+{
+    straight_status_t status;
+    float             dir;              /* +1 forward, -1 reverse */
+    float             target_cm;        /* magnitude */
+    float             speed_pct;
+    float             progress_cm;
+    bool              have_heading;
+    int32_t           l0;
+    int32_t           r0;
+    uint32_t          start_ms;
+    uint32_t          timeout_ms;
+    pid_config_t      pid;
+    pid_state_t       pid_st;
+} straight_ctx_t;
+
+static straight_ctx_t g_straight = { .status = STRAIGHT_IDLE };
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static bool yaw_deg_(float *yaw);
+
+/* ==============================
+ * Heading
+ * ============================== */
+static bool yaw_deg_(float *yaw)
+{
+    if (attitude_running())
+    {
+        *yaw = attitude_get_yaw_deg();
+        return true;
+    }
+    imu_data_t d;
+    if (!read_imu_data(&d))
+    {
+        return false;
+    }
+    *yaw = d.yaw;
+    return true;
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+void straight_start(float distance_cm, float heading_deg, float speed_pct)
+{
+    straight_ctx_t *s = &g_straight;
+    const pid_config_t *base = get_pid_config();
+
+    s->dir         = (distance_cm >= 0.0f) ? 1.0f : -1.0f;
+    s->target_cm   = fabsf(distance_cm);
+    s->speed_pct   = fmaxf(fabsf(speed_pct), STRAIGHT_MIN_PCT);
+    s->progress_cm = 0.0f;
+    s->l0          = encoder_get_odom_ticks(ENCODER_LEFT_GPIO);
+    s->r0          = encoder_get_odom_ticks(ENCODER_RIGHT_GPIO);
+    s->start_ms    = to_ms_since_boot(get_absolute_time());
+    s->timeout_ms  = STRAIGHT_TIMEOUT_BASE_MS +
+                     (uint32_t)((s->target_cm / STRAIGHT_MIN_CM_S) * 1000.0f);
+
+    float yaw = 0.0f;
+    s->have_heading      = yaw_deg_(&yaw);
+    s->pid               = *base;
+    s->pid.setpoint      = (heading_deg < 0.0f) ? yaw : heading_deg;
+    s->pid.max_output    = STRAIGHT_MAX_CORR_PCT;
+    s->pid.integral_max  = STRAIGHT_INTEGRAL_MAX;
+    s->pid_st.prev_error = 0.0f;
+    s->pid_st.integral   = 0.0f;
+    s->pid_st.enabled    = true;
+
+    s->status = (s->target_cm > STRAIGHT_TOL_CM) ? STRAIGHT_RUNNING : STRAIGHT_DONE;
+}
+
+straight_status_t straight_tick(void)
+{
+    straight_ctx_t *s = &g_straight;
+    if (s->status != STRAIGHT_RUNNING)
+    {
+        return s->status;
+    }
+
+    int32_t l = encoder_get_odom_ticks(ENCODER_LEFT_GPIO)  - s->l0;
+    int32_t r = encoder_get_odom_ticks(ENCODER_RIGHT_GPIO) - s->r0;
+    s->progress_cm = s->dir * (float)(l + r) * 0.5f * ENCODER_CM_PER_TICK;
+
+    float remaining = s->target_cm - s->progress_cm;
+    if (remaining <= STRAIGHT_TOL_CM)
+    {
+        all_stop();
+        s->status = STRAIGHT_DONE;
+        return s->status;
+    }
+    if ((to_ms_since_boot(get_absolute_time()) - s->start_ms) > s->timeout_ms)
+    {
+        all_stop();
+        s->status = STRAIGHT_TIMEOUT;
+        TRACE(TR_STRAIGHT_TO, TRACE_CENTI(s->progress_cm), TRACE_CENTI(s->target_cm), 0, 0);
+        return s->status;
+    }
+
+    /* Linear ramp-down over the last STRAIGHT_DECEL_CM */
+    float pct = s->speed_pct;
+    if (remaining < STRAIGHT_DECEL_CM)
+    {
+        pct = fmaxf(pct * (remaining / STRAIGHT_DECEL_CM), STRAIGHT_MIN_PCT);
+    }
+    s->pid.base_speed_left  = s->dir * pct * MOTOR_LEFT_TRIM;
+    s->pid.base_speed_right = s->dir * pct;
+
+    /* No heading: steer on zero error, i.e. plain trimmed drive */
+    float yaw = s->pid.setpoint;
+    if (s->have_heading)
+    {
+        (void)yaw_deg_(&yaw);
+    }
+
+    float out, ls, rs;
+    drive_to_yaw_setpoint(yaw, &s->pid, &s->pid_st, &out, &ls, &rs);  /* drives */
+    return s->status;
+}
+
+bool straight_by(float distance_cm, float heading_deg, float speed_pct)
+{
+    straight_start(distance_cm, heading_deg, speed_pct);
+    straight_status_t st;
+    while ((st = straight_tick()) == STRAIGHT_RUNNING)
+    {
+        vTaskDelay(pdMS_TO_TICKS(STRAIGHT_TICK_MS));
+    }
+    return (st == STRAIGHT_DONE);
+}
+
+void straight_abort(void)
+{
+    if (g_straight.status == STRAIGHT_RUNNING)
+    {
+        all_stop();
+        g_straight.status = STRAIGHT_IDLE;
+    }
+}
+
+float straight_get_progress_cm(void)
+{
+    return g_straight.progress_cm;
+}
+
+float straight_heading_now(void)
+{
+    float yaw;
+    return yaw_deg_(&yaw) ? yaw : -1.0f;
+}
+
+/*** end of file ***/
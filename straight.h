@@ -0,0 +1,58 @@
+//straight.h
+
+/*
+Yaw-hold straight-line moves: "drive D cm at heading H at speed V".
+
+Heading is held on the fused yaw (attitude filter, falling back to the
+raw IMU heading) with the progressive yaw PID from IMU_movement.c;
+distance comes from the signed encoder odometry ticks, so the same call
+drives forwards (D > 0) or backwards (D < 0). Speed ramps down over the
+last few centimetres so the move stops on the distance instead of
+coasting past it.
+
+Headings use the compass convention of the IMU (degrees, clockwise).
+ */
+
+#ifndef STRAIGHT_H
+#define STRAIGHT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Pass as heading to hold whatever heading the robot has at the start
+#define STRAIGHT_HOLD_HEADING   (-1.0f)
+
+// Stop criterion / ramp
+#define STRAIGHT_TOL_CM          0.5f
+#define STRAIGHT_DECEL_CM        8.0f
+
+// Control period of straight_by()
+#define STRAIGHT_TICK_MS        10u
+
+typedef enum {
+    STRAIGHT_IDLE = 0,
+    STRAIGHT_RUNNING,
+    STRAIGHT_DONE,
+    STRAIGHT_TIMEOUT
+} straight_status_t;
+
+// Begin a move of distance_cm (negative = reverse) holding heading_deg
+// (or STRAIGHT_HOLD_HEADING) at speed_pct motor duty.
+void straight_start(float distance_cm, float heading_deg, float speed_pct);
+
+// One control step; call every STRAIGHT_TICK_MS while STRAIGHT_RUNNING.
+straight_status_t straight_tick(void);
+
+// Blocking move built on straight_start()/straight_tick(). False on timeout.
+bool straight_by(float distance_cm, float heading_deg, float speed_pct);
+
+// Stop the motors and cancel a running move.
+void straight_abort(void);
+
+// Distance covered along the commanded direction since straight_start() (cm).
+float straight_get_progress_cm(void);
+
+// Current fused heading (deg, clockwise), or -1 when no IMU heading.
+float straight_heading_now(void);
+
+#endif
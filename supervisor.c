@@ -0,0 +1,210 @@
+/** @file supervisor.c
+ *  @brief Task heartbeats, hardware watchdog feed and the scratch fault record.
+ *
+ *  NOTE: Barr-C style. Heartbeats are single 32-bit stores, read by the
+ *        supervisor without a lock. Scratch 0..3 are ours; the SDK keeps
+ *        4..7 for watchdog_reboot() and the enable magic.
+ *  WARNING: The watchdog is paused under a debugger (pause_on_debug), so a
+ *           breakpoint does not reset the board; a stuck task still stops
+ *           the motors.
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/watchdog.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "supervisor.h"
+#include "motor_encoder_demo.h"
+#include "mqtt_client.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define SUP_MAGIC           (0x5AFE0000u)
+#define SUP_MAGIC_MASK      (0xFFFF0000u)
+#define SUP_STACK_WORDS     (512u)
+#define SUP_JSON_MAX        (160u)
+
+/* ==============================
+ * Static State
+ * ============================== */
+typedef struct
+{
+    const char *name;
+    uint32_t    deadline_ms;
+} sup_client_def_t;
+
+/* Deadlines are a few periods of each loop, plus its longest legitimate
+ * block (publish under cyw43_arch_lwip_begin, a ping timeout). */
+static const sup_client_def_t g_clients[SUP_CLIENT_COUNT] =
+{
+    [SUP_CONTROL]   = { "robot_ctl", 200u  },
+    [SUP_MOTION]    = { "motion",    300u  },
+    [SUP_RANGING]   = { "ranging",   300u  },
+    [SUP_ATTITUDE]  = { "attitude",  200u  },
+    [SUP_COLLISION] = { "collision", 300u  },
+    [SUP_OCCGRID]   = { "occ_map",   1000u },
+    [SUP_TELEMETRY] = { "telemetry", 3000u },
+};
+
+static const char *const g_fault_names[] =
+{
+    "none", "deadline", "stack", "wdt"
+};
+
+typedef struct
+{
+    sup_fault_t  reason;
+    sup_client_t client;
+    uint32_t     up_ms;
+    uint32_t     late_ms;
+    uint32_t     resets;
+} sup_record_t;
+
+static volatile uint32_t g_beat_ms[SUP_CLIENT_COUNT];
+static volatile bool     g_armed[SUP_CLIENT_COUNT];
+static volatile bool     g_faulted  = false;
+static sup_record_t      g_last     = { SUP_FAULT_NONE, SUP_CLIENT_COUNT, 0u, 0u, 0u };
+static StackType_t       g_stack[SUP_STACK_WORDS];
+static StaticTask_t      g_tcb;
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static void     supervisor_task_(void *pv);
+static uint32_t now_ms_(void);
+static void     fault_(sup_fault_t reason, sup_client_t client, uint32_t late_ms);
+
+/* ==============================
+ * Helpers
+ * ============================== */
+static uint32_t now_ms_(void)
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+/* Motors first: the record and the reset can wait, the table edge cannot */
+static void fault_(sup_fault_t reason, sup_client_t client, uint32_t late_ms)
+{
+    all_stop();
+    if (!g_faulted)
+    {
+        watchdog_hw->scratch[0] = SUP_MAGIC | ((uint32_t)reason << 8) | (uint32_t)client;
+        watchdog_hw->scratch[1] = now_ms_();
+        watchdog_hw->scratch[2] = late_ms;
+        g_faulted = true;
+    }
+}
+
+/* ==============================
+ * Task
+ * ============================== */
+static void supervisor_task_(void *pv)
+{
+    (void)pv;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    watchdog_enable(SUP_WDT_MS, true);
+    while (1)
+    {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SUP_PERIOD_MS));
+        if (g_faulted)
+        {
+            all_stop();             /* until the watchdog bites */
+            continue;
+        }
+
+        uint32_t now = now_ms_();
+        for (uint8_t i = 0; i < SUP_CLIENT_COUNT; i++)
+        {
+            uint32_t age = now - g_beat_ms[i];
+            if (g_armed[i] && (age > g_clients[i].deadline_ms))
+            {
+                printf("[SUP] %s silent for %lu ms\n", g_clients[i].name,
+                       (unsigned long)age);
+                fault_(SUP_FAULT_DEADLINE, (sup_client_t)i, age - g_clients[i].deadline_ms);
+                break;
+            }
+        }
+        if (!g_faulted)
+        {
+            watchdog_update();
+        }
+    }
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+void supervisor_init(void)
+{
+    uint32_t rec = watchdog_hw->scratch[0];
+    if (watchdog_enable_caused_reboot())
+    {
+        g_last.resets = watchdog_hw->scratch[3] + 1u;
+        if ((rec & SUP_MAGIC_MASK) == SUP_MAGIC)
+        {
+            g_last.reason  = (sup_fault_t)((rec >> 8) & 0xFFu);
+            g_last.client  = (sup_client_t)(rec & 0xFFu);
+            g_last.up_ms   = watchdog_hw->scratch[1];
+            g_last.late_ms = watchdog_hw->scratch[2];
+        }
+        else
+        {
+            g_last.reason = SUP_FAULT_WDT;
+        }
+    }
+    watchdog_hw->scratch[0] = 0u;
+    watchdog_hw->scratch[1] = 0u;
+    watchdog_hw->scratch[2] = 0u;
+    watchdog_hw->scratch[3] = g_last.resets;
+}
+
+bool supervisor_start(uint32_t priority)
+{
+    if (xTaskCreateStatic(supervisor_task_, "supervisor", SUP_STACK_WORDS, NULL, priority,
+                          g_stack, &g_tcb) == NULL)
+    {
+        printf("[SUP] task create failed\n");
+        return false;
+    }
+    printf("[SUP] watchdog %u ms, %u clients\n", SUP_WDT_MS, (unsigned)SUP_CLIENT_COUNT);
+    return true;
+}
+
+void supervisor_beat(sup_client_t client)
+{
+    if (client < SUP_CLIENT_COUNT)
+    {
+        g_beat_ms[client] = now_ms_();
+        g_armed[client]   = true;
+    }
+}
+
+void supervisor_fault(sup_fault_t reason, sup_client_t client)
+{
+    fault_(reason, client, 0u);
+}
+
+void supervisor_report(void)
+{
+    const char *task = (g_last.client < SUP_CLIENT_COUNT) ? g_clients[g_last.client].name : "";
+    const char *why  = (g_last.reason <= SUP_FAULT_WDT) ? g_fault_names[g_last.reason] : "?";
+    char        json[SUP_JSON_MAX];
+
+    int n = snprintf(json, sizeof(json),
+                     "{\"reason\":\"%s\",\"task\":\"%s\",\"up_ms\":%lu,\"late_ms\":%lu,"
+                     "\"resets\":%lu}",
+                     why, task, (unsigned long)g_last.up_ms,
+                     (unsigned long)g_last.late_ms, (unsigned long)g_last.resets);
+    printf("[SUP] last boot: %s\n", json);
+    if ((n > 0) && ((size_t)n < sizeof(json)) && mqtt_is_connected())
+    {
+        (void)mqtt_publish_raw("fault", json, (uint16_t)n, 1, true);
+    }
+}
+
+/*** end of file ***/
@@ -0,0 +1,63 @@
+//supervisor.h
+
+/*
+Task heartbeats, hardware watchdog and fault record.
+
+Each monitored task calls supervisor_beat() once per loop. A client is only
+watched after its first beat, so tasks may start in any order. The
+supervisor task feeds the RP2040 watchdog while every watched client has
+beaten within its deadline. On a miss (or on a stack overflow) it stops the
+motors, writes a fault record to watchdog scratch registers 0..3 and stops
+feeding; the chip resets SUP_WDT_MS later. A wedged supervisor or
+scheduler ends the same way, without the record.
+
+On the next boot the record (or a bare watchdog reset) is printed and
+published retained to BASE_TOPIC/fault:
+  {"reason":"deadline|stack|wdt|none","task":"name","up_ms":n,
+   "late_ms":n,"resets":n}
+ */
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SUP_PERIOD_MS            50u
+#define SUP_WDT_MS               500u      // hardware watchdog timeout
+
+typedef enum {
+    SUP_CONTROL = 0,
+    SUP_MOTION,
+    SUP_RANGING,
+    SUP_ATTITUDE,
+    SUP_COLLISION,
+    SUP_OCCGRID,
+    SUP_TELEMETRY,
+    SUP_CLIENT_COUNT
+} sup_client_t;
+
+typedef enum {
+    SUP_FAULT_NONE = 0,
+    SUP_FAULT_DEADLINE,          // a client missed its heartbeat deadline
+    SUP_FAULT_STACK,             // stack overflow hook
+    SUP_FAULT_WDT                // watchdog reset without a record
+} sup_fault_t;
+
+// Read and clear last boot's fault record; call first thing in init.
+void supervisor_init(void);
+
+// Create the supervisor task and arm the hardware watchdog.
+bool supervisor_start(uint32_t priority);
+
+// Heartbeat from a monitored task's loop.
+void supervisor_beat(sup_client_t client);
+
+// Stop the motors, store the record (first fault wins) and stop feeding
+// the watchdog. 'client' is SUP_CLIENT_COUNT when not a heartbeat fault.
+void supervisor_fault(sup_fault_t reason, sup_client_t client);
+
+// Print last boot's fault; publish it retained when MQTT is connected.
+void supervisor_report(void);
+
+#endif
@@ -0,0 +1,201 @@
+/** @file fxmath_host.c
+ *  @brief Host accuracy sweep and benchmark for the fixed-point kernels (fxmath.c).
+ *
+ *  NOTE: Barr-C style. "fxmath_host" sweeps every kernel against double-
+ *        precision libm and fails if a bound documented in fxmath.h is
+ *        exceeded (run by ctest). "fxmath_host bench [N]" times the kernels
+ *        against atan2f/sinf/cosf/sqrtf, the host twin of fx_bench().
+ *  WARNING: Host timings only rank the kernels against each other; the
+ *           RP2040 has no FPU, so use fx_bench() on the target for real cost.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "fxmath.h"
+
+/* ==============================
+ * Documented Bounds (fxmath.h)
+ * ============================== */
+#define ATAN2_MAX_ERR_DEG   (0.005)
+#define SINCOS_MAX_ERR_LSB  (2.0)
+#define RSQRT_MAX_REL_ERR   (5e-5)
+#define RSQRT_LSB           (1.0)
+
+#define SWEEP_ATAN2_N       (2000000u)
+#define SWEEP_SINCOS_STEP   (37)
+#define SWEEP_SQRT_STEP     (12345u)
+#define BENCH_DEFAULT_N     (1000000u)
+
+/* ==============================
+ * Deterministic Inputs
+ * ============================== */
+static uint32_t g_lcg = 12345u;
+
+static uint32_t rand_u32_(void)
+{
+    g_lcg = (g_lcg * 1664525u) + 1013904223u;
+    return g_lcg;
+}
+
+/* Mixes small, mid-range and full-scale magnitudes */
+static int32_t rand_arg_(uint32_t i)
+{
+    int32_t v = (int32_t)rand_u32_();
+    switch (i % 3u)
+    {
+        case 0u:  return v >> 20;
+        case 1u:  return v >> 11;
+        default:  return v;
+    }
+}
+
+/* ==============================
+ * Sweeps
+ * ============================== */
+static int sweep_atan2_(void)
+{
+    double worst = 0.0;
+    for (uint32_t i = 0; i < SWEEP_ATAN2_N; i++)
+    {
+        int32_t y = rand_arg_(i);
+        int32_t x = rand_arg_(i + 1u);
+        if ((x == 0) && (y == 0))
+        {
+            continue;
+        }
+        double ref = atan2((double)y, (double)x) * (180.0 / M_PI);
+        double err = fabs(ref - ((double)fx_atan2_deg(y, x) / FX_DEG_ONE));
+        if (err > 180.0)
+        {
+            err = fabs(err - 360.0);    /* +180 vs -180 */
+        }
+        worst = fmax(worst, err);
+    }
+    int ok = (worst <= ATAN2_MAX_ERR_DEG);
+    printf("fx_atan2_deg   max |err| %.6f deg   (bound %.3f)  %s\n",
+           worst, ATAN2_MAX_ERR_DEG, ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static int sweep_sincos_(void)
+{
+    double worst = 0.0;
+    for (int64_t a = -(720LL * FX_DEG_ONE); a < (720LL * FX_DEG_ONE); a += SWEEP_SINCOS_STEP)
+    {
+        int16_t s, c;
+        fx_sincos((fx_deg_t)a, &s, &c);
+        double r = ((double)a / FX_DEG_ONE) * (M_PI / 180.0);
+        worst = fmax(worst, fabs((double)s - (sin(r) * 32768.0)));
+        worst = fmax(worst, fabs((double)c - (cos(r) * 32768.0)));
+    }
+    int ok = (worst <= SINCOS_MAX_ERR_LSB);
+    printf("fx_sincos      max |err| %.3f LSB     (bound %.0f)    %s\n",
+           worst, SINCOS_MAX_ERR_LSB, ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static int sweep_rsqrt_(void)
+{
+    double worst = 0.0;
+    int    ok    = 1;
+    for (uint64_t x = 1u; x <= 0xFFFFFFFFull; x = (uint64_t)((double)x * 1.0001) + 1u)
+    {
+        double ref = 65536.0 / sqrt((double)x / 65536.0);
+        double got = (double)fx_rsqrt_q16((uint32_t)x);
+        double err = fabs(got - ref);
+        if (err > ((RSQRT_MAX_REL_ERR * ref) + RSQRT_LSB))
+        {
+            ok = 0;
+        }
+        worst = fmax(worst, (err - RSQRT_LSB) / ref);   /* beyond output rounding */
+    }
+    printf("fx_rsqrt_q16   max rel err %.2e     (bound %.0e + 1 LSB)  %s\n",
+           worst, RSQRT_MAX_REL_ERR, ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static int sweep_sqrt_(void)
+{
+    int ok = 1;
+    for (uint64_t x = 0u; x <= 0xFFFFFFFFull; x += SWEEP_SQRT_STEP)
+    {
+        uint64_t r = fx_sqrt_u32((uint32_t)x);
+        if (((r * r) > x) || (((r + 1u) * (r + 1u)) <= x))
+        {
+            printf("fx_sqrt_u32(%llu) = %llu\n", (unsigned long long)x, (unsigned long long)r);
+            ok = 0;
+            break;
+        }
+    }
+    if (fx_sqrt_u32(0xFFFFFFFFu) != 65535u)
+    {
+        ok = 0;
+    }
+    printf("fx_sqrt_u32    exact floor                            %s\n", ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+/* ==============================
+ * Benchmark
+ * ============================== */
+static double now_ns_(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double)ts.tv_sec * 1e9) + (double)ts.tv_nsec;
+}
+
+/* Same mix per iteration as fx_bench() on the target */
+static void bench_(uint32_t iterations)
+{
+    volatile int32_t sink_i = 0;
+    volatile float   sink_f = 0.0f;
+    int16_t s, c;
+
+    double t0 = now_ns_();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        sink_i += fx_atan2_deg((int32_t)i - 500, 700);
+        fx_sincos((fx_deg_t)(i * 4099u), &s, &c);
+        sink_i += s + c + (int32_t)fx_sqrt_u32(i * 977u);
+    }
+    double t1 = now_ns_();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        float a = (float)(i * 4099u) * (1.0f / 65536.0f) * ((float)M_PI / 180.0f);
+        sink_f += atan2f((float)i - 500.0f, 700.0f);
+        sink_f += sinf(a) + cosf(a) + sqrtf((float)(i * 977u));
+    }
+    double t2 = now_ns_();
+
+    (void)sink_i;
+    (void)sink_f;
+    printf("%lu iters: fixed %.1f ns/iter, libm %.1f ns/iter\n",
+           (unsigned long)iterations, (t1 - t0) / iterations, (t2 - t1) / iterations);
+}
+
+/* ==============================
+ * Entry
+ * ============================== */
+int main(int argc, char **argv)
+{
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0))
+    {
+        uint32_t n = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : BENCH_DEFAULT_N;
+        bench_((n == 0u) ? BENCH_DEFAULT_N : n);
+        return 0;
+    }
+
+    int fails = 0;
+    fails += sweep_atan2_();
+    fails += sweep_sincos_();
+    fails += sweep_rsqrt_();
+    fails += sweep_sqrt_();
+    return (fails == 0) ? 0 : 1;
+}
+
+/*** end of file ***/
@@ -0,0 +1,386 @@
+/** @file test_hsm.c
+ *  @brief Host unit tests for the table-driven state machine (hsm.c).
+ *
+ *  NOTE: Barr-C style. Plain C, no framework: each test returns the number
+ *        of failed checks and main() sums them for ctest.
+ *  WARNING: The action log is shared by every test; call log_reset_() first.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hsm.h"
+
+/* ==============================
+ * Check Helper
+ * ============================== */
+#define CHECK(cond)                                                         \
+    do                                                                      \
+    {                                                                       \
+        if (!(cond))                                                        \
+        {                                                                   \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            fails++;                                                        \
+        }                                                                   \
+    } while (0)
+
+/* ==============================
+ * Test Machine
+ * ============================== */
+/*
+ *  ROOT
+ *   +-- FOLLOW (initial LINE)
+ *   |     +-- LINE
+ *   |     +-- WAIT
+ *   +-- AVOID (timeout 100 ms -> WAIT)
+ *   +-- SCAN (initial SEEK)
+ *         +-- SEEK (initial EDGE)
+ *               +-- EDGE
+ */
+enum
+{
+    TS_ROOT = 0,
+    TS_FOLLOW,
+    TS_LINE,
+    TS_WAIT,
+    TS_AVOID,
+    TS_SCAN,
+    TS_SEEK,
+    TS_EDGE,
+    TS_COUNT
+};
+
+enum
+{
+    TE_OBS = 0,
+    TE_FRAME,
+    TE_DONE,
+    TE_POKE,
+    TE_COUNT
+};
+
+#define LOG_MAX    (128u)
+
+static uint32_t g_now_ms;
+static char     g_log[LOG_MAX];
+static size_t   g_log_len;
+static bool     g_allow_done;
+static uint32_t g_pokes;
+
+static uint32_t now_ms_(void)
+{
+    return g_now_ms;
+}
+
+static void log_reset_(void)
+{
+    g_log_len = 0;
+    g_log[0]  = '\0';
+}
+
+static void log_(const char *tag)
+{
+    size_t n = strlen(tag);
+    if ((g_log_len + n + 2u) < LOG_MAX)
+    {
+        if (g_log_len > 0u)
+        {
+            g_log[g_log_len++] = ' ';
+        }
+        memcpy(&g_log[g_log_len], tag, n + 1u);
+        g_log_len += n;
+    }
+}
+
+#define LOG_ACTION(fn, tag) static void fn(hsm_t *m) { (void)m; log_(tag); }
+
+LOG_ACTION(follow_in_,  "+F")
+LOG_ACTION(follow_out_, "-F")
+LOG_ACTION(line_in_,    "+L")
+LOG_ACTION(line_out_,   "-L")
+LOG_ACTION(wait_in_,    "+W")
+LOG_ACTION(wait_out_,   "-W")
+LOG_ACTION(avoid_in_,   "+A")
+LOG_ACTION(avoid_out_,  "-A")
+LOG_ACTION(avoid_tick_, "tA")
+LOG_ACTION(scan_in_,    "+S")
+LOG_ACTION(scan_out_,   "-S")
+LOG_ACTION(seek_in_,    "+K")
+LOG_ACTION(edge_in_,    "+E")
+LOG_ACTION(edge_out_,   "-E")
+LOG_ACTION(frame_act_,  "act")
+
+static void poke_(hsm_t *m)
+{
+    (void)m;
+    g_pokes++;
+}
+
+static bool done_allowed_(const hsm_t *m)
+{
+    (void)m;
+    return g_allow_done;
+}
+
+static const hsm_state_def_t g_states[TS_COUNT] =
+{
+    /*               name      parent     initial       entry       exit        tick         timeout on_timeout */
+    [TS_ROOT]   = { "ROOT",   TS_ROOT,   HSM_NO_CHILD, NULL,       NULL,       NULL,        0u,   TS_ROOT },
+    [TS_FOLLOW] = { "FOLLOW", TS_ROOT,   TS_LINE,      follow_in_, follow_out_, NULL,       0u,   TS_ROOT },
+    [TS_LINE]   = { "LINE",   TS_FOLLOW, HSM_NO_CHILD, line_in_,   line_out_,  NULL,        0u,   TS_ROOT },
+    [TS_WAIT]   = { "WAIT",   TS_FOLLOW, HSM_NO_CHILD, wait_in_,   wait_out_,  NULL,        0u,   TS_ROOT },
+    [TS_AVOID]  = { "AVOID",  TS_ROOT,   HSM_NO_CHILD, avoid_in_,  avoid_out_, avoid_tick_, 100u, TS_WAIT },
+    [TS_SCAN]   = { "SCAN",   TS_ROOT,   TS_SEEK,      scan_in_,   scan_out_,  NULL,        0u,   TS_ROOT },
+    [TS_SEEK]   = { "SEEK",   TS_SCAN,   TS_EDGE,      seek_in_,   NULL,       NULL,        0u,   TS_ROOT },
+    [TS_EDGE]   = { "EDGE",   TS_SEEK,   HSM_NO_CHILD, edge_in_,   edge_out_,  NULL,        0u,   TS_ROOT },
+};
+
+static const hsm_trans_t g_table[TS_COUNT][TE_COUNT] =
+{
+    [TS_ROOT]   = { [TE_DONE]  = { TS_FOLLOW,    NULL,          NULL       },
+                    [TE_POKE]  = { HSM_INTERNAL, NULL,          poke_      } },
+    [TS_FOLLOW] = { [TE_FRAME] = { TS_SCAN,      NULL,          frame_act_ } },
+    [TS_LINE]   = { [TE_OBS]   = { TS_AVOID,     NULL,          NULL       },
+                    [TE_FRAME] = { TS_WAIT,      NULL,          NULL       } },
+    [TS_WAIT]   = { [TE_DONE]  = { TS_LINE,      done_allowed_, NULL       } },
+    [TS_EDGE]   = { [TE_OBS]   = { TS_EDGE,      NULL,          NULL       } },
+};
+
+static const hsm_def_t g_def =
+{
+    .states   = g_states,
+    .table    = &g_table[0][0],
+    .n_states = TS_COUNT,
+    .n_events = TE_COUNT,
+    .now_ms   = now_ms_,
+};
+
+static void start_(hsm_t *m, hsm_state_id_t initial)
+{
+    g_now_ms     = 1000u;
+    g_allow_done = false;
+    g_pokes      = 0;
+    log_reset_();
+    hsm_init(m, &g_def, initial, NULL);
+}
+
+/* ==============================
+ * Tests
+ * ============================== */
+static int test_init_descends_(void)
+{
+    int   fails = 0;
+    hsm_t m;
+    hsm_trace_t t;
+
+    start_(&m, TS_FOLLOW);
+    CHECK(hsm_current(&m) == TS_LINE);
+    CHECK(strcmp(g_log, "+F +L") == 0);
+    CHECK(hsm_in_state(&m, TS_FOLLOW));
+    CHECK(hsm_trace_get(&m, 0u, &t));
+    CHECK((t.from == TS_ROOT) && (t.to == TS_LINE) && (t.event == HSM_EVT_INIT));
+
+    /* Two levels of initial children below the target */
+    start_(&m, TS_SCAN);
+    CHECK(hsm_current(&m) == TS_EDGE);
+    CHECK(strcmp(g_log, "+S +K +E") == 0);
+    return fails;
+}
+
+static int test_parent_fallback_(void)
+{
+    int   fails = 0;
+    hsm_t m;
+
+    /* WAIT has no TE_FRAME entry, FOLLOW does */
+    start_(&m, TS_WAIT);
+    log_reset_();
+    CHECK(hsm_dispatch(&m, TE_FRAME));
+    CHECK(hsm_current(&m) == TS_EDGE);
+    CHECK(strcmp(g_log, "-W -F act +S +K +E") == 0);
+
+    /* Handled by the root two levels up */
+    log_reset_();
+    CHECK(hsm_dispatch(&m, TE_DONE));
+    CHECK(hsm_current(&m) == TS_LINE);
+    CHECK(strcmp(g_log, "-E -S +F +L") == 0);
+
+    /* Nobody handles TE_OBS in AVOID: no change, no actions */
+    CHECK(hsm_dispatch(&m, TE_OBS));
+    log_reset_();
+    CHECK(!hsm_dispatch(&m, TE_OBS));
+    CHECK(hsm_current(&m) == TS_AVOID);
+    CHECK(g_log_len == 0u);
+
+    /* Out-of-range event is rejected */
+    CHECK(!hsm_dispatch(&m, TE_COUNT));
+    return fails;
+}
+
+static int test_guard_and_internal_(void)
+{
+    int   fails = 0;
+    hsm_t m;
+
+    /* False guard in WAIT falls through to the root's TE_DONE */
+    start_(&m, TS_WAIT);
+    log_reset_();
+    CHECK(hsm_dispatch(&m, TE_DONE));
+    CHECK(hsm_current(&m) == TS_LINE);
+    CHECK(strcmp(g_log, "-W -F +F +L") == 0);
+
+    start_(&m, TS_WAIT);
+    g_allow_done = true;
+    log_reset_();
+    CHECK(hsm_dispatch(&m, TE_DONE));
+    CHECK(hsm_current(&m) == TS_LINE);
+    CHECK(strcmp(g_log, "-W +L") == 0);
+
+    /* Internal: action runs, no exit/entry, no trace entry */
+    uint32_t count = m.trace_count;
+    log_reset_();
+    CHECK(hsm_dispatch(&m, TE_POKE));
+    CHECK(g_pokes == 1u);
+    CHECK(hsm_current(&m) == TS_LINE);
+    CHECK(g_log_len == 0u);
+    CHECK(m.trace_count == count);
+    return fails;
+}
+
+static int test_lca_order_(void)
+{
+    int   fails = 0;
+    hsm_t m;
+
+    /* Siblings: the shared parent FOLLOW is neither exited nor entered */
+    start_(&m, TS_LINE);
+    log_reset_();
+    CHECK(hsm_dispatch(&m, TE_FRAME));
+    CHECK(hsm_current(&m) == TS_WAIT);
+    CHECK(strcmp(g_log, "-L +W") == 0);
+
+    /* Across subtrees: exits bottom-up to the root, entries top-down */
+    start_(&m, TS_EDGE);
+    log_reset_();
+    CHECK(hsm_dispatch(&m, TE_DONE));
+    CHECK(strcmp(g_log, "-E -S +F +L") == 0);
+
+    /* Self-transition is external: exit and re-enter */
+    start_(&m, TS_EDGE);
+    log_reset_();
+    CHECK(hsm_dispatch(&m, TE_OBS));
+    CHECK(hsm_current(&m) == TS_EDGE);
+    CHECK(strcmp(g_log, "-E +E") == 0);
+    return fails;
+}
+
+static int test_timeout_(void)
+{
+    int   fails = 0;
+    hsm_t m;
+    hsm_trace_t t;
+
+    start_(&m, TS_LINE);
+    CHECK(hsm_dispatch(&m, TE_OBS));
+    CHECK(hsm_current(&m) == TS_AVOID);
+
+    /* Before the deadline only the tick action runs */
+    log_reset_();
+    g_now_ms += 99u;
+    hsm_tick(&m);
+    CHECK(hsm_current(&m) == TS_AVOID);
+    CHECK(hsm_time_in_state_ms(&m) == 99u);
+    CHECK(strcmp(g_log, "tA") == 0);
+
+    /* At the deadline the timeout wins and the tick is skipped */
+    log_reset_();
+    g_now_ms += 1u;
+    hsm_tick(&m);
+    CHECK(hsm_current(&m) == TS_WAIT);
+    CHECK(strcmp(g_log, "-A +F +W") == 0);
+    CHECK(hsm_time_in_state_ms(&m) == 0u);
+    CHECK(hsm_trace_get(&m, 0u, &t));
+    CHECK((t.from == TS_AVOID) && (t.to == TS_WAIT) && (t.event == HSM_EVT_TIMEOUT));
+    CHECK(t.t_ms == g_now_ms);
+
+    /* WAIT has no timeout */
+    g_now_ms += 100000u;
+    hsm_tick(&m);
+    CHECK(hsm_current(&m) == TS_WAIT);
+    return fails;
+}
+
+static int test_trace_wrap_(void)
+{
+    int   fails = 0;
+    hsm_t m;
+    hsm_trace_t t;
+
+    /* init + 2 * (LINE -> WAIT -> LINE) per loop */
+    start_(&m, TS_LINE);
+    g_allow_done = true;
+    uint32_t loops = HSM_TRACE_LEN;
+    for (uint32_t i = 0; i < loops; i++)
+    {
+        g_now_ms++;
+        (void)hsm_dispatch(&m, TE_FRAME);
+        g_now_ms++;
+        (void)hsm_dispatch(&m, TE_DONE);
+    }
+    CHECK(m.trace_count == (1u + (2u * loops)));
+
+    /* Newest first, oldest retained is HSM_TRACE_LEN - 1 back */
+    CHECK(hsm_trace_get(&m, 0u, &t));
+    CHECK((t.from == TS_WAIT) && (t.to == TS_LINE) && (t.event == TE_DONE));
+    CHECK(t.t_ms == g_now_ms);
+    CHECK(hsm_trace_get(&m, 1u, &t));
+    CHECK((t.from == TS_LINE) && (t.to == TS_WAIT) && (t.event == TE_FRAME));
+    CHECK(hsm_trace_get(&m, HSM_TRACE_LEN - 1u, &t));
+    CHECK(t.t_ms == (g_now_ms - (HSM_TRACE_LEN - 1u)));
+    CHECK(!hsm_trace_get(&m, HSM_TRACE_LEN, &t));
+
+    /* The init record has been overwritten */
+    for (uint32_t age = 0; age < HSM_TRACE_LEN; age++)
+    {
+        CHECK(hsm_trace_get(&m, age, &t) && (t.event != HSM_EVT_INIT));
+    }
+
+    /* Before wrapping, only what was recorded is readable */
+    start_(&m, TS_LINE);
+    CHECK(hsm_trace_get(&m, 0u, &t));
+    CHECK(!hsm_trace_get(&m, 1u, &t));
+    return fails;
+}
+
+/* ==============================
+ * Runner
+ * ============================== */
+typedef struct
+{
+    const char *name;
+    int       (*fn)(void);
+} test_case_t;
+
+int main(void)
+{
+    static const test_case_t cases[] =
+    {
+        { "init_descends",     test_init_descends_     },
+        { "parent_fallback",   test_parent_fallback_   },
+        { "guard_and_internal", test_guard_and_internal_ },
+        { "lca_order",         test_lca_order_         },
+        { "timeout",           test_timeout_           },
+        { "trace_wrap",        test_trace_wrap_        },
+    };
+    int total = 0;
+
+    for (size_t i = 0; i < (sizeof(cases) / sizeof(cases[0])); i++)
+    {
+        int f = cases[i].fn();
+        printf("%-20s %s\n", cases[i].name, (f == 0) ? "ok" : "FAILED");
+        total += f;
+    }
+    return (total == 0) ? 0 : 1;
+}
+
+/*** end of file ***/
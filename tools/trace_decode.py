@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Decode binary trace batches from the robot (see trace.h).
+
+Input is text, one batch per line, as hex:
+  - stdio captures: lines containing "[TR] <hex>" (other lines are skipped)
+  - MQTT: mosquitto_sub -t robot/alpha/trace -F %x
+
+Record names and argument formats come from trace_ids.h, so the decoder
+follows the firmware without edits. Output is one line per record, merged
+across cores in time order:
+
+  t_ms      core  name         formatted args
+
+Usage: trace_decode.py [-i path/to/trace_ids.h] [capture ...]   (stdin if none)
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+HDR = struct.Struct("<2sBBHH")          # 'TR', version, core, count, dropped
+REC = struct.Struct("<IHH4i")           # t_us, id, seq, arg[4]
+VERSION = 1
+
+DEF_RE = re.compile(r'^\s*TRACE_DEF\(\s*(\w+)\s*,\s*"([^"]*)"\s*,\s*"([^"]*)"\s*\)')
+CONV_RE = re.compile(r"%([ducx%])")
+HEX_RE = re.compile(r"(?:\[TR\]\s*)?([0-9a-fA-F]{16,})\s*$")
+
+
+def load_ids(path):
+    """TRACE_DEF order in trace_ids.h is the numeric ID."""
+    ids = []
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            m = DEF_RE.match(line)
+            if m:
+                ids.append((m.group(2), m.group(3)))
+    if not ids:
+        sys.exit(f"no TRACE_DEF entries in {path}")
+    return ids
+
+
+def render(fmt, args):
+    it = iter(args)
+
+    def conv(m):
+        c = m.group(1)
+        if c == "%":
+            return "%"
+        v = next(it, 0)
+        if c == "u":
+            return str(v & 0xFFFFFFFF)
+        if c == "x":
+            return f"0x{v & 0xFFFFFFFF:x}"
+        if c == "c":
+            return f"{v / 100.0:.2f}"
+        return str(v)
+
+    return CONV_RE.sub(conv, fmt)
+
+
+def batches(lines):
+    for n, line in enumerate(lines, 1):
+        m = HEX_RE.search(line.strip())
+        if not m or len(m.group(1)) % 2:
+            continue
+        data = bytes.fromhex(m.group(1))
+        if len(data) < HDR.size:
+            continue
+        magic, ver, core, count, dropped = HDR.unpack_from(data)
+        if magic != b"TR":
+            continue
+        if ver != VERSION:
+            print(f"line {n}: trace version {ver}, expected {VERSION}", file=sys.stderr)
+            continue
+        if len(data) < HDR.size + count * REC.size:
+            print(f"line {n}: truncated batch", file=sys.stderr)
+            continue
+        recs = [REC.unpack_from(data, HDR.size + i * REC.size) for i in range(count)]
+        yield core, dropped, recs
+
+
+class CoreClock:
+    """Unwraps the 32-bit microsecond timestamp (wraps every ~71.6 min)."""
+
+    def __init__(self):
+        self.last = None
+        self.base = 0
+
+    def unwrap(self, t_us):
+        if self.last is not None and t_us < self.last and (self.last - t_us) > 0x80000000:
+            self.base += 1 << 32
+        self.last = t_us
+        return self.base + t_us
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("-i", "--ids", default=os.path.join(here, "..", "trace_ids.h"),
+                    help="trace_ids.h to take names and formats from")
+    ap.add_argument("captures", nargs="*", help="capture files (default: stdin)")
+    opts = ap.parse_args()
+
+    ids = load_ids(opts.ids)
+    clocks = {}
+    expect_seq = {}
+    out = []
+
+    def lines():
+        if not opts.captures:
+            yield from sys.stdin
+        for path in opts.captures:
+            with open(path, encoding="utf-8", errors="replace") as f:
+                yield from f
+
+    for core, dropped, recs in batches(lines()):
+        clock = clocks.setdefault(core, CoreClock())
+        if dropped:
+            t = clock.unwrap(recs[0][0]) if recs else (clock.base + (clock.last or 0))
+            out.append((t, core, "drop", f"lost={dropped} (ring full)"))
+        for t_us, rid, seq, *args in recs:
+            t = clock.unwrap(t_us)
+            want = expect_seq.get(core)
+            if want is not None and seq != want:
+                gap = (seq - want) & 0xFFFF
+                out.append((t, core, "gap", f"{gap} record(s) missing before seq {seq}"))
+            expect_seq[core] = (seq + 1) & 0xFFFF
+            if rid < len(ids):
+                name, fmt = ids[rid]
+                out.append((t, core, name, render(fmt, args)))
+            else:
+                out.append((t, core, f"id{rid}", " ".join(str(a) for a in args)))
+
+    out.sort(key=lambda r: r[0])
+    for t, core, name, text in out:
+        print(f"{t / 1000.0:12.3f}  {core}  {name:<12} {text}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,165 @@
+/** @file trace.c
+ *  @brief Per-core binary trace rings and the batch drain to MQTT / stdio.
+ *
+ *  NOTE: Barr-C style. Each core writes only its own smp_ring_t, with
+ *        interrupts masked for the push, so tasks and ISRs on that core
+ *        act as one producer and the drain task is the single consumer.
+ *        No cross-core lock is ever taken on the trace path.
+ *  WARNING: A failed publish traces TR_MQTT_ERR into the ring being drained;
+ *           each round is capped at one ring's worth of batches per core so
+ *           that cannot keep the drain task spinning.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "trace.h"
+#include "smp.h"
+#include "mqtt_client.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define TRACE_STACK_WORDS   (1024u)
+#define TRACE_HDR_BYTES     (8u)
+#define TRACE_BATCH_BYTES   (TRACE_HDR_BYTES + (TRACE_BATCH_MAX * sizeof(trace_rec_t)))
+#define TRACE_ROUND_BATCHES ((TRACE_RING_SLOTS / TRACE_BATCH_MAX) + 1u)
+
+#ifdef configNUM_CORES
+#define TRACE_CORES         (configNUM_CORES)
+#else
+#define TRACE_CORES         (1u)
+#endif
+
+/* ==============================
+ * Static State
+ * ============================== */
+SMP_RING_DEFINE(g_ring0, trace_rec_t, TRACE_RING_SLOTS);
+#if TRACE_CORES > 1
+SMP_RING_DEFINE(g_ring1, trace_rec_t, TRACE_RING_SLOTS);
+static smp_ring_t *const g_rings[TRACE_CORES] = { &g_ring0, &g_ring1 };
+#else
+static smp_ring_t *const g_rings[TRACE_CORES] = { &g_ring0 };
+#endif
+
+static uint16_t     g_seq[TRACE_CORES];
+static uint32_t     g_dropped_seen[TRACE_CORES];
+static uint8_t      g_batch[TRACE_BATCH_BYTES];
+static char         g_hex[(2u * TRACE_BATCH_BYTES) + 1u];
+static StackType_t  g_stack[TRACE_STACK_WORDS];
+static StaticTask_t g_tcb;
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static void   trace_task_(void *pv);
+static size_t fill_batch_(uint8_t core);
+static void   sink_(size_t len);
+
+/* ==============================
+ * Producer
+ * ============================== */
+void trace_emit(trace_id_t id, int32_t a, int32_t b, int32_t c, int32_t d)
+{
+    uint32_t    core = (TRACE_CORES > 1u) ? get_core_num() : 0u;
+    trace_rec_t rec  = { time_us_32(), (uint16_t)id, 0u, { a, b, c, d } };
+
+    uint32_t irq = save_and_disable_interrupts();
+    rec.seq = g_seq[core]++;
+    (void)smp_ring_push(g_rings[core], &rec);
+    restore_interrupts(irq);
+}
+
+/* ==============================
+ * Drain
+ * ============================== */
+/* Header + up to TRACE_BATCH_MAX records; 0 when there is nothing to say. */
+static size_t fill_batch_(uint8_t core)
+{
+    smp_ring_t *r       = g_rings[core];
+    uint32_t    dropped = r->dropped;
+    uint16_t    lost    = (uint16_t)(dropped - g_dropped_seen[core]);
+    uint16_t    n       = 0;
+
+    while ((n < TRACE_BATCH_MAX) &&
+           smp_ring_pop(r, &g_batch[TRACE_HDR_BYTES + (n * sizeof(trace_rec_t))]))
+    {
+        n++;
+    }
+    if ((n == 0u) && (lost == 0u))
+    {
+        return 0u;
+    }
+    g_dropped_seen[core] = dropped;
+
+    g_batch[0] = (uint8_t)'T';
+    g_batch[1] = (uint8_t)'R';
+    g_batch[2] = (uint8_t)TRACE_VERSION;
+    g_batch[3] = core;
+    memcpy(&g_batch[4], &n, sizeof(n));
+    memcpy(&g_batch[6], &lost, sizeof(lost));
+    return TRACE_HDR_BYTES + (n * sizeof(trace_rec_t));
+}
+
+static void sink_(size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    if (mqtt_publish_raw("trace", g_batch, (uint16_t)len, 0, false))
+    {
+        return;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        g_hex[2u * i]        = digits[g_batch[i] >> 4];
+        g_hex[(2u * i) + 1u] = digits[g_batch[i] & 0x0Fu];
+    }
+    g_hex[2u * len] = '\0';
+    printf("[TR] %s\n", g_hex);
+}
+
+static void trace_task_(void *pv)
+{
+    (void)pv;
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1)
+    {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(TRACE_DRAIN_MS));
+        for (uint8_t core = 0; core < TRACE_CORES; core++)
+        {
+            for (uint32_t b = 0; b < TRACE_ROUND_BATCHES; b++)
+            {
+                size_t len = fill_batch_(core);
+                if (len == 0u)
+                {
+                    break;
+                }
+                sink_(len);
+            }
+        }
+    }
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+bool trace_start(uint32_t priority)
+{
+    if (xTaskCreateStatic(trace_task_, "trace", TRACE_STACK_WORDS, NULL, priority,
+                          g_stack, &g_tcb) == NULL)
+    {
+        printf("[TRACE] task create failed\n");
+        return false;
+    }
+    printf("[TRACE] %u slots/core, %u B records\n", TRACE_RING_SLOTS,
+           (unsigned)sizeof(trace_rec_t));
+    return true;
+}
+
+/*** end of file ***/
@@ -0,0 +1,68 @@
+//trace.h
+
+/*
+Binary trace: fixed-size, timestamped records with compile-time IDs, written
+into a per-core RAM ring and drained by a low-priority task.
+
+TRACE() costs a timer read, a 24-byte copy and a few instructions with
+interrupts masked, so it is safe (and cheap) from tasks and ISRs on either
+core, unlike a printf of a float. The drain task sends batches to
+BASE_TOPIC/trace (binary) while MQTT is up and prints them as "[TR] <hex>"
+lines on stdio otherwise; tools/trace_decode.py turns either capture back
+into text using trace_ids.h:
+
+  mosquitto_sub -t robot/alpha/trace -F %x | python3 tools/trace_decode.py
+  python3 tools/trace_decode.py serial.log
+
+Batch layout (little-endian): header {'T','R',version,core,u16 count,
+u16 dropped} followed by 'count' trace_rec_t.
+
+Build with TRACE_ENABLE=0 to compile every trace point out.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE             1
+#endif
+
+#define TRACE_VERSION            1u
+#define TRACE_RING_SLOTS         128u      // per core, power of two
+#define TRACE_DRAIN_MS           100u
+#define TRACE_BATCH_MAX          32u       // records per publish / line
+
+typedef enum {
+#define TRACE_DEF(id, name, fmt) id,
+#include "trace_ids.h"
+#undef TRACE_DEF
+    TR_COUNT
+} trace_id_t;
+
+typedef struct {
+    uint32_t t_us;               // time_us_32()
+    uint16_t id;                 // trace_id_t
+    uint16_t seq;                // per-core, gaps mean drops
+    int32_t  arg[4];
+} trace_rec_t;
+
+// Centi-units for %c arguments (one float multiply, no formatting)
+#define TRACE_CENTI(x)           ((int32_t)((x) * 100.0f))
+
+#if TRACE_ENABLE
+#define TRACE(id, a, b, c, d)    trace_emit((id), (int32_t)(a), (int32_t)(b), \
+                                            (int32_t)(c), (int32_t)(d))
+#else
+#define TRACE(id, a, b, c, d)    ((void)0)
+#endif
+
+// Create the drain task (pin it with the network).
+bool trace_start(uint32_t priority);
+
+// Append one record on the calling core's ring; drops (counted) when full.
+void trace_emit(trace_id_t id, int32_t a, int32_t b, int32_t c, int32_t d);
+
+#endif
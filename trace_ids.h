@@ -0,0 +1,21 @@
+//trace_ids.h
+
+/*
+Trace point table (X-macro): TRACE_DEF(id, "name", "format").
+
+Each record carries four 32-bit arguments; the format says how the host
+decoder (tools/trace_decode.py) prints them, one conversion per argument:
+  %d signed   %u unsigned   %x hex   %c centi (value / 100, two decimals)
+Arguments without a conversion are ignored. Append new IDs at the end so
+old captures still decode; keep each entry on one line (the decoder reads
+this file with a regex). No include guard: included once per expansion.
+ */
+
+TRACE_DEF(TR_DROP,        "drop",        "lost=%u")
+TRACE_DEF(TR_PID,         "pid",         "ir=%u corr=%c L=%c R=%c")
+TRACE_DEF(TR_EVBUS,       "evbus",       "type=%d arg=%u isr=%d")
+TRACE_DEF(TR_IMPACT,      "impact",      "a_imu=%d a_enc=%d cm/s2")
+TRACE_DEF(TR_SLIP,        "slip",        "slip=%c cm/s")
+TRACE_DEF(TR_MOTION_TO,   "motion_to",   "seq=%u cmd=%d")
+TRACE_DEF(TR_STRAIGHT_TO, "straight_to", "progress=%c target=%c cm")
+TRACE_DEF(TR_MQTT_ERR,    "mqtt_err",    "err=%d qos=%u len=%u")
@@ -0,0 +1,284 @@
+/** @file turn.c
+ *  @brief Trapezoidal-profile pivot controller on fused encoder/IMU heading.
+ *
+ *  NOTE: Barr-C style. One encoder tick of wheel differential is ~4 deg of
+ *        heading, so the encoder angle is interpolated between ticks with the
+ *        wheel period speed and corrected towards the IMU yaw.
+ *  WARNING: TURN_KFF_PCT_PER_DPS / TURN_MIN_PCT were set from a 50% pivot
+ *           measuring ~300 deg/s; re-measure if the motors or battery change.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "turn.h"
+#include "encoder.h"
+#include "odometry.h"
+#include "IMU_movement.h"
+#include "attitude.h"
+#include "motor_encoder_demo.h"
+
+/* ==============================
+ * Configuration Constants
+ * ============================== */
+#define TURN_KP_DPS_PER_DEG    (6.0f)      /* position loop on profile error */
+#define TURN_MIN_PCT           (25.0f)     /* static friction breakaway */
+#define TURN_MAX_PCT           (70.0f)
+#define TURN_KFF_PCT_PER_DPS   (0.12f)
+#define TURN_IMU_GAIN          (0.10f)     /* complementary pull per sample */
+#define TURN_IMU_SIGN          (-1.0f)     /* compass yaw grows clockwise */
+#define TURN_OMEGA_ALPHA       (0.5f)
+#define TURN_SPEED_TIMEOUT_MS  (100u)
+#define TURN_RAD_TO_DEG        (180.0f / (float)M_PI)
+
+/* ==============================
+ * Static State
+ * ============================== */
+typedef enum
+{
+    TURN_PHASE_PROFILE = 0,
+    TURN_PHASE_SETTLE
+} turn_phase_t;
+
+typedef struct
+{
+    turn_status_t status;
+    turn_phase_t  phase;
+    float         dir;              /* +1 CCW, -1 CW */
+    float         target_deg;       /* magnitude */
+    float         ref_pos_deg;      /* profile position (magnitude) */
+    float         ref_vel_dps;
+    float         theta_deg;        /* fused, CCW positive */
+    float         omega_dps;        /* filtered, CCW positive */
+    float         imu_corr_deg;
+    float         imu_yaw0_deg;
+    bool          imu_ok;
+    int32_t       l0;
+    int32_t       r0;
+    int32_t       last_diff;
+    uint32_t      last_change_us;
+    uint32_t      last_us;
+    uint32_t      start_ms;
+    float         last_error_deg;
+} turn_ctx_t;
+
+static turn_ctx_t g_turn = { .status = TURN_IDLE };
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static bool  imu_yaw_deg_(float *yaw);
+static float wrap_deg_(float a);
+static float measure_heading_(turn_ctx_t *t, uint32_t now_us);
+static void  command_rate_(const turn_ctx_t *t, float omega_dps);
+
+/* ==============================
+ * Heading Measurement
+ * ============================== */
+static bool imu_yaw_deg_(float *yaw)
+{
+    if (attitude_running())
+    {
+        *yaw = attitude_get_yaw_deg();
+        return true;
+    }
+    imu_data_t d;
+    if (!read_imu_data(&d))
+    {
+        return false;
+    }
+    *yaw = d.yaw;
+    return true;
+}
+
+static float wrap_deg_(float a)
+{
+    while (a > 180.0f)   a -= 360.0f;
+    while (a <= -180.0f) a += 360.0f;
+    return a;
+}
+
+static float measure_heading_(turn_ctx_t *t, uint32_t now_us)
+{
+    int32_t l    = encoder_get_odom_ticks(ENCODER_LEFT_GPIO)  - t->l0;
+    int32_t r    = encoder_get_odom_ticks(ENCODER_RIGHT_GPIO) - t->r0;
+    int32_t diff = r - l;
+    if (diff != t->last_diff)
+    {
+        t->last_diff      = diff;
+        t->last_change_us = now_us;
+    }
+
+    const float tick_deg = (ENCODER_CM_PER_TICK / ODOM_WHEEL_BASE_CM) * TURN_RAD_TO_DEG;
+    float theta = (float)diff * tick_deg;
+
+    /* Interpolate inside the current tick from the wheel period speed */
+    float vl = encoder_get_speed_cm_s_timeout(ENCODER_LEFT_GPIO,  TURN_SPEED_TIMEOUT_MS);
+    float vr = encoder_get_speed_cm_s_timeout(ENCODER_RIGHT_GPIO, TURN_SPEED_TIMEOUT_MS);
+    float w_dps = ((vl + vr) / ODOM_WHEEL_BASE_CM) * TURN_RAD_TO_DEG;
+    float extra = t->dir * w_dps * ((float)(now_us - t->last_change_us) * 1e-6f);
+    if (extra >  tick_deg) extra =  tick_deg;
+    if (extra < -tick_deg) extra = -tick_deg;
+    theta += extra;
+
+    if (t->imu_ok)
+    {
+        float yaw;
+        if (imu_yaw_deg_(&yaw))
+        {
+            float imu_theta = TURN_IMU_SIGN * wrap_deg_(yaw - t->imu_yaw0_deg);
+            t->imu_corr_deg += TURN_IMU_GAIN * (imu_theta - theta - t->imu_corr_deg);
+        }
+    }
+    return theta + t->imu_corr_deg;
+}
+
+/* ==============================
+ * Actuation
+ * ============================== */
+static void command_rate_(const turn_ctx_t *t, float omega_dps)
+{
+    float mag = fabsf(omega_dps);
+    if (mag < 1.0f)
+    {
+        all_stop();
+        return;
+    }
+    float pct = TURN_MIN_PCT + (TURN_KFF_PCT_PER_DPS * mag);
+    if (pct > TURN_MAX_PCT) pct = TURN_MAX_PCT;
+
+    float s = ((omega_dps > 0.0f) ? 1.0f : -1.0f) * t->dir;
+    drive_signed(-s * pct * MOTOR_LEFT_TRIM, s * pct);
+}
+
+/* ==============================
+ * Public API
+ * ============================== */
+void turn_start(float angle_deg)
+{
+    turn_ctx_t *t = &g_turn;
+    uint32_t now_us = time_us_32();
+
+    t->dir            = (angle_deg >= 0.0f) ? 1.0f : -1.0f;
+    t->target_deg     = fabsf(angle_deg);
+    t->ref_pos_deg    = 0.0f;
+    t->ref_vel_dps    = 0.0f;
+    t->theta_deg      = 0.0f;
+    t->omega_dps      = 0.0f;
+    t->imu_corr_deg   = 0.0f;
+    t->l0             = encoder_get_odom_ticks(ENCODER_LEFT_GPIO);
+    t->r0             = encoder_get_odom_ticks(ENCODER_RIGHT_GPIO);
+    t->last_diff      = 0;
+    t->last_change_us = now_us;
+    t->last_us        = now_us;
+    t->start_ms       = to_ms_since_boot(get_absolute_time());
+    t->imu_ok         = imu_yaw_deg_(&t->imu_yaw0_deg);
+    t->phase          = TURN_PHASE_PROFILE;
+    t->status         = TURN_RUNNING;
+}
+
+turn_status_t turn_tick(void)
+{
+    turn_ctx_t *t = &g_turn;
+    if (t->status != TURN_RUNNING)
+    {
+        return t->status;
+    }
+
+    uint32_t now_us = time_us_32();
+    float    dt_s   = (float)(now_us - t->last_us) * 1e-6f;
+    t->last_us = now_us;
+    if (dt_s <= 0.0f)
+    {
+        return t->status;
+    }
+
+    float theta = measure_heading_(t, now_us);
+    float w     = (theta - t->theta_deg) / dt_s;
+    t->omega_dps = t->omega_dps + (TURN_OMEGA_ALPHA * (w - t->omega_dps));
+    t->theta_deg = theta;
+
+    /* Work in magnitudes along the turn direction */
+    float pos = t->dir * theta;
+    float vel = t->dir * t->omega_dps;
+    float err = t->target_deg - pos;
+    float cmd;
+
+    if (t->phase == TURN_PHASE_PROFILE)
+    {
+        float remaining = t->target_deg - t->ref_pos_deg;
+        float v_brake   = sqrtf(2.0f * TURN_ACCEL_DPS2 * fmaxf(remaining, 0.0f));
+        float v         = t->ref_vel_dps + (TURN_ACCEL_DPS2 * dt_s);
+        if (v > TURN_MAX_DPS) v = TURN_MAX_DPS;
+        if (v > v_brake)      v = v_brake;
+        t->ref_vel_dps  = v;
+        t->ref_pos_deg += v * dt_s;
+        if (t->ref_pos_deg >= t->target_deg)
+        {
+            t->ref_pos_deg = t->target_deg;
+            t->ref_vel_dps = 0.0f;
+            t->phase       = TURN_PHASE_SETTLE;
+        }
+        cmd = t->ref_vel_dps + (TURN_KP_DPS_PER_DEG * (t->ref_pos_deg - pos));
+    }
+    else
+    {
+        /* Exact stop: inside tolerance and no longer rotating */
+        if ((fabsf(err) <= TURN_TOL_DEG) && (fabsf(vel) < TURN_SETTLE_DPS))
+        {
+            all_stop();
+            t->last_error_deg = t->dir * err;
+            t->status         = TURN_DONE;
+            return t->status;
+        }
+        cmd = (fabsf(err) <= TURN_TOL_DEG) ? 0.0f : (TURN_KP_DPS_PER_DEG * err);
+    }
+
+    if ((to_ms_since_boot(get_absolute_time()) - t->start_ms) > TURN_TIMEOUT_MS)
+    {
+        all_stop();
+        t->last_error_deg = t->dir * err;
+        t->status         = TURN_TIMEOUT;
+        printf("[TURN] timeout, err %.1f deg\n", t->last_error_deg);
+        return t->status;
+    }
+
+    command_rate_(t, cmd);
+    return t->status;
+}
+
+bool turn_by(float angle_deg)
+{
+    turn_start(angle_deg);
+    turn_status_t st;
+    while ((st = turn_tick()) == TURN_RUNNING)
+    {
+        vTaskDelay(pdMS_TO_TICKS(TURN_TICK_MS));
+    }
+    return (st == TURN_DONE);
+}
+
+void turn_abort(void)
+{
+    if (g_turn.status == TURN_RUNNING)
+    {
+        all_stop();
+        g_turn.status = TURN_IDLE;
+    }
+}
+
+float turn_get_progress_deg(void)
+{
+    return g_turn.theta_deg;
+}
+
+float turn_last_error_deg(void)
+{
+    return g_turn.last_error_deg;
+}
+
+/*** end of file ***/
@@ -0,0 +1,57 @@
+//turn.h
+
+/*
+Closed-loop in-place turns.
+
+Heading is measured from the wheel encoder differential (interpolated
+between ticks with the encoder period speed) and pulled towards the IMU
+yaw with a complementary gain when the IMU answers. A trapezoidal
+angular-velocity profile drives the pivot; the turn ends when the profile
+has finished and the fused heading is inside the tolerance with the chassis
+slowed down, with short corrective nudges if it coasted past.
+ */
+
+#ifndef TURN_H
+#define TURN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Profile limits
+#define TURN_MAX_DPS          300.0f
+#define TURN_ACCEL_DPS2      1200.0f
+
+// Stop criterion
+#define TURN_TOL_DEG            3.0f
+#define TURN_SETTLE_DPS        30.0f
+#define TURN_TIMEOUT_MS      3000u
+
+// Control period of turn_by()
+#define TURN_TICK_MS           10u
+
+typedef enum {
+    TURN_IDLE = 0,
+    TURN_RUNNING,
+    TURN_DONE,
+    TURN_TIMEOUT
+} turn_status_t;
+
+// Begin a pivot of angle_deg (positive = left / counter-clockwise).
+void turn_start(float angle_deg);
+
+// One control step; call every TURN_TICK_MS while TURN_RUNNING.
+turn_status_t turn_tick(void);
+
+// Blocking turn built on turn_start()/turn_tick(). Returns false on timeout.
+bool turn_by(float angle_deg);
+
+// Stop the motors and cancel a running turn.
+void turn_abort(void);
+
+// Fused heading change since turn_start() (deg, CCW positive).
+float turn_get_progress_deg(void);
+
+// Remaining error of the last turn (target - achieved, deg).
+float turn_last_error_deg(void);
+
+#endif
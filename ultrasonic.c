@@ -1,15 +1,27 @@
 /** @file ultrasonic.c
- *  @brief HC-SR04 ultrasonic sensor measurement (distance + fast obstacle detect).
+ *  @brief HC-SR04 ultrasonic sensor measurement (distance + fast obstacle detect)
+ *         and round-robin multi-sensor ranging scheduler.
  *
- *  NOTE: Barr-C style; retry logic and fast detect retained.
+ *  NOTE: Barr-C style; retry logic and fast detect retained for use before the
+ *        scheduler starts. Scheduler fires one sensor per slot from a repeating
+ *        timer and times echoes in a shared raw GPIO IRQ handler, so sensors
+ *        never ping concurrently and edges from an idle sensor are ignored.
+ *  WARNING: Many HC-SR04 clones hold ECHO high ~38 ms when nothing returns;
+ *           such a sensor is skipped until its echo line drops.
  */
 
 #include <stdio.h>
 #include <stdbool.h>
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 #include "pico/time.h"
+#include "FreeRTOS.h"
+#include "task.h"
 #include "ultrasonic.h"
+#include "diag.h"
+#include "smp.h"
 
 /* ==============================
  * Constants
@@ -24,18 +36,69 @@
 #define ULTRA_FAST_WAIT_TIMEOUT   (5000)
 #define ULTRA_FAST_PULSE_TIMEOUT  (10000)
 #define ULTRA_FAST_NEAR_MAX_CM    (20.0f)
+#define ULTRA_SCHED_NONE          (0xFFu)
+#define ULTRA_FRESH_TIMEOUT_MS    (100u)
+
+/* ==============================
+ * Sensor Table
+ * ============================== */
+typedef struct
+{
+    uint trig_pin;
+    uint echo_pin;
+} ultra_pins_t;
+
+static const ultra_pins_t g_pins[ULTRASONIC_NUM_SENSORS] =
+{
+    { TRIG_PIN, ECHO_PIN },
+#if ULTRASONIC_NUM_SENSORS > 1
+    { SIDE_TRIG_PIN, SIDE_ECHO_PIN },
+#endif
+};
+
+/* ==============================
+ * Scheduler State
+ * ============================== */
+static volatile ultrasonic_range_t g_latest[ULTRASONIC_NUM_SENSORS];
+static volatile bool     g_busy[ULTRASONIC_NUM_SENSORS];
+static TaskHandle_t      g_notify[ULTRASONIC_NUM_SENSORS];
+static volatile uint8_t  g_active       = ULTRA_SCHED_NONE;
+static volatile uint32_t g_fire_us      = 0;
+static volatile uint32_t g_rise_us      = 0;
+static uint8_t           g_next         = 0;
+static volatile bool     g_running      = false;
+static repeating_timer_t g_slot_timer;
+
+/* ==============================
+ * Private Prototypes
+ * ============================== */
+static void ultrasonic_trigger_(void);
+static void publish_(uint8_t idx, float dist_cm);
+static void echo_isr_(void);
+static bool slot_cb_(repeating_timer_t *rt);
+static float front_fresh_cm_(void);
 
 /* ==============================
  * Initialization
  * ============================== */
 void ultrasonic_init(void)
 {
-    gpio_init(TRIG_PIN);
-    gpio_set_dir(TRIG_PIN, GPIO_OUT);
-    gpio_put(TRIG_PIN, 0);
+    for (uint8_t i = 0; i < ULTRASONIC_NUM_SENSORS; i++)
+    {
+        gpio_init(g_pins[i].trig_pin);
+        gpio_set_dir(g_pins[i].trig_pin, GPIO_OUT);
+        gpio_put(g_pins[i].trig_pin, 0);
+
+        gpio_init(g_pins[i].echo_pin);
+        gpio_set_dir(g_pins[i].echo_pin, GPIO_IN);
+        gpio_pull_down(g_pins[i].echo_pin);     /* no phantom echoes if unplugged */
 
-    gpio_init(ECHO_PIN);
-    gpio_set_dir(ECHO_PIN, GPIO_IN);
+        g_latest[i].distance_cm = -1.0f;
+        g_latest[i].trigger_us  = 0;
+        g_latest[i].seq         = 0;
+        g_busy[i]               = false;
+        g_notify[i]             = NULL;
+    }
 }
 
 /* ==============================
@@ -55,6 +118,11 @@ static void ultrasonic_trigger_(void)
  * ============================== */
 float ultrasonic_get_distance_cm(void)
 {
+    if (g_running)
+    {
+        return front_fresh_cm_();
+    }
+
     for (int attempt = 0; attempt < ULTRA_MAX_ATTEMPTS; attempt++)
     {
         ultrasonic_trigger_();
@@ -95,11 +163,62 @@ float ultrasonic_get_distance_cm(void)
     return -1.0f;
 }
 
+/* ==============================
+ * Single Ping (No Retry)
+ * ============================== */
+float ultrasonic_ping_cm(float max_range_cm)
+{
+    if (g_running)
+    {
+        float d = front_fresh_cm_();
+        return (d <= max_range_cm) ? d : -1.0f;
+    }
+
+    uint32_t pulse_timeout_us =
+        (uint32_t)((2.0f * max_range_cm) / SPEED_OF_SOUND_CM_PER_US);
+
+    ultrasonic_trigger_();
+
+    uint32_t start_wait = time_us_32();
+    while (!gpio_get(ECHO_PIN))
+    {
+        if ((time_us_32() - start_wait) > ULTRA_FAST_WAIT_TIMEOUT)
+        {
+            return -1.0f;
+        }
+    }
+
+    uint32_t pulse_start = time_us_32();
+    while (gpio_get(ECHO_PIN))
+    {
+        if ((time_us_32() - pulse_start) > pulse_timeout_us)
+        {
+            return -1.0f;
+        }
+    }
+    uint32_t pulse_dur = time_us_32() - pulse_start;
+
+    float dist_cm = (pulse_dur * SPEED_OF_SOUND_CM_PER_US) / 2.0f;
+    if ((dist_cm < ULTRA_MIN_VALID_CM) || (dist_cm > max_range_cm))
+    {
+        return -1.0f;
+    }
+    return dist_cm;
+}
+
 /* ==============================
  * Fast Obstacle Detect
  * ============================== */
 bool ultrasonic_detect_obstacle_fast(void)
 {
+    if (g_running)
+    {
+        ultrasonic_range_t r;
+        ultrasonic_get_latest(ULTRA_SENSOR_FRONT, &r);
+        return (r.distance_cm >= ULTRA_MIN_VALID_CM) &&
+               (r.distance_cm <= ULTRA_FAST_NEAR_MAX_CM);
+    }
+
     ultrasonic_trigger_();
 
     uint32_t start_wait = time_us_32();
@@ -126,4 +245,209 @@ bool ultrasonic_detect_obstacle_fast(void)
     return (dist_cm >= ULTRA_MIN_VALID_CM) && (dist_cm <= ULTRA_FAST_NEAR_MAX_CM);
 }
 
+/* ==============================
+ * Scheduler: Result Publish (IRQ context)
+ * ============================== */
+static void publish_(uint8_t idx, float dist_cm)
+{
+    g_latest[idx].distance_cm = dist_cm;
+    g_latest[idx].trigger_us  = g_fire_us;
+    g_latest[idx].seq         = g_latest[idx].seq + 1u;
+
+    if (g_notify[idx] != NULL)
+    {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(g_notify[idx], &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+/* ==============================
+ * Scheduler: Echo Capture (shared GPIO IRQ)
+ * ============================== */
+static void echo_isr_(void)
+{
+    uint32_t now = time_us_32();
+    for (uint8_t i = 0; i < ULTRASONIC_NUM_SENSORS; i++)
+    {
+        uint     pin = g_pins[i].echo_pin;
+        uint32_t ev  = gpio_get_irq_event_mask(pin) &
+                       (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+        if (ev == 0u)
+        {
+            continue;
+        }
+        gpio_acknowledge_irq(pin, ev);
+
+        if (i != g_active)
+        {
+            /* Late edge from a previous slot: only track when the line frees */
+            if (ev & GPIO_IRQ_EDGE_FALL)
+            {
+                g_busy[i] = false;
+            }
+            continue;
+        }
+
+        if (ev & GPIO_IRQ_EDGE_RISE)
+        {
+            g_rise_us = now;
+        }
+        if ((ev & GPIO_IRQ_EDGE_FALL) && (g_rise_us != 0u))
+        {
+            float d = ((now - g_rise_us) * SPEED_OF_SOUND_CM_PER_US) / 2.0f;
+            publish_(i, ((d >= ULTRA_MIN_VALID_CM) && (d <= ULTRA_MAX_VALID_CM)) ? d : -1.0f);
+            g_active = ULTRA_SCHED_NONE;
+        }
+    }
+}
+
+DIAG_ISR_TIMED(echo_isr_timed_, DIAG_ISR_ECHO, echo_isr_)
+
+/* ==============================
+ * Scheduler: Slot Timer
+ * ============================== */
+static bool slot_cb_(repeating_timer_t *rt)
+{
+    (void)rt;
+
+    /* Close out a slot whose echo never finished */
+    if (g_active != ULTRA_SCHED_NONE)
+    {
+        uint8_t idx = g_active;
+        g_active = ULTRA_SCHED_NONE;
+        g_busy[idx] = gpio_get(g_pins[idx].echo_pin);
+        publish_(idx, -1.0f);
+    }
+
+    for (uint8_t k = 0; k < ULTRASONIC_NUM_SENSORS; k++)
+    {
+        uint8_t idx = (uint8_t)((g_next + k) % ULTRASONIC_NUM_SENSORS);
+        if (g_busy[idx])
+        {
+            continue;
+        }
+        g_next    = (uint8_t)((idx + 1u) % ULTRASONIC_NUM_SENSORS);
+        g_rise_us = 0;
+        g_fire_us = time_us_32();
+        g_active  = idx;
+        gpio_put(g_pins[idx].trig_pin, 1);
+        busy_wait_us_32(ULTRA_TRIGGER_US);
+        gpio_put(g_pins[idx].trig_pin, 0);
+        break;
+    }
+    return g_running;
+}
+
+/* ==============================
+ * Scheduler: Public API
+ * ============================== */
+bool ultrasonic_scheduler_start(void)
+{
+    if (g_running)
+    {
+        return true;
+    }
+
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < ULTRASONIC_NUM_SENSORS; i++)
+    {
+        mask |= (1u << g_pins[i].echo_pin);
+    }
+    gpio_add_raw_irq_handler_masked(mask, echo_isr_timed_);
+    for (uint8_t i = 0; i < ULTRASONIC_NUM_SENSORS; i++)
+    {
+        gpio_acknowledge_irq(g_pins[i].echo_pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+        gpio_set_irq_enabled(g_pins[i].echo_pin,
+                             GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    }
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    g_running = true;
+    if (!alarm_pool_add_repeating_timer_us(smp_alarm_pool(), -(int64_t)ULTRA_SLOT_US,
+                                           slot_cb_, NULL, &g_slot_timer))
+    {
+        g_running = false;
+        printf("[ULTRA] slot timer alloc failed\n");
+        return false;
+    }
+    printf("[ULTRA] scheduler %d sensor(s), slot %u us\n",
+           ULTRASONIC_NUM_SENSORS, ULTRA_SLOT_US);
+    return true;
+}
+
+void ultrasonic_scheduler_stop(void)
+{
+    if (!g_running)
+    {
+        return;
+    }
+    g_running = false;
+    cancel_repeating_timer(&g_slot_timer);
+    for (uint8_t i = 0; i < ULTRASONIC_NUM_SENSORS; i++)
+    {
+        gpio_set_irq_enabled(g_pins[i].echo_pin,
+                             GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
+    }
+    g_active = ULTRA_SCHED_NONE;
+}
+
+bool ultrasonic_scheduler_running(void)
+{
+    return g_running;
+}
+
+bool ultrasonic_get_latest(uint8_t sensor, ultrasonic_range_t *out)
+{
+    if ((sensor >= ULTRASONIC_NUM_SENSORS) || (out == NULL))
+    {
+        return false;
+    }
+    uint32_t irq = save_and_disable_interrupts();
+    out->distance_cm = g_latest[sensor].distance_cm;
+    out->trigger_us  = g_latest[sensor].trigger_us;
+    out->seq         = g_latest[sensor].seq;
+    restore_interrupts(irq);
+    return (out->seq != 0u);
+}
+
+bool ultrasonic_wait_fresh(uint8_t sensor, uint32_t timeout_ms,
+                           ultrasonic_range_t *out)
+{
+    if (!g_running || (sensor >= ULTRASONIC_NUM_SENSORS) || (out == NULL))
+    {
+        return false;
+    }
+
+    uint32_t t0 = time_us_32();
+    while ((time_us_32() - t0) < (timeout_ms * 1000u))
+    {
+        if (ultrasonic_get_latest(sensor, out) &&
+            ((int32_t)(out->trigger_us - t0) >= 0))
+        {
+            return true;
+        }
+        vTaskDelay(1);
+    }
+    return false;
+}
+
+void ultrasonic_set_notify(uint8_t sensor, void *task)
+{
+    if (sensor < ULTRASONIC_NUM_SENSORS)
+    {
+        g_notify[sensor] = (TaskHandle_t)task;
+    }
+}
+
+static float front_fresh_cm_(void)
+{
+    ultrasonic_range_t r;
+    if (!ultrasonic_wait_fresh(ULTRA_SENSOR_FRONT, ULTRA_FRESH_TIMEOUT_MS, &r))
+    {
+        return -1.0f;
+    }
+    return r.distance_cm;
+}
+
 /*** end of file ***/
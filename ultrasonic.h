@@ -7,6 +7,11 @@ Header file defining pin assignments and function prototypes for the ultrasonic
 TRIG_PIN and ECHO_PIN specify which GPIO pins are used for sending the trigger signal
  and receiving the echo.
 
+Several HC-SR04s can be attached. Once ultrasonic_scheduler_start() is called
+ they are fired round-robin from a hardware timer, one at a time so no sensor
+ hears another's ping, and echoes are timed by a shared GPIO interrupt.
+ Results land in a per-sensor latest-range table.
+
 The function prototypes allow main.c to access the initialization and measurement routines.
  */
 
@@ -21,6 +26,29 @@ The function prototypes allow main.c to access the initialization and measuremen
 #define TRIG_PIN 0
 #define ECHO_PIN 1
 
+// Optional right-facing side sensor used to track an obstacle while
+// encircling. The stock robot has only the front HC-SR04, so it is opt-in:
+// build with -DROBOT_SIDE_ULTRASONIC=ON to set ULTRASONIC_NUM_SENSORS to 2.
+#ifndef ULTRASONIC_NUM_SENSORS
+#define ULTRASONIC_NUM_SENSORS 1
+#endif
+#define SIDE_TRIG_PIN 12
+#define SIDE_ECHO_PIN 13
+
+#define ULTRA_SENSOR_FRONT 0
+#define ULTRA_SENSOR_SIDE  1
+
+// Every sensor is refreshed once per 25 ms cycle (40 Hz), split into one
+// firing slot per sensor. Two sensors cap the echo window at ~200 cm.
+#define ULTRA_CYCLE_US 25000u
+#define ULTRA_SLOT_US  (ULTRA_CYCLE_US / ULTRASONIC_NUM_SENSORS)
+
+typedef struct {
+    float    distance_cm;    // -1 when no echo inside the slot
+    uint32_t trigger_us;     // time_us_32() when the ping was fired
+    uint32_t seq;            // increments on every new result
+} ultrasonic_range_t;
+
 // Initializes GPIO pins used by the ultrasonic sensor
 void ultrasonic_init(void);
 
@@ -31,4 +59,27 @@ float ultrasonic_get_distance_cm(void);
 // Add this function prototype to ultrasonic.h
 void ultrasonic_trigger_measurement(void);
 bool ultrasonic_detect_obstacle_fast(void);
+
+// Single ping without retries; echo wait is bounded by max_range_cm so the
+// call never blocks longer than the round trip for that range.
+// Returns -1.0f on timeout or out-of-range.
+float ultrasonic_ping_cm(float max_range_cm);
+
+// Start/stop round-robin firing of all sensors. While running, the blocking
+// calls above return the next front-sensor result instead of pinging.
+bool ultrasonic_scheduler_start(void);
+void ultrasonic_scheduler_stop(void);
+bool ultrasonic_scheduler_running(void);
+
+// Latest result for a sensor (false if the index is invalid or none yet).
+bool ultrasonic_get_latest(uint8_t sensor, ultrasonic_range_t *out);
+
+// Wait for a result from a ping fired after this call (e.g. after the servo
+// settled). Returns false on timeout.
+bool ultrasonic_wait_fresh(uint8_t sensor, uint32_t timeout_ms,
+                           ultrasonic_range_t *out);
+
+// Give a task notification to `task` on every new result from `sensor`
+// (NULL to stop). The handle type is kept opaque to avoid pulling in FreeRTOS.
+void ultrasonic_set_notify(uint8_t sensor, void *task);
 #endif